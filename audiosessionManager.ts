@@ -14,6 +14,9 @@ interface MediaMetadata {
     duration: number;
     position: number;
     status: string | number;
+    // Bridge artwork id. Broadcasts carry albumArtBase64 only when the id
+    // changes; a client keeps the image it already has for the same id
+    albumArtId?: number;
     albumArtBase64?: string;
 }
 
@@ -27,6 +30,10 @@ export class AudiosessionManager {
 
     // Кеш для текущего состояния медиасессии
     private currentMediaMetadata: MediaMetadata | null = null;
+    // Data URL of the current artwork, keyed by the bridge's artwork id
+    private albumArt: { id: number; dataUrl: string } | null = null;
+    // Artwork id whose image every connected client has already been sent
+    private broadcastArtId: number | undefined = undefined;
     private currentFFTSpectrum: number[] | null = null;
 
     constructor(store: ElectronStore<StoreSchema>, logService: LogService) {
@@ -36,7 +43,22 @@ export class AudiosessionManager {
         this.fftbridge.setDbFloor(this.config.fft.dbFloor)
         this.fftbridge.setMasterGain(this.config.fft.masterGain)
         this.fftbridge.setTilt(this.config.fft.tilt)
+        this.fftbridge.setOutputDelay(this.config.fft.outputDelayMs ?? 0)
+
+        // The audio system comes up in the background so app start is not held
+        // up by it; the saved device is restored once it is ready
+        this.fftbridge.ready()
+            .then(() => this.restoreSavedDevice(logService))
+            .catch((err) => {
+                logService.logMessage(`Audio system unavailable: ${err.message}`);
+                console.error("Audio system unavailable:", err);
+            });
+
+        this.setupWebSocketServer();
+        this.setupMediaBridges();
+    }
 
+    private restoreSavedDevice(logService: LogService) {
         const device = this.config.fft.device;
         if (device) {
             const devices = this.fftbridge.listDevices()
@@ -83,9 +105,6 @@ export class AudiosessionManager {
                 }
             }
         }
-
-        this.setupWebSocketServer();
-        this.setupMediaBridges();
     }
 
     private setupWebSocketServer() {
@@ -180,11 +199,9 @@ export class AudiosessionManager {
                 if (s.imageUrl) {
                     // если Linux дал URL — используем его
                     albumArt = s.imageUrl;
-                } else if (s.thumbnail && (s.thumbnail as Buffer).length) {
-                    // иначе — Windows thumbnail → base64
-                    const mime = this.detectMime(s.thumbnail as Buffer);
-                    const b64 = (s.thumbnail as Buffer).toString("base64");
-                    albumArt = `data:${mime};base64,${b64}`;
+                } else {
+                    // иначе — thumbnail → base64
+                    albumArt = this.resolveAlbumArt(s);
                 }
 
                 const metadata: MediaMetadata = {
@@ -195,11 +212,12 @@ export class AudiosessionManager {
                     duration: s.durationMs / 1000,
                     position: s.positionMs / 1000,
                     status,
+                    albumArtId: s.imageUrl ? undefined : s.artwork?.id,
                     albumArtBase64: albumArt,
                 };
 
                 this.currentMediaMetadata = metadata;
-                this.broadcastMedia("metadata", metadata);
+                this.broadcastMetadata(metadata);
             });
         });
 
@@ -286,6 +304,7 @@ export class AudiosessionManager {
 
         this.currentMediaMetadata = null;
         this.currentFFTSpectrum = null;
+        this.broadcastArtId = undefined;
 
         console.log("✅ [AudiosessionManager] AudiosessionManager closed");
     }
@@ -295,10 +314,15 @@ export class AudiosessionManager {
     }
 
     async setDevice(device: AudioDevice): Promise<boolean> {
-        const isAlive = await this.fftbridge.setDevice(device.id);
+        // a running engine switches live and keeps the old device if the new one fails
         this.fftbridge.setLoopback(device.flow === 'render');
-        this.appStorage.set("audio.fft.device", device);
-        this.config.fft.device = device;
+        const isAlive = await this.fftbridge.setDevice(device.id);
+        if (isAlive) {
+            this.appStorage.set("audio.fft.device", device);
+            this.config.fft.device = device;
+        } else {
+            this.fftbridge.setLoopback(this.config.fft.device?.flow === 'render');
+        }
         return isAlive;
     }
 
@@ -312,9 +336,18 @@ export class AudiosessionManager {
     clearMediaState() {
         this.currentMediaMetadata = null;
         this.currentFFTSpectrum = null;
+        this.broadcastArtId = undefined;
         this.broadcastMedia('clear', null);
     }
 
+    // New clients get the full state, image included, on connection; after
+    // that the image only goes out again when the artwork id changes
+    private broadcastMetadata(metadata: MediaMetadata) {
+        const artSent = !!metadata.albumArtId && metadata.albumArtId === this.broadcastArtId;
+        this.broadcastArtId = metadata.albumArtBase64 ? metadata.albumArtId : undefined;
+        this.broadcastMedia("metadata", artSent ? {...metadata, albumArtBase64: undefined} : metadata);
+    }
+
     private broadcastMedia(type: string, data: any) {
         const message = JSON.stringify({type, data});
         this.mediaWss.clients.forEach((client) => {
@@ -324,6 +357,29 @@ export class AudiosessionManager {
         });
     }
 
+    // Bridges with an artwork cache send the thumbnail only when the image
+    // changes and just its id otherwise, so it is encoded once per image
+    private resolveAlbumArt(s: any): string | undefined {
+        const thumb = s.thumbnail as Buffer | undefined;
+        if (s.artwork) {
+            if (!s.artwork.id) {
+                this.albumArt = null;
+                return undefined;
+            }
+            if (thumb && thumb.length) {
+                const mime = s.artwork.mime || this.detectMime(thumb);
+                this.albumArt = {id: s.artwork.id, dataUrl: `data:${mime};base64,${thumb.toString("base64")}`};
+            }
+            return this.albumArt && this.albumArt.id === s.artwork.id ? this.albumArt.dataUrl : undefined;
+        }
+
+        if (thumb && thumb.length) {
+            const mime = this.detectMime(thumb);
+            return `data:${mime};base64,${thumb.toString("base64")}`;
+        }
+        return undefined;
+    }
+
     private detectMime(buf: Buffer): string {
         if (buf.length >= 8 && buf[0] === 0x89 && buf[1] === 0x50 && buf[2] === 0x4E && buf[3] === 0x47) return 'image/png';
         if (buf.length >= 3 && buf[0] === 0xFF && buf[1] === 0xD8 && buf[2] === 0xFF) return 'image/jpeg';
@@ -343,11 +399,6 @@ export class AudiosessionManager {
             try {
                 const success = await this.setDevice(device);
                 if (success) {
-                    // restart the engine to apply the new device (both are now async)
-                    await this.fftbridge.enable(false);
-                    await this.fftbridge.enable(true);
-                    this.appStorage.set("audio.fft.device", device);
-                    this.config.fft.device = device;
                     console.log(`Audio device set to: ${device.name}`);
                     return true;
                 } else {
@@ -386,18 +437,28 @@ export class AudiosessionManager {
             return tilt;
         })
 
+        ipcMain.handle('audio:setFFTOutputDelay', async (event, args) => {
+            const outputDelayMs = args;
+            this.fftbridge.setOutputDelay(outputDelayMs);
+            this.appStorage.set("audio.fft.outputDelayMs", outputDelayMs);
+            this.config.fft.outputDelayMs = outputDelayMs;
+            return outputDelayMs;
+        })
+
         ipcMain.handle('audio:enableFFT', async (event, args) => {
             const enabled = args.enabled;
             try {
                 if (enabled) {
                     const device = this.config.fft.device;
                     if (device) {
-                        await this.fftbridge.enable(true);
+                        // resumes a paused stream, or starts it if it was never running
+                        await this.fftbridge.setPaused(false);
                     } else {
                         throw new Error("No audio device set for FFT. Please set a device first.");
                     }
                 } else {
-                    await this.fftbridge.enable(false);
+                    // warm pause keeps the stream so toggling the visualizer is instant
+                    await this.fftbridge.setPaused(true);
                 }
                 this.appStorage.set("audio.fft.enabled", enabled);
                 this.config.fft.enabled = enabled;
@@ -413,6 +474,7 @@ export class AudiosessionManager {
                 dbFloor: this.config.fft.dbFloor,
                 masterGain: this.config.fft.masterGain,
                 tilt: this.config.fft.tilt,
+                outputDelayMs: this.config.fft.outputDelayMs ?? 0,
                 enabled: this.config.fft.enabled,
                 device: this.config.fft.device
             };
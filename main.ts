@@ -70,6 +70,7 @@ const store = new Store<StoreSchema>({
         dbFloor: -70,
         masterGain: 2,
         tilt: 0.30,
+        outputDelayMs: 0,
       },
       gsm: {
         enabled: true,
@@ -5,6 +5,16 @@
       "sources": [
         "src/addon.cc",
         "src/fft_bands.cpp",
+        "src/task_graph.cpp",
+        "src/spectrum_analyzer.cpp",
+        "src/spectrogram.cpp",
+        "src/cpu_governor.cpp",
+        "src/delay_line.cpp",
+        "src/pitch_tracker.cpp",
+        "src/spectrum_log.cpp",
+        "src/batch_fft.cpp",
+        "src/spectral_features.cpp",
+        "src/kiss_fft_simd.c",
         "src/ringbuffers.h",
         "third_party/kissfft/kiss_fft.c",
         "third_party/kissfft/kiss_fftr.c"
@@ -1,15 +1,94 @@
 export interface Device { id: string; name: string; flow: 'render'|'capture' }
+export interface AnalyzerNodeStats { node: string; lastUs: number; avgUs: number; runs: number }
+// Zeroes while stopped
+export interface CaptureFormat { sampleRate: number; channels: number; format: 'f32'|'s16'|'s24'|'s24_32'|'s32' }
+export interface QualityInfo {
+  level: number
+  levels: number
+  load: number
+  budget: number
+  fftSize: number
+  hopSize: number
+  columnStep: number
+  sampleRate: number
+}
+export interface SpectrumLogInfo { durationMs: number; records: number; columns: number; sampleRate: number; startTime: number }
+export interface ProfileSpec { columns?: number; dbFloor?: number; tilt?: number; gain?: number }
+// float16 values arrive as raw IEEE half bits in a Uint16Array
+export type SpectrumFormat = 'uint8' | 'uint16' | 'float16' | 'float32'
+export interface SpectrumSubscription { format?: SpectrumFormat }
+export interface AgcSettings {
+  enabled?: boolean; frozen?: boolean; target?: number
+  attackMs?: number; releaseMs?: number; maxGainDb?: number; minGainDb?: number
+}
+export interface AgcState extends Required<AgcSettings> { gainDb: number }
+export interface NormalizerSettings { enabled?: boolean; low?: number; high?: number; windowSeconds?: number; minRangeDb?: number }
+// hz is 0, midi -1 and note '' while the input is unvoiced
+export interface PitchEstimate { hz: number; confidence: number; midi: number; cents: number; note: string }
+// points holds x (side), y (mid) pairs; correlation and balance are -1..1
+export interface StereoFrame { correlation: number; balance: number; points: Float32Array }
+// dual: spectra carry the left columns, then the right ones
+export type ChannelMode = 'left' | 'right' | 'mono' | 'mid' | 'side' | 'dual'
+export type SpectrumArray = Uint8Array | Uint16Array | Float32Array
+export interface SpectrogramInfo {
+  columns: number
+  rows: number
+  rgba: boolean
+  layout: 'row-major'|'column-major'
+  firstRow: number
+  // audio time per row; grows when the CPU governor stretches the hop
+  rowSeconds: number
+}
 export interface FftBridge {
+  ready(): Promise<void>
   listDevices(): Device[]
   setDevice(id: string): boolean
   getCurrentDevice(): Device
+  getCaptureFormat(): CaptureFormat
   setBufferSize(fftSize: number): void
   setHopSize(hopSize: number): void
   setColumns(columns: number): void
   enable(on: boolean): void
-  //onFft(cb: (spectrum: Float32Array)=>void): void
-  onFft(cb: (spectrum: Uint8Array) => void): void
-  onWave(cb: (waveform: Int16Array )=>void): void
-  onVu(cb: (vu: Uint8Array)=>void): void
+  setPaused(paused: boolean): Promise<void>
+  isPaused(): boolean
+  onFft(cb: ((spectrum: Uint8Array) => void) | null): void
+  onFft(cb: ((spectrum: SpectrumArray) => void) | null, opts: SpectrumSubscription): void
+  onWave(cb: ((waveform: Int16Array )=>void) | null): void
+  onVu(cb: ((vu: Uint8Array)=>void) | null): void
+  getAnalyzerStats(): AnalyzerNodeStats[]
+  setSpectrogram(opts: { seconds: number; rgba?: boolean }): void
+  setSpectrogramColormap(lut: Uint8Array | null): void
+  getSpectrogramSnapshot(): (SpectrogramInfo & { data: Uint8Array }) | null
+  setProfile(name: string, spec: ProfileSpec): void
+  removeProfile(name: string): void
+  onProfile(name: string, cb: ((spectrum: Uint8Array)=>void) | null): void
+  onProfile(name: string, cb: ((spectrum: SpectrumArray)=>void) | null, opts: SpectrumSubscription): void
+  setPitchRange(minHz: number, maxHz: number): void
+  onPitch(cb: ((pitch: PitchEstimate)=>void) | null): void
+  onStereo(cb: ((stereo: StereoFrame)=>void) | null): void
+  getAnalyzerModules(): string[]
+  // 'spectral': [centroidHz, rolloffHz, flatness, flux]
+  onModule(name: string, cb: ((values: Float32Array)=>void) | null): void
+  setSilenceDetection(opts: { enabled?: boolean; thresholdDb?: number; holdMs?: number }): void
+  isIdle(): boolean
+  setAgc(opts: AgcSettings): void
+  getAgc(): AgcState
+  setNormalizer(opts: NormalizerSettings): void
+  getNormalizer(): Required<NormalizerSettings>
+  setCpuBudget(fraction: number): void
+  getQuality(): QualityInfo
+  setAnalysisRate(hz: number): void
+  setChannelMode(mode: ChannelMode): void
+  getChannelMode(): ChannelMode
+  setOutputDelay(ms: number): void
+  getOutputDelay(): number
+  startLog(opts: { path: string; wave?: boolean }): void
+  stopLog(): void
+  replayLog(opts: { path: string; fromMs?: number; toMs?: number; speed?: number }): Promise<void>
+  stopReplay(): void
+  getLogInfo(path: string): SpectrumLogInfo
+  onSpectrogram(cb: ((rows: Uint8Array, info: SpectrogramInfo)=>void) | null): void
 }
+// Loadable in any worker_threads Worker; each instance owns its own capture
+// and delivers callbacks to the thread that subscribed
 export const FftBridge: { new(): FftBridge }
\ No newline at end of file
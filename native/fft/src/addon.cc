@@ -6,6 +6,8 @@
 #include <cstdio>
 #include <mutex>
 #include <future>
+#include <map>
+#include <thread>
 
 // Platform-specific includes
 #ifdef _WIN32
@@ -22,6 +24,9 @@
   #error "Unsupported platform"
 #endif
 
+#include "quantize.h"
+#include "spectrum_log.h"
+
 // AsyncWorker for enable() operation
 class EnableWorker : public Napi::AsyncWorker {
 public:
@@ -55,6 +60,71 @@ private:
   bool enable_;
 };
 
+// AsyncWorker for setPaused(): resuming a stopped engine starts it, which can block
+class PauseWorker : public Napi::AsyncWorker {
+public:
+  PauseWorker(Napi::Env env, PlatformEngine* engine, bool paused)
+    : Napi::AsyncWorker(env), deferred_(Napi::Promise::Deferred::New(env)),
+      engine_(engine), paused_(paused) {}
+
+  void Execute() override {
+    try {
+      engine_->setPaused(paused_);
+    } catch (const std::exception& e) {
+      SetError(e.what());
+    }
+  }
+
+  void OnOK() override {
+    deferred_.Resolve(Env().Undefined());
+  }
+
+  void OnError(const Napi::Error& e) override {
+    deferred_.Reject(e.Value());
+  }
+
+  Napi::Promise GetPromise() {
+    return deferred_.Promise();
+  }
+
+private:
+  Napi::Promise::Deferred deferred_;
+  PlatformEngine* engine_;
+  bool paused_;
+};
+
+// AsyncWorker for ready(): brings the audio system up off the JS thread
+class InitWorker : public Napi::AsyncWorker {
+public:
+  InitWorker(Napi::Env env, PlatformEngine* engine)
+    : Napi::AsyncWorker(env), deferred_(Napi::Promise::Deferred::New(env)),
+      engine_(engine) {}
+
+  void Execute() override {
+    try {
+      engine_->initialize();
+    } catch (const std::exception& e) {
+      SetError(e.what());
+    }
+  }
+
+  void OnOK() override {
+    deferred_.Resolve(Env().Undefined());
+  }
+
+  void OnError(const Napi::Error& e) override {
+    deferred_.Reject(e.Value());
+  }
+
+  Napi::Promise GetPromise() {
+    return deferred_.Promise();
+  }
+
+private:
+  Napi::Promise::Deferred deferred_;
+  PlatformEngine* engine_;
+};
+
 // AsyncWorker for setDevice() operation
 class SetDeviceWorker : public Napi::AsyncWorker {
 public:
@@ -95,12 +165,10 @@ public:
   StopWorker(Napi::Env env, PlatformEngine* engine,
              Napi::ThreadSafeFunction* tsfn,
              std::mutex* tsfnMutex,
-             Napi::FunctionReference* cbRef,
-             Napi::FunctionReference* waveRef,
-             Napi::FunctionReference* vuRef)
+             std::vector<std::pair<Napi::FunctionReference*, Product>> refs)
     : Napi::AsyncWorker(env), deferred_(Napi::Promise::Deferred::New(env)),
       engine_(engine), tsfn_(tsfn), tsfnMutex_(tsfnMutex),
-      cbRef_(cbRef), waveRef_(waveRef), vuRef_(vuRef) {}
+      refs_(std::move(refs)) {}
 
   void Execute() override {
     try {
@@ -124,17 +192,12 @@ public:
     // Cleanup on main thread
     std::lock_guard<std::mutex> lock(*tsfnMutex_);
 
-    if(!cbRef_->IsEmpty()) {
-      cbRef_->Unref();
-      cbRef_->Reset();
-    }
-    if(!waveRef_->IsEmpty()) {
-      waveRef_->Unref();
-      waveRef_->Reset();
-    }
-    if(!vuRef_->IsEmpty()) {
-      vuRef_->Unref();
-      vuRef_->Reset();
+    for(auto& r : refs_) {
+      if(!r.first->IsEmpty()) {
+        r.first->Unref();
+        r.first->Reset();
+        engine_->demand().release(r.second);
+      }
     }
 
     if (*tsfn_) {
@@ -159,18 +222,18 @@ private:
   PlatformEngine* engine_;
   Napi::ThreadSafeFunction* tsfn_;
   std::mutex* tsfnMutex_;
-  Napi::FunctionReference* cbRef_;
-  Napi::FunctionReference* waveRef_;
-  Napi::FunctionReference* vuRef_;
+  std::vector<std::pair<Napi::FunctionReference*, Product>> refs_;
 };
 
 class Bridge : public Napi::ObjectWrap<Bridge> {
 public:
   static Napi::Object Init(Napi::Env env, Napi::Object exports){
     Napi::Function ctor = DefineClass(env, "FftBridge", {
+      InstanceMethod("ready", &Bridge::Ready),
       InstanceMethod("listDevices", &Bridge::ListDevices),
       InstanceMethod("setDevice", &Bridge::SetDevice),
       InstanceMethod("getCurrentDevice", &Bridge::GetCurrentDevice),
+      InstanceMethod("getCaptureFormat", &Bridge::GetCaptureFormat),
       InstanceMethod("setBufferSize", &Bridge::SetBufferSize),
       InstanceMethod("setHopSize", &Bridge::SetHopSize),
       InstanceMethod("setColumns", &Bridge::SetColumns),
@@ -179,22 +242,57 @@ public:
       InstanceMethod("setTilt", &Bridge::SetTilt),
       InstanceMethod("setLoopback", &Bridge::SetLoopback),
       InstanceMethod("enable", &Bridge::Enable),
+      InstanceMethod("setPaused", &Bridge::SetPaused),
+      InstanceMethod("isPaused", &Bridge::IsPaused),
       InstanceMethod("onFft", &Bridge::OnFft),
       InstanceMethod("stop", &Bridge::Stop),
       InstanceMethod("onWave", &Bridge::OnWave),
       InstanceMethod("onVu", &Bridge::OnVu),
+      InstanceMethod("getAnalyzerStats", &Bridge::GetAnalyzerStats),
+      InstanceMethod("onSpectrogram", &Bridge::OnSpectrogram),
+      InstanceMethod("setSpectrogram", &Bridge::SetSpectrogram),
+      InstanceMethod("setSpectrogramColormap", &Bridge::SetSpectrogramColormap),
+      InstanceMethod("getSpectrogramSnapshot", &Bridge::GetSpectrogramSnapshot),
+      InstanceMethod("setProfile", &Bridge::SetProfile),
+      InstanceMethod("removeProfile", &Bridge::RemoveProfile),
+      InstanceMethod("onProfile", &Bridge::OnProfile),
+      InstanceMethod("setPitchRange", &Bridge::SetPitchRange),
+      InstanceMethod("onPitch", &Bridge::OnPitch),
+      InstanceMethod("onStereo", &Bridge::OnStereo),
+      InstanceMethod("getAnalyzerModules", &Bridge::GetAnalyzerModules),
+      InstanceMethod("onModule", &Bridge::OnModule),
+      InstanceMethod("setSilenceDetection", &Bridge::SetSilenceDetection),
+      InstanceMethod("isIdle", &Bridge::IsIdle),
+      InstanceMethod("setAgc", &Bridge::SetAgc),
+      InstanceMethod("getAgc", &Bridge::GetAgc),
+      InstanceMethod("setNormalizer", &Bridge::SetNormalizer),
+      InstanceMethod("getNormalizer", &Bridge::GetNormalizer),
+      InstanceMethod("setCpuBudget", &Bridge::SetCpuBudget),
+      InstanceMethod("getQuality", &Bridge::GetQuality),
+      InstanceMethod("setAnalysisRate", &Bridge::SetAnalysisRate),
+      InstanceMethod("setChannelMode", &Bridge::SetChannelMode),
+      InstanceMethod("getChannelMode", &Bridge::GetChannelMode),
+      InstanceMethod("setOutputDelay", &Bridge::SetOutputDelay),
+      InstanceMethod("getOutputDelay", &Bridge::GetOutputDelay),
+      InstanceMethod("startLog", &Bridge::StartLog),
+      InstanceMethod("stopLog", &Bridge::StopLog),
+      InstanceMethod("replayLog", &Bridge::ReplayLog),
+      InstanceMethod("stopReplay", &Bridge::StopReplay),
+      InstanceMethod("getLogInfo", &Bridge::GetLogInfo),
     });
     exports.Set("FftBridge", ctor);
     return exports;
   }
 
   Bridge(const Napi::CallbackInfo& info)
-    : Napi::ObjectWrap<Bridge>(info) {
+    : Napi::ObjectWrap<Bridge>(info), env_(info.Env()) {
     // Don't create TSFN in constructor - it will be created lazily when callbacks are set
   }
 
   ~Bridge() {
     std::cout << "[FFT Bridge] Destructor called" << std::endl;
+    if(cleanupHooked_) napi_remove_env_cleanup_hook(env_, &Bridge::EnvCleanup, this);
+    JoinReplay();
     eng_.enable(false);
 
     // Do NOT release TSFN here – StopWorker handles cleanup
@@ -204,12 +302,83 @@ public:
   }
 
 private:
+  // Create TSFN lazily on first callback registration
+  void EnsureTsfn(Napi::Env env){
+    if(!tsfn_) {
+      tsfn_ = Napi::ThreadSafeFunction::New(
+        env,
+        Napi::Function::New(env, [](const Napi::CallbackInfo&){ /* noop */ }),
+        "fft_cb",
+        0,  // queue_size = 0 (unbounded, like GSMTC)
+        1   // initial_thread_count = 1
+      );
+
+      HookCleanup(env);
+    }
+  }
+
+  // Cleanup hooks run newest first: re-adding ours after every new TSFN
+  // keeps it ahead of the TSFN's own teardown
+  void HookCleanup(Napi::Env env){
+    if(cleanupHooked_) napi_remove_env_cleanup_hook(env, &Bridge::EnvCleanup, this);
+    napi_add_env_cleanup_hook(env, &Bridge::EnvCleanup, this);
+    cleanupHooked_ = true;
+  }
+
+  // Stops a running replay and waits for its thread; the thread settles its
+  // promise through its own TSFN, which never blocks on the JS thread
+  void JoinReplay(){
+    if(!replayThread_.joinable()) return;
+    eng_.stopReplay();
+    replayThread_.join();
+  }
+
+  // The environment is shutting down (worker exit or terminate(), or process
+  // exit) without Stop(). Detach every producer thread from the TSFN before
+  // Node frees it, then stop capture; finalizers run later.
+  static void EnvCleanup(void* arg){
+    Bridge* self = static_cast<Bridge*>(arg);
+    self->cleanupHooked_ = false;
+    {
+      std::lock_guard<std::mutex> lock(self->tsfnMutex_);
+      if(self->tsfn_){
+        self->tsfn_.Abort();
+        self->tsfn_ = nullptr;
+      }
+    }
+    self->JoinReplay();
+    self->eng_.enable(false);
+  }
+
+  // Holds fn in ref and registers the bridge as a consumer of product
+  void Subscribe(Napi::FunctionReference& ref, Product product, Napi::Function fn){
+    if(ref.IsEmpty()) eng_.demand().acquire(product);
+    else ref.Unref();
+    ref = Napi::Persistent(fn);
+    ref.Ref();
+  }
+
+  // onXxx(null) drops the JS callback; the engine stops producing the product
+  // once no other consumer holds it
+  void Unsubscribe(Napi::FunctionReference& ref, Product product){
+    if(ref.IsEmpty()) return;
+    ref.Unref();
+    ref.Reset();
+    eng_.demand().release(product);
+  }
+
   Napi::Value Stop(const Napi::CallbackInfo& info){
     std::cout << "[FFT Bridge] ===== Stop() called from JS (async) =====" << std::endl;
     std::cout.flush();
     try{
       // Run stop asynchronously to avoid blocking
-      auto* worker = new StopWorker(info.Env(), &eng_, &tsfn_, &tsfnMutex_, &cbRef_, &waveRef_, &vuRef_);
+      std::vector<std::pair<Napi::FunctionReference*, Product>> refs = {
+        { &cbRef_, Product::Fft }, { &waveRef_, Product::Wave },
+        { &vuRef_, Product::Vu }, { &spectrogramRef_, Product::Spectrogram },
+        { &pitchRef_, Product::Pitch }, { &stereoRef_, Product::Stereo } };
+      for(auto& kv : profileRefs_) refs.emplace_back(&kv.second, Product::Profiles);
+      for(auto& kv : moduleRefs_) refs.emplace_back(&kv.second, Product::Modules);
+      auto* worker = new StopWorker(info.Env(), &eng_, &tsfn_, &tsfnMutex_, std::move(refs));
       worker->Queue();
       return worker->GetPromise();
     } catch(const std::exception& e){
@@ -220,6 +389,14 @@ private:
     }
   }
 
+  // ready() - resolves once the audio system is connected. Calls that need it
+  // before then connect synchronously on the JS thread.
+  Napi::Value Ready(const Napi::CallbackInfo& info){
+    auto* worker = new InitWorker(info.Env(), &eng_);
+    worker->Queue();
+    return worker->GetPromise();
+  }
+
   Napi::Value ListDevices(const Napi::CallbackInfo& info){
     try{
       auto list = eng_.listDevices();
@@ -264,26 +441,53 @@ private:
     }
   }
 
+  // getCaptureFormat() - what the running stream negotiated with the sound server
+  Napi::Value GetCaptureFormat(const Napi::CallbackInfo& info){
+    try{
+      auto f = eng_.captureFormat();
+      Napi::Object o = Napi::Object::New(info.Env());
+      o.Set("sampleRate", Napi::Number::New(info.Env(), f.sampleRate));
+      o.Set("channels", Napi::Number::New(info.Env(), f.channels));
+      o.Set("format", Napi::String::New(info.Env(), sampleFormatName(f.format)));
+      return o;
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  Napi::Value GetAnalyzerStats(const Napi::CallbackInfo& info){
+    try{
+      auto stats = eng_.analyzerStats();
+      Napi::Array arr = Napi::Array::New(info.Env(), stats.size());
+      for(size_t i=0;i<stats.size();++i){
+        Napi::Object o = Napi::Object::New(info.Env());
+        o.Set("node", Napi::String::New(info.Env(), stats[i].name));
+        o.Set("lastUs", Napi::Number::New(info.Env(), stats[i].lastUs));
+        o.Set("avgUs", Napi::Number::New(info.Env(), stats[i].avgUs));
+        o.Set("runs", Napi::Number::New(info.Env(), (double)stats[i].runs));
+        arr.Set(i,o);
+      }
+      return arr;
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
   Napi::Value OnWave(const Napi::CallbackInfo& info){
+    if(info[0].IsNull() || info[0].IsUndefined()){
+      Unsubscribe(waveRef_, Product::Wave);
+      return info.Env().Undefined();
+    }
     if(!info[0].IsFunction()){
       Napi::TypeError::New(info.Env(), "callback required").ThrowAsJavaScriptException();
       return info.Env().Undefined();
     }
 
-    // Create TSFN lazily on first callback registration
-    if(!tsfn_) {
-      tsfn_ = Napi::ThreadSafeFunction::New(
-        info.Env(),
-        Napi::Function::New(info.Env(), [](const Napi::CallbackInfo&){ /* noop */ }),
-        "fft_cb",
-        0,  // queue_size = 0 (unbounded, like GSMTC)
-        1   // initial_thread_count = 1
-      );
-    }
+    EnsureTsfn(info.Env());
 
-    if(!waveRef_.IsEmpty()) waveRef_.Unref();
-    waveRef_ = Napi::Persistent(info[0].As<Napi::Function>());
-    waveRef_.Ref();
+    Subscribe(waveRef_, Product::Wave, info[0].As<Napi::Function>());
 
     eng_.setWaveCallback([this](const std::vector<int16_t>& v){
       std::lock_guard<std::mutex> lock(this->tsfnMutex_);
@@ -306,25 +510,18 @@ private:
   }
 
   Napi::Value OnVu(const Napi::CallbackInfo& info){
+    if(info[0].IsNull() || info[0].IsUndefined()){
+      Unsubscribe(vuRef_, Product::Vu);
+      return info.Env().Undefined();
+    }
     if(!info[0].IsFunction()){
       Napi::TypeError::New(info.Env(), "callback required").ThrowAsJavaScriptException();
       return info.Env().Undefined();
     }
 
-    // Create TSFN lazily on first callback registration
-    if(!tsfn_) {
-      tsfn_ = Napi::ThreadSafeFunction::New(
-        info.Env(),
-        Napi::Function::New(info.Env(), [](const Napi::CallbackInfo&){ /* noop */ }),
-        "fft_cb",
-        0,  // queue_size = 0 (unbounded, like GSMTC)
-        1   // initial_thread_count = 1
-      );
-    }
+    EnsureTsfn(info.Env());
 
-    if(!vuRef_.IsEmpty()) vuRef_.Unref();
-    vuRef_ = Napi::Persistent(info[0].As<Napi::Function>());
-    vuRef_.Ref();
+    Subscribe(vuRef_, Product::Vu, info[0].As<Napi::Function>());
 
     eng_.setVuCallback([this](const std::vector<uint8_t>& v){
       std::lock_guard<std::mutex> lock(this->tsfnMutex_);
@@ -346,6 +543,661 @@ private:
     return info.Env().Undefined();
   }
 
+  // Optional { format } argument of onFft/onProfile; false on an unknown name
+  static bool ReadSpectrumFormat(const Napi::Value& v, SpectrumFormat* out){
+    *out = SpectrumFormat::U8;
+    if(!v.IsObject()) return true;
+    Napi::Object opts = v.As<Napi::Object>();
+    if(!opts.Has("format")) return true;
+    Napi::Value name = opts.Get("format");
+    return name.IsString() && parseSpectrumFormat(name.As<Napi::String>(), out);
+  }
+
+  // A spectrum already packed in its subscriber's format. Packing happens on
+  // the thread that produced the frame, so the JS thread only copies bytes.
+  struct PackedSpectrum {
+    std::string name;   // profile name; empty for the main spectrum
+    SpectrumFormat format = SpectrumFormat::U8;
+    size_t count = 0;
+    std::vector<uint8_t> bytes;
+  };
+
+  static std::shared_ptr<PackedSpectrum> PackSpectrum(const std::vector<float>& v, SpectrumFormat f){
+    auto p = std::make_shared<PackedSpectrum>();
+    p->format = f;
+    p->count = v.size();
+    p->bytes.resize(v.size() * spectrumFormatBytes(f));
+    encodeSpectrum(v.data(), v.size(), f, p->bytes.data());
+    return p;
+  }
+
+  // Electron's V8 sandbox rules out external ArrayBuffers, so the packed
+  // bytes are copied once into a fresh typed array. float16 arrives as raw
+  // half bits in a Uint16Array.
+  static Napi::Value SpectrumArray(Napi::Env env, const PackedSpectrum& p){
+    switch(p.format){
+      case SpectrumFormat::U16:
+      case SpectrumFormat::F16: {
+        auto arr = Napi::Uint16Array::New(env, p.count);
+        std::memcpy(arr.Data(), p.bytes.data(), p.bytes.size());
+        return arr;
+      }
+      case SpectrumFormat::F32: {
+        auto arr = Napi::Float32Array::New(env, p.count);
+        std::memcpy(arr.Data(), p.bytes.data(), p.bytes.size());
+        return arr;
+      }
+      default: {
+        auto arr = Napi::Uint8Array::New(env, p.count);
+        std::memcpy(arr.Data(), p.bytes.data(), p.bytes.size());
+        return arr;
+      }
+    }
+  }
+
+  static Napi::Object SpectrogramInfo(Napi::Env env, const SpectrogramRows& rows){
+    Napi::Object o = Napi::Object::New(env);
+    o.Set("columns", Napi::Number::New(env, rows.columns));
+    o.Set("rows", Napi::Number::New(env, rows.rows));
+    o.Set("rgba", Napi::Boolean::New(env, rows.rgba));
+    o.Set("layout", rows.columnMajor ? "column-major" : "row-major");
+    o.Set("firstRow", Napi::Number::New(env, (double)rows.firstRow));
+    o.Set("rowSeconds", Napi::Number::New(env, rows.rowSeconds));
+    return o;
+  }
+
+  Napi::Value OnSpectrogram(const Napi::CallbackInfo& info){
+    if(info[0].IsNull() || info[0].IsUndefined()){
+      Unsubscribe(spectrogramRef_, Product::Spectrogram);
+      return info.Env().Undefined();
+    }
+    if(!info[0].IsFunction()){
+      Napi::TypeError::New(info.Env(), "callback required").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+
+    EnsureTsfn(info.Env());
+
+    Subscribe(spectrogramRef_, Product::Spectrogram, info[0].As<Napi::Function>());
+
+    eng_.setSpectrogramCallback([this](const SpectrogramRows& rows){
+      std::lock_guard<std::mutex> lock(this->tsfnMutex_);
+      if(!this->tsfn_) return;  // TSFN was released, skip callback
+      auto payload = std::make_shared<SpectrogramRows>(rows);
+      this->tsfn_.BlockingCall(
+        payload.get(),
+        [this, payload](Napi::Env env, Napi::Function /*js*/, SpectrogramRows* data){
+          Napi::HandleScope scope(env);
+          if(!this->spectrogramRef_.IsEmpty()){
+            auto arr = Napi::Uint8Array::New(env, data->data.size());
+            std::memcpy(arr.Data(), data->data.data(), data->data.size());
+            this->spectrogramRef_.Call({ arr, SpectrogramInfo(env, *data) });
+          }
+        }
+      );
+    });
+
+    return info.Env().Undefined();
+  }
+
+  // setSpectrogram({ seconds, rgba }) - seconds = 0 disables the history
+  Napi::Value SetSpectrogram(const Napi::CallbackInfo& info){
+    try{
+      if(!info[0].IsObject()){
+        Napi::TypeError::New(info.Env(), "options object required").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+      }
+      Napi::Object opts = info[0].As<Napi::Object>();
+      float seconds = opts.Has("seconds") ? opts.Get("seconds").As<Napi::Number>().FloatValue() : 0.0f;
+      bool rgba = opts.Has("rgba") && opts.Get("rgba").ToBoolean().Value();
+      eng_.setSpectrogram(seconds, rgba);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  // setSpectrogramColormap(lut: Uint8Array of 256 RGBA entries) - anything else restores the default
+  Napi::Value SetSpectrogramColormap(const Napi::CallbackInfo& info){
+    try{
+      std::vector<uint8_t> lut;
+      if(info[0].IsTypedArray()){
+        auto arr = info[0].As<Napi::Uint8Array>();
+        lut.assign(arr.Data(), arr.Data() + arr.ElementLength());
+      }
+      eng_.setSpectrogramColormap(lut);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  Napi::Value GetSpectrogramSnapshot(const Napi::CallbackInfo& info){
+    try{
+      SpectrogramRows rows;
+      if(!eng_.spectrogramSnapshot(rows)) return info.Env().Null();
+      Napi::Object o = SpectrogramInfo(info.Env(), rows);
+      auto arr = Napi::Uint8Array::New(info.Env(), rows.data.size());
+      std::memcpy(arr.Data(), rows.data.data(), rows.data.size());
+      o.Set("data", arr);
+      return o;
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  // setSilenceDetection({ enabled, thresholdDb, holdMs }) - defaults: on, -90 dBFS, 2000 ms
+  Napi::Value SetSilenceDetection(const Napi::CallbackInfo& info){
+    try{
+      if(!info[0].IsObject()){
+        Napi::TypeError::New(info.Env(), "options object required").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+      }
+      Napi::Object opts = info[0].As<Napi::Object>();
+      bool enabled = !opts.Has("enabled") || opts.Get("enabled").ToBoolean().Value();
+      float thresholdDb = opts.Has("thresholdDb") ? opts.Get("thresholdDb").As<Napi::Number>().FloatValue() : -90.0f;
+      int holdMs = opts.Has("holdMs") ? opts.Get("holdMs").As<Napi::Number>().Int32Value() : 2000;
+      eng_.setSilenceDetection(enabled, thresholdDb, holdMs);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  Napi::Value IsIdle(const Napi::CallbackInfo& info){
+    return Napi::Boolean::New(info.Env(), eng_.isIdle());
+  }
+
+  // setAgc({ enabled, frozen, target, attackMs, releaseMs, maxGainDb, minGainDb }) -
+  // omitted fields keep their current value
+  Napi::Value SetAgc(const Napi::CallbackInfo& info){
+    try{
+      if(!info[0].IsObject()){
+        Napi::TypeError::New(info.Env(), "options object required").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+      }
+      Napi::Object opts = info[0].As<Napi::Object>();
+      AgcSettings s = eng_.agc();
+      if(opts.Has("enabled")) s.enabled = opts.Get("enabled").ToBoolean().Value();
+      if(opts.Has("frozen")) s.frozen = opts.Get("frozen").ToBoolean().Value();
+      if(opts.Has("target")) s.target = opts.Get("target").As<Napi::Number>().FloatValue();
+      if(opts.Has("attackMs")) s.attackMs = opts.Get("attackMs").As<Napi::Number>().FloatValue();
+      if(opts.Has("releaseMs")) s.releaseMs = opts.Get("releaseMs").As<Napi::Number>().FloatValue();
+      if(opts.Has("maxGainDb")) s.maxGainDb = opts.Get("maxGainDb").As<Napi::Number>().FloatValue();
+      if(opts.Has("minGainDb")) s.minGainDb = opts.Get("minGainDb").As<Napi::Number>().FloatValue();
+      eng_.setAgc(s);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  // getAgc() - settings plus gainDb, the gain applied right now
+  Napi::Value GetAgc(const Napi::CallbackInfo& info){
+    try{
+      AgcSettings s = eng_.agc();
+      Napi::Object o = Napi::Object::New(info.Env());
+      o.Set("enabled", Napi::Boolean::New(info.Env(), s.enabled));
+      o.Set("frozen", Napi::Boolean::New(info.Env(), s.frozen));
+      o.Set("target", Napi::Number::New(info.Env(), s.target));
+      o.Set("attackMs", Napi::Number::New(info.Env(), s.attackMs));
+      o.Set("releaseMs", Napi::Number::New(info.Env(), s.releaseMs));
+      o.Set("maxGainDb", Napi::Number::New(info.Env(), s.maxGainDb));
+      o.Set("minGainDb", Napi::Number::New(info.Env(), s.minGainDb));
+      o.Set("gainDb", Napi::Number::New(info.Env(), eng_.agcGainDb()));
+      return o;
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  // setNormalizer({ enabled, low, high, windowSeconds, minRangeDb }) -
+  // omitted fields keep their current value
+  Napi::Value SetNormalizer(const Napi::CallbackInfo& info){
+    try{
+      if(!info[0].IsObject()){
+        Napi::TypeError::New(info.Env(), "options object required").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+      }
+      Napi::Object opts = info[0].As<Napi::Object>();
+      NormalizerSettings s = eng_.normalizer();
+      if(opts.Has("enabled")) s.enabled = opts.Get("enabled").ToBoolean().Value();
+      if(opts.Has("low")) s.low = opts.Get("low").As<Napi::Number>().FloatValue();
+      if(opts.Has("high")) s.high = opts.Get("high").As<Napi::Number>().FloatValue();
+      if(opts.Has("windowSeconds")) s.windowSeconds = opts.Get("windowSeconds").As<Napi::Number>().FloatValue();
+      if(opts.Has("minRangeDb")) s.minRangeDb = opts.Get("minRangeDb").As<Napi::Number>().FloatValue();
+      eng_.setNormalizer(s);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  Napi::Value GetNormalizer(const Napi::CallbackInfo& info){
+    try{
+      NormalizerSettings s = eng_.normalizer();
+      Napi::Object o = Napi::Object::New(info.Env());
+      o.Set("enabled", Napi::Boolean::New(info.Env(), s.enabled));
+      o.Set("low", Napi::Number::New(info.Env(), s.low));
+      o.Set("high", Napi::Number::New(info.Env(), s.high));
+      o.Set("windowSeconds", Napi::Number::New(info.Env(), s.windowSeconds));
+      o.Set("minRangeDb", Napi::Number::New(info.Env(), s.minRangeDb));
+      return o;
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  // setCpuBudget(fraction of one core) - 0 pins the requested plan
+  Napi::Value SetCpuBudget(const Napi::CallbackInfo& info){
+    try{
+      eng_.setCpuBudget(info[0].As<Napi::Number>().FloatValue());
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  Napi::Value GetQuality(const Napi::CallbackInfo& info){
+    try{
+      auto q = eng_.quality();
+      Napi::Object o = Napi::Object::New(info.Env());
+      o.Set("level", Napi::Number::New(info.Env(), q.level));
+      o.Set("levels", Napi::Number::New(info.Env(), q.levels));
+      o.Set("load", Napi::Number::New(info.Env(), q.load));
+      o.Set("budget", Napi::Number::New(info.Env(), q.budget));
+      o.Set("fftSize", Napi::Number::New(info.Env(), q.fftSize));
+      o.Set("hopSize", Napi::Number::New(info.Env(), q.hopSize));
+      o.Set("columnStep", Napi::Number::New(info.Env(), q.columnStep));
+      o.Set("sampleRate", Napi::Number::New(info.Env(), q.sampleRate));
+      return o;
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  // setAnalysisRate(hz) - 0 analyses at the capture rate; otherwise high rates
+  // are halved towards hz, never below 40 kHz
+  Napi::Value SetAnalysisRate(const Napi::CallbackInfo& info){
+    try{
+      int hz = info[0].As<Napi::Number>().Int32Value();
+      if(hz < 0 || hz > 384000) throw std::runtime_error("analysis rate must be 0..384000");
+      eng_.setAnalysisRate(hz);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  // setChannelMode('left'|'right'|'mono'|'mid'|'side'|'dual') - dual spectra
+  // carry the left columns, then the right ones
+  Napi::Value SetChannelMode(const Napi::CallbackInfo& info){
+    try{
+      std::string name = info[0].As<Napi::String>().Utf8Value();
+      static const ChannelMode kModes[] = { ChannelMode::Left, ChannelMode::Right, ChannelMode::Mono,
+                                            ChannelMode::Mid, ChannelMode::Side, ChannelMode::Dual };
+      for(ChannelMode m : kModes){
+        if(name == channelModeName(m)){
+          eng_.setChannelMode(m);
+          return info.Env().Undefined();
+        }
+      }
+      throw std::runtime_error("unknown channel mode: " + name);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  Napi::Value GetChannelMode(const Napi::CallbackInfo& info){
+    return Napi::String::New(info.Env(), channelModeName(eng_.channelMode()));
+  }
+
+  // setOutputDelay(ms) - 0..5000, delays every product by the same amount
+  Napi::Value SetOutputDelay(const Napi::CallbackInfo& info){
+    try{
+      eng_.setOutputDelayMs(info[0].As<Napi::Number>().Int32Value());
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  Napi::Value GetOutputDelay(const Napi::CallbackInfo& info){
+    return Napi::Number::New(info.Env(), eng_.outputDelayMs());
+  }
+
+  // startLog({ path, wave }) - appends every published frame to a spectrum log
+  Napi::Value StartLog(const Napi::CallbackInfo& info){
+    try{
+      if(!info[0].IsObject()){
+        Napi::TypeError::New(info.Env(), "options object required").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+      }
+      Napi::Object opts = info[0].As<Napi::Object>();
+      std::string path = opts.Get("path").As<Napi::String>();
+      bool wave = opts.Has("wave") && opts.Get("wave").ToBoolean().Value();
+      eng_.startLog(path, wave);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  Napi::Value StopLog(const Napi::CallbackInfo& info){
+    try{
+      eng_.stopLog();
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  // replayLog({ path, fromMs, toMs, speed }) - resolves once the range has played.
+  // Playback takes as long as the range does, so it runs on its own thread
+  // rather than holding a libuv pool thread; a second replay stops the first.
+  Napi::Value ReplayLog(const Napi::CallbackInfo& info){
+    try{
+      if(!info[0].IsObject()){
+        Napi::TypeError::New(info.Env(), "options object required").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+      }
+      Napi::Object opts = info[0].As<Napi::Object>();
+      std::string path = opts.Get("path").As<Napi::String>();
+      double fromMs = opts.Has("fromMs") ? opts.Get("fromMs").As<Napi::Number>().DoubleValue() : 0.0;
+      double toMs = opts.Has("toMs") ? opts.Get("toMs").As<Napi::Number>().DoubleValue() : 1e15;
+      double speed = opts.Has("speed") ? opts.Get("speed").As<Napi::Number>().DoubleValue() : 1.0;
+
+      JoinReplay();
+      Napi::Env env = info.Env();
+      auto deferred = std::make_shared<Napi::Promise::Deferred>(Napi::Promise::Deferred::New(env));
+      Napi::ThreadSafeFunction done = Napi::ThreadSafeFunction::New(
+        env, Napi::Function::New(env, [](const Napi::CallbackInfo&){ /* noop */ }), "fft_replay", 0, 1);
+      HookCleanup(env);
+
+      replayThread_ = std::thread([this, done, deferred, path, fromMs, toMs, speed]() mutable {
+        auto* error = new std::string();
+        try{
+          eng_.replayLog(path, fromMs, toMs, speed);
+        } catch(const std::exception& e){
+          *error = e.what();
+          if(error->empty()) *error = "Replay failed";
+        }
+        napi_status st = done.BlockingCall(error,
+          [deferred](Napi::Env env, Napi::Function /*js*/, std::string* err){
+            Napi::HandleScope scope(env);
+            if(err->empty()) deferred->Resolve(env.Undefined());
+            else deferred->Reject(Napi::Error::New(env, *err).Value());
+            delete err;
+          });
+        if(st != napi_ok) delete error;
+        done.Release();
+      });
+      return deferred->Promise();
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  Napi::Value StopReplay(const Napi::CallbackInfo& info){
+    eng_.stopReplay();
+    return info.Env().Undefined();
+  }
+
+  Napi::Value GetLogInfo(const Napi::CallbackInfo& info){
+    try{
+      SpectrumLogReader reader;
+      reader.open(info[0].As<Napi::String>());
+      Napi::Object o = Napi::Object::New(info.Env());
+      o.Set("durationMs", Napi::Number::New(info.Env(), reader.durationMs()));
+      o.Set("records", Napi::Number::New(info.Env(), (double)reader.records()));
+      o.Set("columns", Napi::Number::New(info.Env(), reader.columns()));
+      o.Set("sampleRate", Napi::Number::New(info.Env(), reader.sampleRate()));
+      o.Set("startTime", Napi::Number::New(info.Env(), (double)reader.startUnixMs()));
+      return o;
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  // setProfile(name, { columns, dbFloor, tilt, gain }) - adds or replaces a named profile
+  Napi::Value SetProfile(const Napi::CallbackInfo& info){
+    try{
+      if(!info[0].IsString() || !info[1].IsObject()){
+        Napi::TypeError::New(info.Env(), "name and options object required").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+      }
+      std::string name = info[0].As<Napi::String>();
+      Napi::Object opts = info[1].As<Napi::Object>();
+      ProfileSpec spec;
+      if(opts.Has("columns")) spec.columns = opts.Get("columns").As<Napi::Number>().Int32Value();
+      if(opts.Has("dbFloor")) spec.dbFloor = opts.Get("dbFloor").As<Napi::Number>().FloatValue();
+      if(opts.Has("tilt")) spec.tilt = opts.Get("tilt").As<Napi::Number>().FloatValue();
+      if(opts.Has("gain")) spec.gain = opts.Get("gain").As<Napi::Number>().FloatValue();
+      eng_.setProfile(name, spec);
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  Napi::Value RemoveProfile(const Napi::CallbackInfo& info){
+    try{
+      eng_.removeProfile(info[0].As<Napi::String>());
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  // onProfile(name, cb | null, { format }?) - each profile is subscribed on its own
+  Napi::Value OnProfile(const Napi::CallbackInfo& info){
+    if(!info[0].IsString()){
+      Napi::TypeError::New(info.Env(), "profile name required").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    std::string name = info[0].As<Napi::String>();
+    if(info[1].IsNull() || info[1].IsUndefined()){
+      auto it = profileRefs_.find(name);
+      if(it != profileRefs_.end()) Unsubscribe(it->second, Product::Profiles);
+      return info.Env().Undefined();
+    }
+    if(!info[1].IsFunction()){
+      Napi::TypeError::New(info.Env(), "callback required").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+
+    SpectrumFormat format;
+    if(!ReadSpectrumFormat(info[2], &format)){
+      Napi::TypeError::New(info.Env(), "format must be uint8, uint16, float16 or float32").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    {
+      std::lock_guard<std::mutex> lock(tsfnMutex_);
+      profileFormats_[name] = format;
+    }
+
+    EnsureTsfn(info.Env());
+
+    Subscribe(profileRefs_[name], Product::Profiles, info[1].As<Napi::Function>());
+
+    // One engine callback serves every profile; frames are packed in their
+    // subscriber's format here and routed by name on the JS thread
+    eng_.setProfileCallback([this](const ProfileFrame& f){
+      std::lock_guard<std::mutex> lock(this->tsfnMutex_);
+      if(!this->tsfn_) return;  // TSFN was released, skip callback
+      auto fmt = this->profileFormats_.find(f.name);
+      auto payload = PackSpectrum(f.spectrum, fmt != this->profileFormats_.end() ? fmt->second : SpectrumFormat::U8);
+      payload->name = f.name;
+      this->tsfn_.BlockingCall(
+        payload.get(),
+        [this, payload](Napi::Env env, Napi::Function /*js*/, PackedSpectrum* data){
+          Napi::HandleScope scope(env);
+          auto it = this->profileRefs_.find(data->name);
+          if(it != this->profileRefs_.end() && !it->second.IsEmpty()){
+            it->second.Call({ SpectrumArray(env, *data) });
+          }
+        }
+      );
+    });
+
+    return info.Env().Undefined();
+  }
+
+  // getAnalyzerModules() - names of the analysis modules built into the addon
+  Napi::Value GetAnalyzerModules(const Napi::CallbackInfo& info){
+    const auto& modules = analyzerModules();
+    Napi::Array arr = Napi::Array::New(info.Env(), modules.size());
+    for(size_t i = 0; i < modules.size(); ++i){
+      arr.Set((uint32_t)i, Napi::String::New(info.Env(), modules[i].name));
+    }
+    return arr;
+  }
+
+  // onModule(name, cb | null) - a module's values per hop as a Float32Array
+  Napi::Value OnModule(const Napi::CallbackInfo& info){
+    if(!info[0].IsString()){
+      Napi::TypeError::New(info.Env(), "module name required").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    std::string name = info[0].As<Napi::String>();
+    if(info[1].IsNull() || info[1].IsUndefined()){
+      auto it = moduleRefs_.find(name);
+      if(it != moduleRefs_.end()) Unsubscribe(it->second, Product::Modules);
+      return info.Env().Undefined();
+    }
+    if(!info[1].IsFunction()){
+      Napi::TypeError::New(info.Env(), "callback required").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    bool known = false;
+    for(const auto& m : analyzerModules()) known = known || name == m.name;
+    if(!known){
+      Napi::Error::New(info.Env(), "unknown analyzer module: " + name).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+
+    EnsureTsfn(info.Env());
+
+    Subscribe(moduleRefs_[name], Product::Modules, info[1].As<Napi::Function>());
+
+    // One engine callback serves every module; frames are routed by name on the JS thread
+    eng_.setModuleCallback([this](const ModuleFrame& f){
+      std::lock_guard<std::mutex> lock(this->tsfnMutex_);
+      if(!this->tsfn_) return;  // TSFN was released, skip callback
+      auto payload = std::make_shared<ModuleFrame>(f);
+      this->tsfn_.BlockingCall(
+        payload.get(),
+        [this, payload](Napi::Env env, Napi::Function /*js*/, ModuleFrame* data){
+          Napi::HandleScope scope(env);
+          auto it = this->moduleRefs_.find(data->name);
+          if(it != this->moduleRefs_.end() && !it->second.IsEmpty()){
+            auto arr = Napi::Float32Array::New(env, data->values.size());
+            if(!data->values.empty()) std::memcpy(arr.Data(), data->values.data(), data->values.size() * sizeof(float));
+            it->second.Call({ arr });
+          }
+        }
+      );
+    });
+
+    return info.Env().Undefined();
+  }
+
+  // setPitchRange(minHz, maxHz)
+  Napi::Value SetPitchRange(const Napi::CallbackInfo& info){
+    try{
+      eng_.setPitchRange(info[0].As<Napi::Number>().FloatValue(), info[1].As<Napi::Number>().FloatValue());
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+  }
+
+  // onPitch(cb | null) - { hz, confidence, midi, cents, note }; hz is 0 when unvoiced
+  Napi::Value OnPitch(const Napi::CallbackInfo& info){
+    if(info[0].IsNull() || info[0].IsUndefined()){
+      Unsubscribe(pitchRef_, Product::Pitch);
+      return info.Env().Undefined();
+    }
+    if(!info[0].IsFunction()){
+      Napi::TypeError::New(info.Env(), "callback required").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+
+    EnsureTsfn(info.Env());
+
+    Subscribe(pitchRef_, Product::Pitch, info[0].As<Napi::Function>());
+
+    eng_.setPitchCallback([this](const PitchEstimate& p){
+      std::lock_guard<std::mutex> lock(this->tsfnMutex_);
+      if(!this->tsfn_) return;  // TSFN was released, skip callback
+      auto payload = std::make_shared<PitchEstimate>(p);
+      this->tsfn_.BlockingCall(
+        payload.get(),
+        [this, payload](Napi::Env env, Napi::Function /*js*/, PitchEstimate* data){
+          Napi::HandleScope scope(env);
+          if(!this->pitchRef_.IsEmpty()){
+            Napi::Object o = Napi::Object::New(env);
+            o.Set("hz", Napi::Number::New(env, data->hz));
+            o.Set("confidence", Napi::Number::New(env, data->confidence));
+            o.Set("midi", Napi::Number::New(env, data->midi));
+            o.Set("cents", Napi::Number::New(env, data->cents));
+            o.Set("note", Napi::String::New(env, data->note));
+            this->pitchRef_.Call({ o });
+          }
+        }
+      );
+    });
+
+    return info.Env().Undefined();
+  }
+
+  // onStereo(cb | null) - { correlation, balance, points }; points is a
+  // Float32Array of x (side), y (mid) pairs gathered since the last call
+  Napi::Value OnStereo(const Napi::CallbackInfo& info){
+    if(info[0].IsNull() || info[0].IsUndefined()){
+      Unsubscribe(stereoRef_, Product::Stereo);
+      return info.Env().Undefined();
+    }
+    if(!info[0].IsFunction()){
+      Napi::TypeError::New(info.Env(), "callback required").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+
+    EnsureTsfn(info.Env());
+
+    Subscribe(stereoRef_, Product::Stereo, info[0].As<Napi::Function>());
+
+    eng_.setStereoCallback([this](const StereoFrame& f){
+      std::lock_guard<std::mutex> lock(this->tsfnMutex_);
+      if(!this->tsfn_) return;  // TSFN was released, skip callback
+      auto payload = std::make_shared<StereoFrame>(f);
+      this->tsfn_.BlockingCall(
+        payload.get(),
+        [this, payload](Napi::Env env, Napi::Function /*js*/, StereoFrame* data){
+          Napi::HandleScope scope(env);
+          if(!this->stereoRef_.IsEmpty()){
+            Napi::Object o = Napi::Object::New(env);
+            o.Set("correlation", Napi::Number::New(env, data->correlation));
+            o.Set("balance", Napi::Number::New(env, data->balance));
+            auto points = Napi::Float32Array::New(env, data->points.size());
+            if(!data->points.empty()) std::memcpy(points.Data(), data->points.data(), data->points.size() * sizeof(float));
+            o.Set("points", points);
+            this->stereoRef_.Call({ o });
+          }
+        }
+      );
+    });
+
+    return info.Env().Undefined();
+  }
+
   Napi::Value SetBufferSize(const Napi::CallbackInfo& info){
     try{
       eng_.setFftSize(info[0].As<Napi::Number>().Int32Value());
@@ -422,39 +1274,59 @@ private:
     }
   }
 
+  // setPaused(paused) - warm pause: the stream, plans and buffers stay
+  // allocated so resuming is near-instant; enable(false) still tears down
+  Napi::Value SetPaused(const Napi::CallbackInfo& info){
+    try{
+      bool paused = info[0].As<Napi::Boolean>().Value();
+      auto* worker = new PauseWorker(info.Env(), &eng_, paused);
+      worker->Queue();
+      return worker->GetPromise();
+    } catch(const std::exception& e){
+      Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+  }
+
+  Napi::Value IsPaused(const Napi::CallbackInfo& info){
+    return Napi::Boolean::New(info.Env(), eng_.paused());
+  }
+
+  // onFft(cb | null, { format }?) - format defaults to uint8
   Napi::Value OnFft(const Napi::CallbackInfo& info){
+    if(info[0].IsNull() || info[0].IsUndefined()){
+      Unsubscribe(cbRef_, Product::Fft);
+      return info.Env().Undefined();
+    }
     if(!info[0].IsFunction()){
       Napi::TypeError::New(info.Env(), "callback required").ThrowAsJavaScriptException();
       return info.Env().Undefined();
     }
 
-    // Create TSFN lazily on first callback registration
-    if(!tsfn_) {
-      tsfn_ = Napi::ThreadSafeFunction::New(
-        info.Env(),
-        Napi::Function::New(info.Env(), [](const Napi::CallbackInfo&){ /* noop */ }),
-        "fft_cb",
-        0,  // queue_size = 0 (unbounded, like GSMTC)
-        1   // initial_thread_count = 1
-      );
+    SpectrumFormat format;
+    if(!ReadSpectrumFormat(info[1], &format)){
+      Napi::TypeError::New(info.Env(), "format must be uint8, uint16, float16 or float32").ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+    {
+      std::lock_guard<std::mutex> lock(tsfnMutex_);
+      fftFormat_ = format;
     }
 
-    if(!cbRef_.IsEmpty()) cbRef_.Unref();
-    cbRef_ = Napi::Persistent(info[0].As<Napi::Function>());
-    cbRef_.Ref();
+    EnsureTsfn(info.Env());
 
-    eng_.setCallback([this](const std::vector<uint8_t>& v){
+    Subscribe(cbRef_, Product::Fft, info[0].As<Napi::Function>());
+
+    eng_.setCallback([this](const std::vector<float>& v){
       std::lock_guard<std::mutex> lock(this->tsfnMutex_);
       if(!this->tsfn_) return;  // TSFN was released, skip callback
-      auto payload = std::make_shared<std::vector<uint8_t>>(v);
+      auto payload = PackSpectrum(v, this->fftFormat_);
       this->tsfn_.BlockingCall(
         payload.get(),
-        [this, payload](Napi::Env env, Napi::Function /*js*/, std::vector<uint8_t>* data){
+        [this, payload](Napi::Env env, Napi::Function /*js*/, PackedSpectrum* data){
           Napi::HandleScope scope(env);
           if(!this->cbRef_.IsEmpty()){
-            auto arr = Napi::Uint8Array::New(env, data->size());
-            std::memcpy(arr.Data(), data->data(), data->size());
-            this->cbRef_.Call({ arr });
+            this->cbRef_.Call({ SpectrumArray(env, *data) });
           }
         }
       );
@@ -464,11 +1336,23 @@ private:
   }
 
   PlatformEngine eng_;
+  napi_env env_;
+  bool cleanupHooked_ = false;  // EnvCleanup registered on env_
   Napi::ThreadSafeFunction tsfn_;
   Napi::FunctionReference cbRef_;
   Napi::FunctionReference waveRef_;
   Napi::FunctionReference vuRef_;
+  Napi::FunctionReference spectrogramRef_;
+  Napi::FunctionReference pitchRef_;
+  Napi::FunctionReference stereoRef_;
+  std::map<std::string, Napi::FunctionReference> profileRefs_;
+  std::map<std::string, Napi::FunctionReference> moduleRefs_;
+  // Wire encoding per subscription; guarded by tsfnMutex_ since the
+  // producing thread packs frames with it
+  SpectrumFormat fftFormat_ = SpectrumFormat::U8;
+  std::map<std::string, SpectrumFormat> profileFormats_;
   std::mutex tsfnMutex_;  // Protect TSFN access
+  std::thread replayThread_;
 };
 
 Napi::Object InitAll(Napi::Env env, Napi::Object exports){
@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+struct AgcSettings {
+  bool enabled = false;
+  bool frozen = false;        // hold the current gain
+  float target = 0.85f;       // where the loudest band settles, 0..1 before tilt and master gain
+  float attackMs = 80.0f;     // time constant when the input gets louder
+  float releaseMs = 4000.0f;  // time constant when it gets quieter
+  float maxGainDb = 24.0f;
+  float minGainDb = -24.0f;
+};
+
+// Automatic gain for spectrum levels.
+//
+// Follows the loudest band of each frame with a one-pole loudness estimate
+// (fast attack, slow release) and returns the dB offset that puts that
+// estimate at the target level. The offset is added to every band before the
+// floor mapping, so it costs one add per band plus one exp() per frame.
+// Frames with nothing above the floor leave the estimate alone, so silence
+// never winds the gain up to its limit. Runs on the capture thread; settings
+// may be changed from any thread.
+class Agc {
+public:
+  void setSettings(const AgcSettings& s) {
+    target_ = std::max(0.05f, std::min(1.0f, s.target));
+    attackMs_ = std::max(1.0f, s.attackMs);
+    releaseMs_ = std::max(1.0f, s.releaseMs);
+    minGainDb_ = std::min(s.minGainDb, 0.0f);
+    maxGainDb_ = std::max(s.maxGainDb, 0.0f);
+    frozen_ = s.frozen;
+    enabled_ = s.enabled;
+  }
+
+  AgcSettings settings() const {
+    AgcSettings s;
+    s.enabled = enabled_;
+    s.frozen = frozen_;
+    s.target = target_;
+    s.attackMs = attackMs_;
+    s.releaseMs = releaseMs_;
+    s.maxGainDb = maxGainDb_;
+    s.minGainDb = minGainDb_;
+    return s;
+  }
+
+  // Gain currently applied, in dB.
+  float gainDb() const { return gainDb_; }
+
+  // peakDb: loudest band of the previous frame before any AGC gain.
+  // Returns the gain for the next frame.
+  float update(double peakDb, double dbFloor, double hopSeconds) {
+    if (!enabled_) {
+      primed_ = false;
+      gainDb_ = 0.0f;
+      return 0.0f;
+    }
+    if (frozen_ || peakDb <= dbFloor) return gainDb_;
+
+    if (!primed_) {
+      loudDb_ = peakDb;
+      primed_ = true;
+    } else {
+      const double tauMs = peakDb > loudDb_ ? attackMs_ : releaseMs_;
+      loudDb_ += (1.0 - std::exp(-hopSeconds * 1000.0 / tauMs)) * (peakDb - loudDb_);
+    }
+
+    // level = (db + gain - floor) / -floor  ->  solve for level == target
+    const double targetDb = dbFloor * (1.0 - target_);
+    const double g = std::max<double>(minGainDb_, std::min<double>(maxGainDb_, targetDb - loudDb_));
+    gainDb_ = (float)g;
+    return gainDb_;
+  }
+
+private:
+  std::atomic<bool> enabled_{false};
+  std::atomic<bool> frozen_{false};
+  std::atomic<float> target_{0.85f};
+  std::atomic<float> attackMs_{80.0f};
+  std::atomic<float> releaseMs_{4000.0f};
+  std::atomic<float> maxGainDb_{24.0f};
+  std::atomic<float> minGainDb_{-24.0f};
+  std::atomic<float> gainDb_{0.0f};
+  double loudDb_ = 0.0;
+  bool primed_ = false;
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Analysis modules: features, meters and detectors that run inside the
+// analyzer's task graph on the same hop as the FFT.
+//
+// A module sees read-only views of the analyzer's own buffers (raw frame,
+// windowed FFT input, complex bins, magnitudes) and writes its result
+// straight into its slot of the shared AnalysisFrame, so adding one costs no
+// extra buffering, copies or locks in the engines. Modules are registered at
+// build time with REGISTER_ANALYZER_MODULE and every analyzer instance gets
+// its own copy of each.
+
+// Geometry a module runs at. Sent before the first frame and again whenever
+// the analysis rate, the effective FFT size or the hop changes.
+struct ModulePlan {
+  int sampleRate = 0;    // analysis rate, after decimation
+  int fftSize = 0;       // effective size, after the CPU governor
+  int hopSize = 0;
+  bool dual = false;     // right-channel views are present
+};
+
+// One analysed hop. Every pointer aliases analyzer state and is valid only
+// during process().
+struct FrameView {
+  uint64_t index = 0;                  // hops since the analyzer was configured
+  std::chrono::steady_clock::time_point time;  // capture time of the newest sample
+  size_t size = 0;                     // samples per frame (fftSize)
+  size_t bins = 0;                     // size / 2 + 1, DC to Nyquist
+  float binHz = 0.0f;                  // width of one bin
+  const float* samples = nullptr;      // raw frame, oldest first
+  const float* windowed = nullptr;     // FFT input (Hamming-windowed frame)
+  const float* spectrum = nullptr;     // complex bins as re, im pairs
+  const float* magnitude = nullptr;    // amplitude per bin, 1.0 = full-scale sine
+  // Dual channel mode only, otherwise null; the fields above are the left channel
+  const float* samplesRight = nullptr;
+  const float* windowedRight = nullptr;
+  const float* spectrumRight = nullptr;
+  const float* magnitudeRight = nullptr;
+};
+
+// A module's slot in the shared output frame, as many floats as configure()
+// asked for.
+class FrameWriter {
+public:
+  FrameWriter(float* data, size_t size) : data_(data), size_(size) {}
+
+  float* data() { return data_; }
+  size_t size() const { return size_; }
+  float& operator[](size_t i) { return data_[i]; }
+
+private:
+  float* data_;
+  size_t size_;
+};
+
+class IAnalyzer {
+public:
+  virtual ~IAnalyzer() = default;
+
+  // Capture thread, outside the hop; the place to allocate. Returns how many
+  // floats the module publishes per hop.
+  virtual size_t configure(const ModulePlan& plan) = 0;
+  // Worker thread, once per analysed hop. Must not allocate or block; modules
+  // run in parallel with each other and with the band mapping.
+  virtual void process(const FrameView& frame) = 0;
+  // Same thread, right after process(): write the current result.
+  virtual void publish(FrameWriter& out) = 0;
+  // Capture thread. The input had a gap (pause, device switch); drop history.
+  virtual void reset() {}
+};
+
+using AnalyzerModuleFactory = std::unique_ptr<IAnalyzer> (*)();
+
+struct AnalyzerModuleInfo {
+  const char* name;
+  AnalyzerModuleFactory create;
+};
+
+// Every module linked into the build, in registration order.
+inline std::vector<AnalyzerModuleInfo>& analyzerModules() {
+  static std::vector<AnalyzerModuleInfo> modules;
+  return modules;
+}
+
+struct AnalyzerModuleRegistrar {
+  AnalyzerModuleRegistrar(const char* name, AnalyzerModuleFactory create) {
+    analyzerModules().push_back({ name, create });
+  }
+};
+
+// In the module's .cpp, at namespace scope: REGISTER_ANALYZER_MODULE(Type, "name")
+#define REGISTER_ANALYZER_MODULE(Type, name)                                  \
+  static AnalyzerModuleRegistrar analyzerModuleRegistrar_##Type(              \
+    name, [] { return std::unique_ptr<IAnalyzer>(new Type()); })
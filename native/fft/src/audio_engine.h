@@ -3,6 +3,14 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include "channel_mix.h"
+#include "cpu_governor.h"
+#include "demand.h"
+#include "sample_convert.h"
+#include "spectrogram.h"
+#include "spectrum_analyzer.h"
+#include "stereo_meter.h"
+#include "task_graph.h"
 
 // Cross-platform device info structure
 struct DeviceInfo {
@@ -15,17 +23,32 @@ struct DeviceInfo {
 // Abstract audio engine interface
 class AudioEngine {
 public:
-  // Callback types
-  using FftCallback = std::function<void(const std::vector<uint8_t>&)>;
+  // Callback types. Spectra are float levels (0..1 when clamped); the wire
+  // encoding is chosen per subscription by the bridge.
+  using FftCallback = std::function<void(const std::vector<float>&)>;
   using WaveCallback = std::function<void(const std::vector<int16_t>&)>;
   using VuCallback = std::function<void(const std::vector<uint8_t>&)>;
+  using SpectrogramCallback = std::function<void(const SpectrogramRows&)>;
+  using ProfileCallback = std::function<void(const ProfileFrame&)>;
+  using PitchCallback = std::function<void(const PitchEstimate&)>;
+  using StereoCallback = std::function<void(const StereoFrame&)>;
+  using ModuleCallback = std::function<void(const ModuleFrame&)>;
 
   virtual ~AudioEngine() = default;
 
+  // Connects to the platform audio system. Constructing an engine is cheap;
+  // the connection is made here, either up front on a background thread or
+  // implicitly by the first call that needs it. Idempotent and thread-safe;
+  // throws std::runtime_error if the audio system is unavailable.
+  virtual void initialize() {}
+
   // Device management
   virtual std::vector<DeviceInfo> listDevices() = 0;
   virtual bool setDevice(const std::string& deviceId) = 0;
   virtual DeviceInfo currentDevice() = 0;
+  // Rate, channels and sample format the running stream negotiated; all
+  // zero/F32 while stopped or on engines that do not report it
+  virtual CaptureFormat captureFormat() { return CaptureFormat(); }
 
   // FFT configuration
   virtual void setFftSize(int fft) = 0;
@@ -38,9 +61,78 @@ public:
   // Audio capture configuration
   virtual void setLoopback(bool on) = 0;
   virtual void enable(bool on) = 0;
+  // Warm pause: stops delivering audio and products but keeps the stream,
+  // plans and buffers allocated so resuming is near-instant. Resuming a
+  // stopped engine starts it; enable(false) still tears everything down.
+  virtual void setPaused(bool paused) { enable(!paused); }
+  virtual bool paused() { return false; }
 
   // Callbacks
   virtual void setCallback(FftCallback cb) = 0;
   virtual void setWaveCallback(WaveCallback cb) = 0;
   virtual void setVuCallback(VuCallback cb) = 0;
+
+  // Waterfall history (optional; engines without an analyzer ignore it)
+  virtual void setSpectrogram(float seconds, bool rgba) {}
+  virtual void setSpectrogramColormap(const std::vector<uint8_t>& lut) {}
+  virtual bool spectrogramSnapshot(SpectrogramRows& out) { return false; }
+  virtual void setSpectrogramCallback(SpectrogramCallback cb) {}
+
+  // Named output profiles sharing the engine's FFT (optional)
+  virtual void setProfile(const std::string& name, const ProfileSpec& spec) {}
+  virtual void removeProfile(const std::string& name) {}
+  virtual void setProfileCallback(ProfileCallback cb) {}
+
+  // Pitch tracking on the captured signal, published once per hop (optional)
+  virtual void setPitchRange(float minHz, float maxHz) {}
+  virtual void setPitchCallback(PitchCallback cb) {}
+
+  // Phase correlation, balance and vectorscope points, published with VU (optional)
+  virtual void setStereoCallback(StereoCallback cb) {}
+
+  // Output of the built-in analysis modules, one frame per module per hop (optional)
+  virtual void setModuleCallback(ModuleCallback cb) {}
+
+  // Idle mode: stop analysing and publishing while the input is silent
+  virtual void setSilenceDetection(bool enabled, float thresholdDb, int holdMs) {}
+  virtual bool isIdle() { return false; }
+
+  // Automatic gain for spectrum levels; agcGainDb() is the gain applied now
+  virtual void setAgc(const AgcSettings& s) {}
+  virtual AgcSettings agc() { return AgcSettings(); }
+  virtual float agcGainDb() { return 0.0f; }
+
+  // Per-column percentile normalization of the main spectrum
+  virtual void setNormalizer(const NormalizerSettings& s) {}
+  virtual NormalizerSettings normalizer() { return NormalizerSettings(); }
+
+  // CPU governor: budget as a fraction of one core, 0 = fixed quality
+  virtual void setCpuBudget(float fraction) {}
+  virtual QualityInfo quality() { return QualityInfo(); }
+  // Decimates high capture rates towards hz before analysis; 0 = capture rate
+  virtual void setAnalysisRate(int hz) {}
+  // Which channel(s) the spectrum shows; dual doubles the spectrum width
+  virtual void setChannelMode(ChannelMode mode) {}
+  virtual ChannelMode channelMode() { return ChannelMode::Left; }
+
+  // Holds published frames back to match delayed stream audio (0..5000 ms)
+  virtual void setOutputDelayMs(int ms) {}
+  virtual int outputDelayMs() { return 0; }
+
+  // Spectrum log: record what was published, replay a range of a log through
+  // the callbacks. replayLog blocks until the range has played or stopReplay().
+  virtual void startLog(const std::string& path, bool logWave) {}
+  virtual void stopLog() {}
+  virtual void replayLog(const std::string& path, double fromMs, double toMs, double speed) {}
+  virtual void stopReplay() {}
+
+  // Diagnostics: per-node timing of the analysis graph (empty for engines without one)
+  virtual std::vector<TaskGraph::NodeStats> analyzerStats() { return {}; }
+
+  // Consumers register here; engines skip buffering and analysis for products
+  // nobody has acquired.
+  Demand& demand() { return demand_; }
+
+protected:
+  Demand demand_;
 };
@@ -0,0 +1,110 @@
+#include "batch_fft.h"
+#include "kiss_fft4.h"
+#include <algorithm>
+
+#if KISS_FFT4_AVAILABLE
+struct BatchFft::Simd {
+  kiss_fftr4_cfg cfg = nullptr;
+  __m128* in = nullptr;           // n samples, lane k = frame k
+  kiss_fft4_cpx* out = nullptr;   // n / 2 + 1 bins
+
+  explicit Simd(int n) {
+    cfg = kiss_fftr4_alloc(n, 0, nullptr, nullptr);
+    in = static_cast<__m128*>(_mm_malloc(sizeof(__m128) * n, 16));
+    out = static_cast<kiss_fft4_cpx*>(_mm_malloc(sizeof(kiss_fft4_cpx) * (n / 2 + 1), 16));
+  }
+
+  ~Simd() {
+    kiss_fft4_free(cfg);
+    _mm_free(in);
+    _mm_free(out);
+  }
+};
+#else
+struct BatchFft::Simd {};
+#endif
+
+BatchFft::~BatchFft() {
+  release();
+}
+
+bool BatchFft::simd() {
+  return KISS_FFT4_AVAILABLE != 0;
+}
+
+void BatchFft::release() {
+  kiss_fftr_free(real_);
+  kiss_fft_free(complex_);
+  real_ = nullptr;
+  complex_ = nullptr;
+  delete simd_;
+  simd_ = nullptr;
+  n_ = 0;
+}
+
+void BatchFft::configure(int n) {
+  if (n == n_) return;
+  release();
+  n_ = n;
+  real_ = kiss_fftr_alloc(n, 0, nullptr, nullptr);
+#if KISS_FFT4_AVAILABLE
+  simd_ = new Simd(n);
+#else
+  complex_ = kiss_fft_alloc(n, 0, nullptr, nullptr);
+  packed_.resize(n);
+  spectrum_.resize(n);
+#endif
+}
+
+void BatchFft::run(const float* const* in, int count, kiss_fft_cpx* const* out) {
+  count = std::min(count, (int)kMaxFrames);
+  if (count <= 0 || n_ == 0) return;
+  if (count == 1) {
+    kiss_fftr(real_, in[0], out[0]);
+    return;
+  }
+
+#if KISS_FFT4_AVAILABLE
+  // Transpose into lanes; idle lanes repeat the first frame rather than
+  // carrying stale data
+  const int n = n_;
+  float* lanes = reinterpret_cast<float*>(simd_->in);
+  for (int k = 0; k < 4; ++k) {
+    const float* src = in[k < count ? k : 0];
+    for (int i = 0; i < n; ++i) lanes[i * 4 + k] = src[i];
+  }
+  kiss_fftr4(simd_->cfg, simd_->in, simd_->out);
+  const float* bins = reinterpret_cast<const float*>(simd_->out);
+  const int m = n / 2 + 1;
+  for (int k = 0; k < count; ++k) {
+    kiss_fft_cpx* dst = out[k];
+    for (int j = 0; j < m; ++j) {
+      dst[j].r = bins[j * 8 + k];
+      dst[j].i = bins[j * 8 + 4 + k];
+    }
+  }
+#else
+  for (int k = 0; k + 1 < count; k += 2) runPair(in[k], in[k + 1], out[k], out[k + 1]);
+  if (count & 1) kiss_fftr(real_, in[count - 1], out[count - 1]);
+#endif
+}
+
+// Z = FFT(a + i b) holds both spectra: with W[k] = conj(Z[n - k]),
+// A[k] = (Z[k] + W[k]) / 2 and B[k] = (Z[k] - W[k]) / 2i
+void BatchFft::runPair(const float* a, const float* b, kiss_fft_cpx* outA, kiss_fft_cpx* outB) {
+  const int n = n_;
+  for (int i = 0; i < n; ++i) {
+    packed_[i].r = a[i];
+    packed_[i].i = b[i];
+  }
+  kiss_fft(complex_, packed_.data(), spectrum_.data());
+  const kiss_fft_cpx* z = spectrum_.data();
+  for (int j = 0; j <= n / 2; ++j) {
+    const kiss_fft_cpx p = z[j];
+    const kiss_fft_cpx q = z[(n - j) % n];
+    outA[j].r = 0.5f * (p.r + q.r);
+    outA[j].i = 0.5f * (p.i - q.i);
+    outB[j].r = 0.5f * (p.i + q.i);
+    outB[j].i = 0.5f * (q.r - p.r);
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+
+extern "C" {
+  #include "kiss_fftr.h"
+}
+
+// Up to four real FFTs of the same size in one pass.
+//
+// With kissfft's SIMD build (kiss_fft4.h) two to four frames are interleaved
+// into SSE lanes and transformed together, so a batch costs about as much as
+// one scalar transform. Without it two frames still share one transform,
+// packed as l + i r into a complex FFT and split by conjugate symmetry. A
+// single frame always takes the plain scalar path.
+class BatchFft {
+public:
+  static const int kMaxFrames = 4;
+
+  BatchFft() = default;
+  ~BatchFft();
+
+  BatchFft(const BatchFft&) = delete;
+  BatchFft& operator=(const BatchFft&) = delete;
+
+  // Allocates for n-point real transforms; n must be even.
+  void configure(int n);
+  int size() const { return n_; }
+
+  // in[k] holds n samples, out[k] receives n / 2 + 1 bins, for k < count
+  // (1..kMaxFrames). Does not allocate.
+  void run(const float* const* in, int count, kiss_fft_cpx* const* out);
+
+  // Whether batches go through the SIMD build on this platform.
+  static bool simd();
+
+private:
+  struct Simd;
+
+  void release();
+  void runPair(const float* a, const float* b, kiss_fft_cpx* outA, kiss_fft_cpx* outB);
+
+  int n_ = 0;
+  kiss_fftr_cfg real_ = nullptr;     // single frames
+  kiss_fft_cfg complex_ = nullptr;   // scalar pairs
+  std::vector<kiss_fft_cpx> packed_, spectrum_;
+  Simd* simd_ = nullptr;
+};
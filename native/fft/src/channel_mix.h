@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+
+// Which part of the capture the spectrum shows. Everything except Dual feeds
+// one signal; Dual analyses left and right side by side.
+enum class ChannelMode : int {
+  Left = 0,   // first channel (the historical behaviour)
+  Right,      // second channel
+  Mono,       // average of all channels
+  Mid,        // (L + R) / 2
+  Side,       // (L - R) / 2
+  Dual,       // left and right as two spectra
+};
+
+inline const char* channelModeName(ChannelMode m) {
+  switch (m) {
+    case ChannelMode::Left:  return "left";
+    case ChannelMode::Right: return "right";
+    case ChannelMode::Mono:  return "mono";
+    case ChannelMode::Mid:   return "mid";
+    case ChannelMode::Side:  return "side";
+    case ChannelMode::Dual:  return "dual";
+  }
+  return "left";
+}
+
+namespace channel_mix_detail {
+
+// One flat loop per mode. Inlined with a constant stride (stereo, mono) the
+// compiler turns them into paired loads and shuffles.
+inline void mixPair(const float* in, size_t frames, size_t c, size_t r, ChannelMode mode,
+                    float* out, float* out2) {
+  switch (mode) {
+    case ChannelMode::Left:
+      for (size_t i = 0; i < frames; ++i) out[i] = in[i * c];
+      break;
+    case ChannelMode::Right:
+      for (size_t i = 0; i < frames; ++i) out[i] = in[i * c + r];
+      break;
+    case ChannelMode::Mono:
+    case ChannelMode::Mid:
+      for (size_t i = 0; i < frames; ++i) out[i] = (in[i * c] + in[i * c + r]) * 0.5f;
+      break;
+    case ChannelMode::Side:
+      for (size_t i = 0; i < frames; ++i) out[i] = (in[i * c] - in[i * c + r]) * 0.5f;
+      break;
+    case ChannelMode::Dual:
+      for (size_t i = 0; i < frames; ++i) {
+        out[i] = in[i * c];
+        out2[i] = in[i * c + r];
+      }
+      break;
+  }
+}
+
+}  // namespace channel_mix_detail
+
+// Folds frames of interleaved audio into the analyzer input. Dual writes the
+// right channel to out2 as well; other modes leave out2 alone. On a mono
+// stream every mode reads the one channel (side is then silent). On
+// multichannel layouts left and right are the first two channels and mono
+// averages all of them.
+inline void mixChannels(const float* in, size_t frames, int channels, ChannelMode mode,
+                        float* out, float* out2) {
+  using channel_mix_detail::mixPair;
+  if (channels == 2) return mixPair(in, frames, 2, 1, mode, out, out2);
+  if (channels == 1) return mixPair(in, frames, 1, 0, mode, out, out2);
+  if (channels <= 0) return;
+
+  const size_t c = (size_t)channels;
+  if (mode != ChannelMode::Mono) return mixPair(in, frames, c, 1, mode, out, out2);
+
+  // Channel-outer so each pass is a plain strided add
+  const float k = 1.0f / channels;
+  for (size_t i = 0; i < frames; ++i) out[i] = in[i * c];
+  for (size_t ch = 1; ch < c; ++ch) {
+    for (size_t i = 0; i < frames; ++i) out[i] += in[i * c + ch];
+  }
+  for (size_t i = 0; i < frames; ++i) out[i] *= k;
+}
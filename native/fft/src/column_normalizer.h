@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+struct NormalizerSettings {
+  bool enabled = false;
+  float low = 0.05f;           // percentile mapped to 0, 0.01..0.49
+  float high = 0.95f;          // percentile mapped to 1, 0.51..0.99
+  float windowSeconds = 8.0f;  // roughly how long the estimates take to follow a change
+  float minRangeDb = 12.0f;    // never stretch less than this to the full height
+};
+
+// Rescales every column into its own recent dynamic range.
+//
+// Each column keeps a streaming estimate of two percentiles of its dB level
+// (stochastic approximation: step up by p * eta when the sample is above the
+// estimate, down by (1 - p) * eta otherwise, which settles where a fraction p
+// of samples lies below). That is two floats per column and O(1) per update,
+// so a frame costs O(columns) with fixed memory. The step scales with the
+// column's current range so the estimates move at the same relative pace for
+// quiet treble and loud bass.
+class ColumnNormalizer {
+public:
+  // The step is divided by the smaller tail (low or 1 - high), so neither may
+  // reach 0; the 0th and 100th percentiles are not trackable this way anyway.
+  static constexpr float kMinTail = 0.01f;
+
+  void setSettings(const NormalizerSettings& s) {
+    low_ = std::max(kMinTail, std::min(0.49f, s.low));
+    high_ = std::max(0.51f, std::min(1.0f - kMinTail, s.high));
+    windowSeconds_ = std::max(0.1f, s.windowSeconds);
+    minRangeDb_ = std::max(1.0f, s.minRangeDb);
+    enabled_ = s.enabled;
+  }
+
+  NormalizerSettings settings() const {
+    NormalizerSettings s;
+    s.enabled = enabled_;
+    s.low = low_;
+    s.high = high_;
+    s.windowSeconds = windowSeconds_;
+    s.minRangeDb = minRangeDb_;
+    return s;
+  }
+
+  bool enabled() const { return enabled_; }
+
+  // Capture thread; forgets the learned ranges.
+  void resize(int columns) {
+    lo_.assign(columns, 0.0f);
+    hi_.assign(columns, 0.0f);
+    primed_ = false;
+  }
+
+  // Capture thread, once per frame before apply().
+  void beginFrame(double hopSeconds) {
+    dt_ = hopSeconds;
+    lowP_ = low_;
+    highP_ = high_;
+    window_ = windowSeconds_;
+    minRange_ = minRangeDb_;
+  }
+
+  // Capture thread, once per frame after the columns were applied.
+  void endFrame() { primed_ = true; }
+
+  // Feeds column c's level and returns it mapped to 0..1 of that column's
+  // range (may leave 0..1 for outliers). dbFloor stays an absolute floor.
+  float apply(int c, double db, double dbFloor) {
+    float& lo = lo_[c];
+    float& hi = hi_[c];
+    if (!primed_) {
+      hi = (float)db;
+      lo = (float)(db - minRange_);
+    }
+
+    const double range = std::max<double>(hi - lo, minRange_);
+    const double eta = range * dt_ / (window_ * std::min(lowP_, 1.0 - highP_));
+    lo += (float)(db > lo ? eta * lowP_ : -eta * (1.0 - lowP_));
+    hi += (float)(db > hi ? eta * highP_ : -eta * (1.0 - highP_));
+
+    // A column that barely moves gets its top raised, so steady noise is
+    // not stretched to full height
+    if (db <= dbFloor) return 0.0f;
+    const double top = std::max<double>(hi, lo + minRange_);
+    const double bottom = std::max<double>(lo, dbFloor);
+    return (float)((db - bottom) / std::max(top - bottom, 1e-3));
+  }
+
+private:
+  std::atomic<bool> enabled_{false};
+  std::atomic<float> low_{0.05f};
+  std::atomic<float> high_{0.95f};
+  std::atomic<float> windowSeconds_{8.0f};
+  std::atomic<float> minRangeDb_{12.0f};
+
+  // Per-frame copies so one frame uses consistent settings
+  double dt_ = 0.0;
+  double lowP_ = 0.05, highP_ = 0.95, window_ = 8.0, minRange_ = 12.0;
+  std::vector<float> lo_, hi_;
+  bool primed_ = false;
+};
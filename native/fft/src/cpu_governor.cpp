@@ -0,0 +1,108 @@
+#include "cpu_governor.h"
+#include <algorithm>
+
+namespace {
+
+struct Rung {
+  int hopMul;
+  int fftDiv;
+  int columnStep;
+};
+
+// Cheapest knob first: a longer hop only lowers the frame rate, a smaller
+// FFT costs low-end resolution, grouping columns costs detail everywhere.
+const Rung kLadder[] = {
+  {1, 1, 1},
+  {2, 1, 1},
+  {2, 2, 1},
+  {4, 2, 2},
+  {4, 4, 2},
+  {8, 4, 4},
+};
+const int kLevels = sizeof(kLadder) / sizeof(kLadder[0]);
+
+const int kMinFft = 512;
+const double kLoadAlpha = 0.1;
+const double kStepDownDwell = 0.5;   // seconds on a rung before stepping down again
+const double kStepUpCalm = 3.0;      // seconds of headroom before stepping up
+const double kStepUpRatio = 0.35;    // "headroom": load under this share of the budget
+
+}  // namespace
+
+CpuGovernor::CpuGovernor() {}
+
+int CpuGovernor::levels() {
+  return kLevels;
+}
+
+void CpuGovernor::setBudget(float fraction) {
+  budget_ = std::max(0.0f, fraction);
+}
+
+void CpuGovernor::reset() {
+  level_ = 0;
+  load_ = 0.0f;
+  dwell_ = 0.0;
+  calm_ = 0.0;
+  primed_ = false;
+}
+
+bool CpuGovernor::record(double frameUs, double hopSeconds) {
+  if (hopSeconds <= 0.0) return false;
+
+  const float budget = budget_;
+  if (budget <= 0.0f) {
+    if (level_ == 0) return false;
+    reset();
+    return true;
+  }
+
+  const double share = frameUs * 1e-6 / hopSeconds;
+  const double load = primed_ ? load_ + kLoadAlpha * (share - load_) : share;
+  load_ = (float)load;
+  primed_ = true;
+  dwell_ += hopSeconds;
+
+  const int level = level_;
+  if (load > budget) {
+    calm_ = 0.0;
+    if (level + 1 < kLevels && dwell_ >= kStepDownDwell) {
+      level_ = level + 1;
+      dwell_ = 0.0;
+      primed_ = false;  // cost changes with the plan; start measuring afresh
+      return true;
+    }
+    return false;
+  }
+
+  calm_ = load < budget * kStepUpRatio ? calm_ + hopSeconds : 0.0;
+  if (level > 0 && calm_ >= kStepUpCalm) {
+    level_ = level - 1;
+    dwell_ = 0.0;
+    calm_ = 0.0;
+    primed_ = false;
+    return true;
+  }
+  return false;
+}
+
+BandPlan CpuGovernor::apply(const BandPlan& requested, int* columnStep) const {
+  const Rung& r = kLadder[std::max(0, std::min((int)level_, kLevels - 1))];
+  BandPlan p = requested;
+  p.fftSize = std::max(std::min(kMinFft, requested.fftSize), requested.fftSize / r.fftDiv);
+  p.hopSize = std::max(1, std::min(p.fftSize, requested.hopSize * r.hopMul));
+  if (columnStep) *columnStep = std::max(1, std::min(r.columnStep, requested.columns));
+  return p;
+}
+
+QualityInfo CpuGovernor::info(const BandPlan& requested) const {
+  QualityInfo q;
+  BandPlan p = apply(requested, &q.columnStep);
+  q.level = level_;
+  q.levels = kLevels;
+  q.load = load_;
+  q.budget = budget_;
+  q.fftSize = p.fftSize;
+  q.hopSize = p.hopSize;
+  return q;
+}
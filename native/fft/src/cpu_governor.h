@@ -0,0 +1,57 @@
+#pragma once
+#include "fft_bands.h"
+#include <atomic>
+
+// What the governor is currently running at; readable from any thread.
+struct QualityInfo {
+  int level = 0;          // 0 = requested plan, higher = cheaper
+  int levels = 1;         // number of rungs on the ladder
+  float load = 0.0f;      // analysis cost as a fraction of one core (EMA)
+  float budget = 0.0f;    // configured budget, 0 = governor off
+  int fftSize = 0;        // effective plan at this level
+  int hopSize = 0;
+  int columnStep = 1;     // adjacent columns computed as one band
+  int sampleRate = 0;     // analysis rate, after decimation
+};
+
+// Keeps the analyzer inside a CPU budget by walking a quality ladder.
+//
+// The analyzer reports the CPU time of every analysed frame (the node times
+// summed, whichever pool thread ran them) together with the hop duration;
+// their ratio is the share of a core spent on analysis.
+// When the smoothed share stays above the budget the governor steps down one
+// rung (larger hop, then smaller FFT, then coarser band groups); when it has
+// stayed well under the budget for a while it steps back up. The gap between
+// the two thresholds and a minimum dwell per rung keep it from oscillating.
+class CpuGovernor {
+public:
+  CpuGovernor();
+
+  // Fraction of one core, e.g. 0.05 for 5 %. 0 disables the governor and
+  // returns to the requested plan.
+  void setBudget(float fraction);
+  float budget() const { return budget_; }
+
+  int level() const { return level_; }
+  static int levels();
+
+  // Capture thread: one analysed frame took frameUs and covers hopSeconds of
+  // audio. Returns true when the level changed and the plan must be rebuilt.
+  bool record(double frameUs, double hopSeconds);
+
+  // Effective plan for the current level. Output width never changes;
+  // columnStep > 1 means that many adjacent columns share one band value.
+  BandPlan apply(const BandPlan& requested, int* columnStep) const;
+
+  QualityInfo info(const BandPlan& requested) const;
+
+  void reset();
+
+private:
+  std::atomic<float> budget_{0.0f};
+  std::atomic<int> level_{0};
+  std::atomic<float> load_{0.0f};
+  double dwell_ = 0.0;    // seconds spent on the current rung
+  double calm_ = 0.0;     // seconds the load has been low enough to step up
+  bool primed_ = false;
+};
@@ -0,0 +1,151 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// One 2:1 half-band decimation stage in polyphase form.
+//
+// A half-band FIR of length 4K-1 has every other tap zero except the centre
+// (0.5). Split the input into even and odd phases and the output becomes a
+// 2K-tap FIR over the even phase plus the odd phase delayed by K, scaled by
+// one half. The even-phase FIR runs tap by tap over a contiguous block of
+// outputs, so the inner loop vectorizes. All state is fixed-size.
+class HalfBandStage {
+public:
+  static const int kHalf = 16;                 // K; 63-tap prototype
+  static const int kTaps = 2 * kHalf;          // even-phase taps
+  static const int kBlock = 256;               // outputs per inner pass
+
+  HalfBandStage() {
+    design();
+    reset();
+  }
+
+  void reset() {
+    std::fill(even_, even_ + kTaps - 1 + kBlock, 0.0f);
+    std::fill(odd_, odd_ + kHalf + kBlock, 0.0f);
+    fill_ = 0;
+    pending_ = false;
+  }
+
+  // Consumes n input samples and writes one output per completed pair;
+  // returns how many. out must hold (n + 1) / 2 samples.
+  size_t process(const float* in, size_t n, float* out) {
+    size_t produced = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (!pending_) {
+        carry_ = in[i];
+        pending_ = true;
+        continue;
+      }
+      even_[kTaps - 1 + fill_] = carry_;
+      odd_[kHalf + fill_] = in[i];
+      pending_ = false;
+      if (++fill_ == kBlock) {
+        run(out + produced);
+        produced += kBlock;
+      }
+    }
+    if (fill_ > 0) {
+      const int n = fill_;
+      run(out + produced);
+      produced += n;
+    }
+    return produced;
+  }
+
+private:
+  // Windowed-sinc half-band (Blackman-Harris). Passband to ~0.21 fs and
+  // stopband from ~0.29 fs, so 20 kHz survives a 96 -> 48 kHz step and
+  // nothing from 28 kHz up folds back below it.
+  void design() {
+    const int length = 4 * kHalf - 1;
+    const int centre = length / 2;
+    const double pi = 3.14159265358979323846;
+    double sum = 0.0;
+    for (int j = 0; j < kTaps; ++j) {
+      const int t = 2 * j - centre;  // odd offset from the centre
+      const double w = 2.0 * pi * (2 * j) / (length - 1);
+      const double window = 0.35875 - 0.48829 * std::cos(w) + 0.14128 * std::cos(2 * w) -
+                            0.01168 * std::cos(3 * w);
+      const double h = std::sin(pi * t / 2.0) / (pi * t) * window;
+      taps_[j] = (float)h;
+      sum += h;
+    }
+    // The even-phase taps sum to one half for unity gain at DC
+    for (int j = 0; j < kTaps; ++j) taps_[j] = (float)(taps_[j] * 0.5 / sum);
+  }
+
+  // Computes fill_ outputs from the buffered phases and slides the history
+  void run(float* out) {
+    const int n = fill_;
+    for (int p = 0; p < n; ++p) out[p] = 0.5f * odd_[p];
+    for (int j = 0; j < kTaps; ++j) {
+      const float g = taps_[j];
+      const float* e = even_ + kTaps - 1 - j;
+      for (int p = 0; p < n; ++p) out[p] += g * e[p];
+    }
+    std::memmove(even_, even_ + n, sizeof(float) * (kTaps - 1));
+    std::memmove(odd_, odd_ + n, sizeof(float) * kHalf);
+    fill_ = 0;
+  }
+
+  float taps_[kTaps];
+  float even_[kTaps - 1 + kBlock];  // history, then the current block
+  float odd_[kHalf + kBlock];
+  int fill_ = 0;
+  float carry_ = 0.0f;
+  bool pending_ = false;
+};
+
+// Cascade of half-band stages bringing a high capture rate down towards a
+// target analysis rate. Stages are added while the halved rate stays at or
+// above the target and at or above 40 kHz, so the displayed range (up to
+// 20 kHz) is never cut. A target of 0 disables decimation.
+class Decimator {
+public:
+  static const int kMaxStages = 3;             // 384 kHz -> 48 kHz
+  static const int kChunk = 1024;              // input samples per pass
+
+  void configure(int inputRate, int targetRate) {
+    inputRate_ = inputRate;
+    stages_ = 0;
+    int rate = inputRate;
+    while (targetRate > 0 && stages_ < kMaxStages && rate / 2 >= std::max(targetRate, 40000)) {
+      rate /= 2;
+      ++stages_;
+    }
+    outputRate_ = rate;
+    reset();
+  }
+
+  void reset() {
+    for (auto& s : stage_) s.reset();
+  }
+
+  int stages() const { return stages_; }
+  int factor() const { return 1 << stages_; }
+  int inputRate() const { return inputRate_; }
+  int outputRate() const { return outputRate_; }
+
+  // Decimates up to kChunk input samples into out (kChunk / 2 + 1 floats);
+  // returns the number of outputs.
+  size_t process(const float* in, size_t n, float* out) {
+    const float* src = in;
+    size_t count = std::min<size_t>(n, kChunk);
+    for (int s = 0; s < stages_; ++s) {
+      float* dst = (s == stages_ - 1) ? out : scratch_[s & 1];
+      count = stage_[s].process(src, count, dst);
+      src = dst;
+    }
+    return count;
+  }
+
+private:
+  HalfBandStage stage_[kMaxStages];
+  float scratch_[2][kChunk / 2 + 1];
+  int stages_ = 0;
+  int inputRate_ = 0;
+  int outputRate_ = 0;
+};
@@ -0,0 +1,66 @@
+#include "delay_line.h"
+#include <algorithm>
+
+DelayLine::~DelayLine() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    quit_ = true;
+  }
+  wake_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+void DelayLine::setDelayMs(int ms) {
+  ms = std::max(0, std::min(ms, kMaxDelayMs));
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    delayMs_ = ms;
+    if (ms == 0) {
+      for (auto& l : lanes_) l->clear();
+      queued_ = 0;
+    } else {
+      // Grow lanes ahead of a longer delay here rather than on the producer
+      if (ms > sizedMs_) {
+        for (auto& l : lanes_) l->reserve(l->capacity() * slotsFor(ms) / slotsFor(sizedMs_));
+        sizedMs_ = ms;
+      }
+      if (!thread_.joinable()) thread_ = std::thread(&DelayLine::releaseLoop, this);
+    }
+  }
+  wake_.notify_all();
+}
+
+void DelayLine::clear() {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto& l : lanes_) l->clear();
+  queued_ = 0;
+}
+
+void DelayLine::releaseLoop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!quit_) {
+    LaneBase* next = nullptr;
+    for (auto& l : lanes_) {
+      if (!l->empty() && (!next || l->front() < next->front())) next = l.get();
+    }
+    if (!next) {
+      sleepUntil_ = Clock::time_point::max();
+      wake_.wait(lock);
+      continue;
+    }
+
+    // Re-evaluated on every wake so a delay change applies to queued frames
+    const auto due = next->front() + std::chrono::milliseconds(delayMs_.load());
+    if (Clock::now() < due) {
+      sleepUntil_ = due;
+      wake_.wait_until(lock, due);
+      continue;
+    }
+
+    next->take();
+    --queued_;
+    lock.unlock();
+    next->deliver();
+    lock.lock();
+  }
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Holds published frames back by a fixed delay so the overlay lines up with
+// stream audio that OBS delays for A/V sync.
+//
+// Every frame carries the capture time of its newest sample and is released
+// at exactly that time + delay by a dedicated thread sleeping on
+// wait_until, so the delay is accurate to the timestamp rather than to a
+// publish tick. With a delay of 0 frames go straight through on the
+// producing thread and nothing is queued or copied.
+//
+// Each callback gets its own lane: a ring of slots sized for the delay, so
+// one busy product cannot push another's frames out. Values are copied into
+// recycled slots and handed back by swap, so once every slot has held a
+// frame the producer neither allocates nor spawns anything per frame.
+class DelayLine {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static const int kMaxDelayMs = 5000;
+
+  DelayLine() = default;
+  ~DelayLine();
+
+  DelayLine(const DelayLine&) = delete;
+  DelayLine& operator=(const DelayLine&) = delete;
+
+  // Clamped to 0..kMaxDelayMs. Frames already queued move with the delay;
+  // going back to 0 drops them, since new frames would overtake them.
+  void setDelayMs(int ms);
+  int delayMs() const { return delayMs_; }
+
+  // Delivers value to cb at t + delay. cb must outlive the delay line; it is
+  // called through the reference, so a callback replaced meanwhile gets the
+  // frames still queued.
+  template <typename Cb, typename T>
+  void emit(const Cb& cb, T&& value, Clock::time_point t) {
+    if (!cb) return;
+    if (delayMs_ == 0) {
+      cb(value);
+      return;
+    }
+    using V = typename std::decay<T>::type;
+    bool wake = false;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (quit_ || delayMs_ == 0) return;
+      if (lane<Cb, V>(cb).push(t, std::forward<T>(value))) ++queued_;
+      // The release thread usually sleeps until an earlier frame already
+      const auto due = t + std::chrono::milliseconds(delayMs_.load());
+      if (due < sleepUntil_) {
+        sleepUntil_ = due;
+        wake = true;
+      }
+    }
+    if (wake) wake_.notify_one();
+  }
+
+  // Drops everything still queued (stream stopped or device changed).
+  void clear();
+
+private:
+  class LaneBase {
+  public:
+    virtual ~LaneBase() = default;
+    virtual bool empty() const = 0;
+    virtual Clock::time_point front() const = 0;
+    virtual void take() = 0;      // front into the lane's scratch, under mu_
+    virtual void deliver() = 0;   // scratch to the callback, without mu_
+    virtual void reserve(size_t slots) = 0;
+    virtual size_t capacity() const = 0;
+    virtual void clear() = 0;
+
+    const void* key = nullptr;
+    const void* type = nullptr;
+  };
+
+  template <typename Cb, typename T>
+  class Lane : public LaneBase {
+  public:
+    Lane(const Cb& cb, size_t slots) : cb_(cb), slots_(slots) {}
+
+    bool empty() const override { return count_ == 0; }
+    Clock::time_point front() const override { return slots_[head_].t; }
+    size_t capacity() const override { return slots_.size(); }
+    void clear() override { head_ = count_ = 0; }
+
+    // Returns false when the frame replaced the oldest one of a full lane.
+    template <typename U>
+    bool push(Clock::time_point t, U&& value) {
+      bool added = true;
+      if (count_ == slots_.size()) {
+        if (slots_.size() < kMaxSlots) {
+          reserve(slots_.size() * 2);
+        } else {
+          head_ = (head_ + 1) % slots_.size();
+          --count_;
+          added = false;
+        }
+      }
+      Slot& s = slots_[(head_ + count_) % slots_.size()];
+      s.t = t;
+      s.value = std::forward<U>(value);
+      ++count_;
+      return added;
+    }
+
+    void take() override {
+      using std::swap;
+      swap(out_, slots_[head_].value);
+      head_ = (head_ + 1) % slots_.size();
+      --count_;
+    }
+
+    void deliver() override {
+      if (cb_) cb_(out_);
+    }
+
+    void reserve(size_t slots) override {
+      if (slots <= slots_.size()) return;
+      std::vector<Slot> grown(slots);
+      for (size_t i = 0; i < count_; ++i) {
+        grown[i] = std::move(slots_[(head_ + i) % slots_.size()]);
+      }
+      slots_.swap(grown);
+      head_ = 0;
+    }
+
+  private:
+    struct Slot {
+      Clock::time_point t;
+      T value;
+    };
+
+    const Cb& cb_;
+    std::vector<Slot> slots_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    T out_;
+  };
+
+  template <typename T>
+  static const void* typeTag() {
+    static const char tag = 0;
+    return &tag;
+  }
+
+  // Under mu_. Only the first frame of a product creates its lane.
+  template <typename Cb, typename T>
+  Lane<Cb, T>& lane(const Cb& cb) {
+    for (auto& l : lanes_) {
+      if (l->key == &cb && l->type == typeTag<T>()) return static_cast<Lane<Cb, T>&>(*l);
+    }
+    auto* l = new Lane<Cb, T>(cb, slotsFor(sizedMs_));
+    l->key = &cb;
+    l->type = typeTag<T>();
+    lanes_.emplace_back(l);
+    return *l;
+  }
+
+  // Slots for ms of frames from one product at the fastest hop rate
+  // (256-sample hops at 96 kHz). Products that publish several frames per
+  // hop (profiles, modules) double their lane until it fits.
+  static size_t slotsFor(int ms) { return size_t(ms) * 400 / 1000 + 16; }
+
+  void releaseLoop();
+
+  // Bounds memory if the release side stalls; a lane then drops its oldest
+  static const size_t kMaxSlots = 1 << 16;
+
+  std::mutex mu_;
+  std::condition_variable wake_;
+  std::vector<std::unique_ptr<LaneBase>> lanes_;
+  size_t queued_ = 0;   // frames across all lanes
+  int sizedMs_ = 0;     // longest delay the lanes have been sized for
+  Clock::time_point sleepUntil_ = Clock::time_point::max();
+  std::thread thread_;
+  bool quit_ = false;
+  std::atomic<int> delayMs_{0};
+};
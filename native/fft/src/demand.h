@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Outputs an engine can produce. Each one is only computed while something
+// consumes it.
+enum class Product : int { Fft = 0, Wave, Vu, Spectrogram, Profiles, Pitch, Stereo, Modules, Count };
+
+// Reference-counted registry of consumers per product.
+//
+// Consumers (bridge callbacks, the spectrogram history, ...) acquire a product
+// while they need it and release it when they go away. The capture thread
+// polls wants() once per block, so switching a product on or off takes effect
+// on the next block without restarting the stream.
+class Demand {
+public:
+  Demand() {
+    for (auto& c : counts_) c = 0;
+  }
+
+  void acquire(Product p) { counts_[(int)p].fetch_add(1); }
+
+  void release(Product p) {
+    auto& c = counts_[(int)p];
+    int cur = c.load();
+    while (cur > 0 && !c.compare_exchange_weak(cur, cur - 1)) {}
+  }
+
+  // Acquire or release according to a consumer's on/off state change.
+  void set(Product p, bool had, bool has) {
+    if (has && !had) acquire(p);
+    else if (had && !has) release(p);
+  }
+
+  bool wants(Product p) const { return counts_[(int)p].load(std::memory_order_relaxed) > 0; }
+
+  // Bit i set when product i has at least one consumer.
+  uint32_t mask() const {
+    uint32_t m = 0;
+    for (int i = 0; i < (int)Product::Count; ++i) {
+      if (counts_[i].load(std::memory_order_relaxed) > 0) m |= 1u << i;
+    }
+    return m;
+  }
+
+private:
+  std::atomic<int> counts_[(int)Product::Count];
+};
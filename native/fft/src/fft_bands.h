@@ -30,4 +30,33 @@ inline BinMap makeBinMap(int sampleRate, int fftSize, int columns) {
     m.start[b] = s; m.end[b] = e;
   }
   return m;
-}
\ No newline at end of file
+}
+
+// Same band edges as makeBinMap, but the centers are sampled evenly from the
+// whole table so any column count spans 20 Hz .. Nyquist.
+inline BinMap makeSpreadBinMap(int sampleRate, int fftSize, int columns) {
+  if (columns >= 256) return makeBinMap(sampleRate, fftSize, columns);
+  std::vector<double> centers(columns);
+  for (int b = 0; b < columns; ++b) {
+    double pos = columns > 1 ? double(b) * 255.0 / double(columns - 1) : 0.0;
+    int i = int(pos);
+    double frac = pos - i;
+    centers[b] = i >= 255 ? kBandCenters[255]
+                          : kBandCenters[i] * std::pow(kBandCenters[i + 1] / kBandCenters[i], frac);
+  }
+
+  int halfBins = fftSize / 2;
+  double binWidth = double(sampleRate) / double(fftSize);
+  BinMap m; m.start.resize(columns); m.end.resize(columns);
+  for (int b = 0; b < columns; ++b) {
+    double fLo = b == 0 ? 0.0 : std::sqrt(centers[b-1] * centers[b]);
+    double fHi = b == columns-1 ? sampleRate/2.0 - 1.0 : std::sqrt(centers[b] * centers[b+1]);
+    int s = int(std::floor(fLo / binWidth));
+    int e = int(std::ceil (fHi / binWidth));
+    if (s < 0) s = 0;
+    if (e > halfBins) e = halfBins;
+    if (e <= s) e = s + 1;
+    m.start[b] = s; m.end[b] = e;
+  }
+  return m;
+}
@@ -0,0 +1,41 @@
+#pragma once
+/* kissfft built with USE_SIMD: kiss_fft_scalar is __m128 and every call runs
+   four independent transforms, one per lane. kiss_fft_simd.c compiles it a
+   second time under these renamed symbols so it links next to the scalar
+   build. The SIMD sources use operators on __m128, which only GCC and Clang
+   accept; elsewhere KISS_FFT4_AVAILABLE is 0 and nothing is declared. */
+
+#if (defined(__SSE__) || defined(__x86_64__)) && (defined(__GNUC__) || defined(__clang__))
+# define KISS_FFT4_AVAILABLE 1
+#else
+# define KISS_FFT4_AVAILABLE 0
+#endif
+
+/* kiss_fft_simd.c gets its declarations from kissfft itself */
+#if KISS_FFT4_AVAILABLE && !defined(KISS_FFT4_IMPL)
+#include <stddef.h>
+#include <xmmintrin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lane k of r/i belongs to transform k */
+typedef struct {
+  __m128 r;
+  __m128 i;
+} kiss_fft4_cpx;
+
+typedef struct kiss_fftr4_state* kiss_fftr4_cfg;
+
+kiss_fftr4_cfg kiss_fftr4_alloc(int nfft, int inverse_fft, void* mem, size_t* lenmem);
+/* timedata: nfft samples of four signals, lane-interleaved;
+   freqdata: nfft / 2 + 1 bins */
+void kiss_fftr4(kiss_fftr4_cfg cfg, const __m128* timedata, kiss_fft4_cpx* freqdata);
+/* Releases anything the SIMD build allocated (16-byte aligned) */
+void kiss_fft4_free(void* p);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,30 @@
+/* Four-lane SIMD build of kissfft; see kiss_fft4.h. */
+#define KISS_FFT4_IMPL
+#include "kiss_fft4.h"
+
+#if KISS_FFT4_AVAILABLE
+#define USE_SIMD 1
+#define kiss_fft_state kiss_fft4_state
+#define kiss_fftr_state kiss_fftr4_state
+#define kiss_fft_cpx kiss_fft4_cpx
+#define kiss_fft_cfg kiss_fft4_cfg
+#define kiss_fftr_cfg kiss_fftr4_cfg
+#define kiss_fft_alloc kiss_fft4_alloc
+#define kiss_fft kiss_fft4
+#define kiss_fft_stride kiss_fft4_stride
+#define kiss_fft_cleanup kiss_fft4_cleanup
+#define kiss_fft_next_fast_size kiss_fft4_next_fast_size
+#define kiss_fftr_alloc kiss_fftr4_alloc
+#define kiss_fftr kiss_fftr4
+#define kiss_fftri kiss_fftri4
+
+#include "kiss_fft.c"
+#include "kiss_fftr.c"
+
+void kiss_fft4_free(void* p) {
+  KISS_FFT_FREE(p);
+}
+#else
+/* ISO C wants at least one declaration per translation unit */
+typedef int kiss_fft_simd_unavailable;
+#endif
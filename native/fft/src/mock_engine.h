@@ -146,7 +146,7 @@ private:
         while (running_) {
             // Generate mock FFT data (smooth animated bars)
             if (fftCallback_) {
-                std::vector<uint8_t> spectrum(columns_);
+                std::vector<float> spectrum(columns_);
 
                 for (size_t i = 0; i < columns_; ++i) {
                     // Create smooth wave pattern with some randomness
@@ -158,7 +158,7 @@ private:
                     // Decay towards higher frequencies (more realistic)
                     value *= std::exp(-i * 0.015);
 
-                    spectrum[i] = static_cast<uint8_t>(value * 255);
+                    spectrum[i] = static_cast<float>(value);
                 }
 
                 fftCallback_(spectrum);
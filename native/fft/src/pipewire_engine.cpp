@@ -6,64 +6,45 @@
 #include <chrono>
 #include <algorithm>
 
-#define _USE_MATH_DEFINES
-constexpr double kPI = 3.14159265358979323846;
-
-extern "C" {
-  #include "kiss_fftr.h"
+// pw_init()/pw_deinit() set up process-wide state. Engines can live on
+// several threads at once (one bridge per worker_threads Worker), so the
+// library is brought up by the first and torn down by the last.
+static std::mutex pwLibraryMutex;
+static int pwLibraryUsers = 0;
+
+static void acquirePipeWireLibrary() {
+  std::lock_guard<std::mutex> lock(pwLibraryMutex);
+  if (pwLibraryUsers++ == 0) pw_init(nullptr, nullptr);
 }
 
-struct PipeWireEngine::Kiss {
-  kiss_fftr_cfg cfg = nullptr;
-  std::vector<float> in;
-  std::vector<kiss_fft_cpx> out;
-};
+static void releasePipeWireLibrary() {
+  std::lock_guard<std::mutex> lock(pwLibraryMutex);
+  if (--pwLibraryUsers == 0) pw_deinit();
+}
 
 PipeWireEngine::PipeWireEngine() {
-  // Initialize PipeWire
-  pw_init(nullptr, nullptr);
-
-  // Create threaded loop
-  loop_ = pw_thread_loop_new("FFT Audio", nullptr);
-  if (!loop_) {
-    throw std::runtime_error("Failed to create PipeWire thread loop");
-  }
-
-  // Create context
-  context_ = pw_context_new(pw_thread_loop_get_loop(loop_), nullptr, 0);
-  if (!context_) {
-    pw_thread_loop_destroy(loop_);
-    throw std::runtime_error("Failed to create PipeWire context");
-  }
-
-  // Start the loop
-  if (pw_thread_loop_start(loop_) < 0) {
-    pw_context_destroy(context_);
-    pw_thread_loop_destroy(loop_);
-    throw std::runtime_error("Failed to start PipeWire thread loop");
-  }
-  loopRunning_ = true;
-
-  pw_thread_loop_lock(loop_);
-
-  // Create core
-  core_ = pw_context_connect(context_, nullptr, 0);
-  if (!core_) {
-    pw_thread_loop_unlock(loop_);
-    pw_thread_loop_stop(loop_);
-    pw_context_destroy(context_);
-    pw_thread_loop_destroy(loop_);
-    throw std::runtime_error("Failed to connect to PipeWire");
-  }
-
-  coreReady_ = true;
-  std::cerr << "PipeWire engine initialized successfully" << std::endl;
+  analyzer_.setTilt(tiltExp_);
+  analyzer_.setFrameCallback([this](const AnalysisFrame& f) {
+    if (replaying_) return;
+    if (demand_.wants(Product::Fft)) {
+      if (log_.isOpen()) log_.appendSpectrum(f.time, f.spectrum.data(), f.spectrum.size());
+      delay_.emit(cb_, f.spectrum, f.time);
+    }
+    if (demand_.wants(Product::Profiles)) {
+      for (const auto& p : f.profiles) delay_.emit(profileCb_, p, f.time);
+    }
+    if (demand_.wants(Product::Pitch)) delay_.emit(pitchCb_, f.pitch, f.time);
+    if (demand_.wants(Product::Modules)) {
+      for (const auto& m : f.modules) delay_.emit(moduleCb_, m, f.time);
+    }
+  });
 
-  pw_thread_loop_unlock(loop_);
+  // PipeWire itself is brought up by initialize(), on first use at the latest
 }
 
 PipeWireEngine::~PipeWireEngine() {
   enable(false);
+  if (!pwInitialized_) return;
 
   if (loop_ && loopRunning_) {
     pw_thread_loop_stop(loop_);
@@ -82,7 +63,7 @@ PipeWireEngine::~PipeWireEngine() {
     pw_thread_loop_destroy(loop_);
   }
 
-  pw_deinit();
+  releasePipeWireLibrary();
 }
 
 static const struct pw_registry_events registryEvents = {
@@ -130,9 +111,89 @@ void PipeWireEngine::onRegistryGlobalRemove(void* data, uint32_t id) {
   // Device removed - we could handle this but for now just ignore
 }
 
+static const struct pw_core_events coreEvents = {
+  PW_VERSION_CORE_EVENTS,
+  .done = PipeWireEngine::onCoreDone,
+};
+
+void PipeWireEngine::onCoreDone(void* data, uint32_t id, int seq) {
+  auto* engine = static_cast<PipeWireEngine*>(data);
+  if (id == PW_ID_CORE && seq == engine->syncSeq_) {
+    engine->syncDone_ = true;
+    pw_thread_loop_signal(engine->loop_, false);
+  }
+}
+
+void PipeWireEngine::initialize() {
+  std::lock_guard<std::mutex> lock(initMutex_);
+  if (coreReady_) {
+    // stop() parks the loop; the core stays connected, so restarting it is
+    // enough for the next stream or registry roundtrip
+    if (!loopRunning_) {
+      if (pw_thread_loop_start(loop_) < 0) {
+        throw std::runtime_error("Failed to restart PipeWire thread loop");
+      }
+      loopRunning_ = true;
+    }
+    return;
+  }
+
+  if (!pwInitialized_) {
+    acquirePipeWireLibrary();
+    pwInitialized_ = true;
+  }
+
+  // Create threaded loop
+  loop_ = pw_thread_loop_new("FFT Audio", nullptr);
+  if (!loop_) {
+    throw std::runtime_error("Failed to create PipeWire thread loop");
+  }
+
+  // Create context
+  context_ = pw_context_new(pw_thread_loop_get_loop(loop_), nullptr, 0);
+  if (!context_) {
+    pw_thread_loop_destroy(loop_);
+    loop_ = nullptr;
+    throw std::runtime_error("Failed to create PipeWire context");
+  }
+
+  // Start the loop
+  if (pw_thread_loop_start(loop_) < 0) {
+    pw_context_destroy(context_);
+    pw_thread_loop_destroy(loop_);
+    context_ = nullptr;
+    loop_ = nullptr;
+    throw std::runtime_error("Failed to start PipeWire thread loop");
+  }
+  loopRunning_ = true;
+
+  pw_thread_loop_lock(loop_);
+
+  // Create core
+  core_ = pw_context_connect(context_, nullptr, 0);
+  if (!core_) {
+    pw_thread_loop_unlock(loop_);
+    pw_thread_loop_stop(loop_);
+    pw_context_destroy(context_);
+    pw_thread_loop_destroy(loop_);
+    loopRunning_ = false;
+    context_ = nullptr;
+    loop_ = nullptr;
+    throw std::runtime_error("Failed to connect to PipeWire");
+  }
+  pw_core_add_listener(core_, &coreListener_, &coreEvents, this);
+
+  coreReady_ = true;
+  std::cerr << "PipeWire engine initialized successfully" << std::endl;
+
+  pw_thread_loop_unlock(loop_);
+}
+
 std::vector<DeviceInfo> PipeWireEngine::listDevices() {
-  if (!coreReady_) {
-    std::cerr << "PipeWire core not ready" << std::endl;
+  try {
+    initialize();
+  } catch (const std::exception& e) {
+    std::cerr << "PipeWire core not ready: " << e.what() << std::endl;
     return {};
   }
 
@@ -154,11 +215,16 @@ std::vector<DeviceInfo> PipeWireEngine::listDevices() {
 
   pw_registry_add_listener(registry_, &registryListener_, &registryEvents, this);
 
-  // Wait a bit for the registry to populate
-  // PipeWire is async, so we need to give it time to enumerate
-  pw_thread_loop_unlock(loop_);
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  pw_thread_loop_lock(loop_);
+  // One core roundtrip: the server answers the sync only after it has sent
+  // every global that existed when the registry was bound
+  syncDone_ = false;
+  syncSeq_ = pw_core_sync(core_, PW_ID_CORE, 0);
+  while (!syncDone_) {
+    if (pw_thread_loop_timed_wait(loop_, kSyncTimeoutSec) != 0) {
+      std::cerr << "PipeWire registry sync timed out" << std::endl;
+      break;
+    }
+  }
 
   // Clean up registry
   pw_proxy_destroy(reinterpret_cast<struct pw_proxy*>(registry_));
@@ -171,22 +237,27 @@ std::vector<DeviceInfo> PipeWireEngine::listDevices() {
 }
 
 bool PipeWireEngine::setDevice(const std::string& deviceId) {
-  if (running_) {
-    stop();
-  }
-
-  currentDeviceId_ = deviceId;
+  DeviceInfo::Flow flow = currentFlow_;
+  std::string name = deviceId;
 
   // Find device info in map to determine flow
   {
     std::lock_guard<std::mutex> lock(deviceListMutex_);
     auto it = deviceMap_.find(deviceId);
     if (it != deviceMap_.end()) {
-      currentFlow_ = it->second.flow;
-      currentDeviceName_ = it->second.name;
+      flow = it->second.flow;
+      name = it->second.name;
     }
   }
 
+  // A running engine switches live and keeps the old device on failure
+  if (running_ && !switchDevice(deviceId, flow)) {
+    return false;
+  }
+
+  currentDeviceId_ = deviceId;
+  currentFlow_ = flow;
+  currentDeviceName_ = name;
   return true;
 }
 
@@ -198,39 +269,197 @@ DeviceInfo PipeWireEngine::currentDevice() {
   return di;
 }
 
-void PipeWireEngine::setFftSize(int fft) { plan_.fftSize = fft; }
-void PipeWireEngine::setHopSize(int hop) { plan_.hopSize = hop; }
+void PipeWireEngine::setFftSize(int fft) {
+  plan_.fftSize = fft;
+  analyzer_.requestPlan(plan_);
+}
+void PipeWireEngine::setHopSize(int hop) {
+  plan_.hopSize = hop;
+  analyzer_.requestPlan(plan_);
+}
 void PipeWireEngine::setColumns(int c) {
   plan_.columns = std::max(1, std::min(c, 256));
-  if (sampleRate_ > 0) {
-    binmap_ = makeBinMap(sampleRate_, plan_.fftSize, plan_.columns);
-  }
+  analyzer_.requestPlan(plan_);
+}
+void PipeWireEngine::setDbFloor(float db) {
+  plan_.dbFloor = db;
+  analyzer_.requestPlan(plan_);
+}
+void PipeWireEngine::setMasterGain(float g) {
+  masterGain_ = g;
+  analyzer_.setMasterGain(g);
+}
+void PipeWireEngine::setTilt(float exp) {
+  tiltExp_ = exp;
+  analyzer_.setTilt(exp);
 }
-void PipeWireEngine::setDbFloor(float db) { plan_.dbFloor = db; }
-void PipeWireEngine::setMasterGain(float g) { masterGain_ = g; }
-void PipeWireEngine::setTilt(float exp) { tiltExp_ = exp; }
 void PipeWireEngine::setLoopback(bool on) { loopback_ = on; }
 void PipeWireEngine::setCallback(FftCallback cb) { cb_ = std::move(cb); }
 void PipeWireEngine::setWaveCallback(WaveCallback cb) { waveCb_ = std::move(cb); }
 void PipeWireEngine::setVuCallback(VuCallback cb) { vuCb_ = std::move(cb); }
+void PipeWireEngine::setStereoCallback(StereoCallback cb) { stereoCb_ = std::move(cb); }
+
+void PipeWireEngine::setSpectrogram(float seconds, bool rgba) {
+  demand_.set(Product::Spectrogram, spectrogramSeconds_ > 0.0f, seconds > 0.0f);
+  spectrogramSeconds_ = seconds;
+  analyzer_.spectrogram().setRgba(rgba);
+  analyzer_.setSpectrogramSeconds(seconds);
+}
+void PipeWireEngine::setSpectrogramColormap(const std::vector<uint8_t>& lut) {
+  analyzer_.spectrogram().setColormap(lut.data(), lut.size());
+}
+bool PipeWireEngine::spectrogramSnapshot(SpectrogramRows& out) {
+  return analyzer_.spectrogram().snapshot(out);
+}
+void PipeWireEngine::setSpectrogramCallback(SpectrogramCallback cb) { spectrogramCb_ = std::move(cb); }
+
+void PipeWireEngine::setProfile(const std::string& name, const ProfileSpec& spec) {
+  analyzer_.setProfile(name, spec);
+}
+void PipeWireEngine::removeProfile(const std::string& name) {
+  analyzer_.removeProfile(name);
+}
+void PipeWireEngine::setProfileCallback(ProfileCallback cb) { profileCb_ = std::move(cb); }
+void PipeWireEngine::setModuleCallback(ModuleCallback cb) { moduleCb_ = std::move(cb); }
+void PipeWireEngine::setPitchRange(float minHz, float maxHz) {
+  analyzer_.setPitchRange(minHz, maxHz);
+}
+void PipeWireEngine::setPitchCallback(PitchCallback cb) { pitchCb_ = std::move(cb); }
+
+std::vector<TaskGraph::NodeStats> PipeWireEngine::analyzerStats() {
+  return analyzer_.nodeStats();
+}
+
+void PipeWireEngine::setSilenceDetection(bool enabled, float thresholdDb, int holdMs) {
+  silence_.setThresholdDb(thresholdDb);
+  silence_.setHoldMs(holdMs);
+  silence_.setEnabled(enabled);
+}
+
+bool PipeWireEngine::isIdle() {
+  return analyzer_.idle();
+}
+
+void PipeWireEngine::setCpuBudget(float fraction) {
+  analyzer_.setCpuBudget(fraction);
+}
+
+QualityInfo PipeWireEngine::quality() {
+  return analyzer_.quality();
+}
+
+void PipeWireEngine::setAnalysisRate(int hz) {
+  analyzer_.setDecimation(hz);
+}
+
+void PipeWireEngine::setChannelMode(ChannelMode mode) {
+  channelMode_ = mode;
+  analyzer_.setDual(mode == ChannelMode::Dual);
+}
+
+ChannelMode PipeWireEngine::channelMode() {
+  return channelMode_;
+}
+
+void PipeWireEngine::setAgc(const AgcSettings& s) {
+  analyzer_.setAgc(s);
+}
+
+AgcSettings PipeWireEngine::agc() {
+  return analyzer_.agc();
+}
+
+float PipeWireEngine::agcGainDb() {
+  return analyzer_.agcGainDb();
+}
+
+void PipeWireEngine::setNormalizer(const NormalizerSettings& s) {
+  analyzer_.setNormalizer(s);
+}
+
+NormalizerSettings PipeWireEngine::normalizer() {
+  return analyzer_.normalizer();
+}
+
+void PipeWireEngine::setOutputDelayMs(int ms) {
+  delay_.setDelayMs(ms);
+}
+
+int PipeWireEngine::outputDelayMs() {
+  return delay_.delayMs();
+}
+
+void PipeWireEngine::startLog(const std::string& path, bool logWave) {
+  stopLog();
+  log_.open(path, sampleRate_, plan_.columns, logWave);
+  // The log is a consumer in its own right
+  demand_.acquire(Product::Fft);
+  demand_.acquire(Product::Vu);
+  if (logWave) demand_.acquire(Product::Wave);
+}
+
+void PipeWireEngine::stopLog() {
+  if (!log_.isOpen()) return;
+  demand_.release(Product::Fft);
+  demand_.release(Product::Vu);
+  if (log_.logsWave()) demand_.release(Product::Wave);
+  log_.close();
+}
+
+void PipeWireEngine::replayLog(const std::string& path, double fromMs, double toMs, double speed) {
+  SpectrumLogReader reader;
+  reader.open(path);
+
+  // Replayed frames take the normal publish path; live output is muted meanwhile
+  SpectrumLogSinks sinks;
+  sinks.spectrum = [this](const std::vector<float>& v) { delay_.emit(cb_, v, DelayLine::Clock::now()); };
+  sinks.vu = [this](const std::vector<uint8_t>& v) { delay_.emit(vuCb_, v, DelayLine::Clock::now()); };
+  sinks.wave = [this](const std::vector<int16_t>& v) { delay_.emit(waveCb_, v, DelayLine::Clock::now()); };
+
+  stopReplay_ = false;
+  replaying_ = true;
+  try {
+    replaySpectrumLog(reader, fromMs, toMs, speed, stopReplay_, sinks);
+  } catch (...) {
+    replaying_ = false;
+    throw;
+  }
+  replaying_ = false;
+}
+
+void PipeWireEngine::stopReplay() {
+  stopReplay_ = true;
+}
 
 void PipeWireEngine::enable(bool on) {
   if (on) {
-    start();
+    if (paused_) {
+      setPaused(false);
+    } else {
+      start();
+    }
   } else {
     stop();
   }
 }
 
+// Device switching: how long a new stream gets to deliver audio before the
+// switch is rolled back, and how many of its blocks the outgoing stream has
+// to reach a hop boundary before the new one takes over regardless
+static const int kSwitchTimeoutMs = 1500;
+static const int kSwitchGraceBlocks = 8;
+
 static const struct pw_stream_events streamEvents = {
   PW_VERSION_STREAM_EVENTS,
   .state_changed = PipeWireEngine::onStreamStateChanged,
+  .param_changed = PipeWireEngine::onStreamParamChanged,
   .process = PipeWireEngine::onStreamProcess,
 };
 
 void PipeWireEngine::onStreamStateChanged(void* data, enum pw_stream_state old,
                                            enum pw_stream_state state, const char* error) {
-  auto* engine = static_cast<PipeWireEngine*>(data);
+  auto* cap = static_cast<Capture*>(data);
+  auto* engine = cap->engine;
 
   std::cerr << "Stream state changed: " << pw_stream_state_as_string(state);
   if (error) {
@@ -238,15 +467,71 @@ void PipeWireEngine::onStreamStateChanged(void* data, enum pw_stream_state old,
   }
   std::cerr << std::endl;
 
-  if (state == PW_STREAM_STATE_ERROR) {
+  if (state != PW_STREAM_STATE_ERROR) return;
+
+  // A stream that is still being switched to only fails the switch
+  std::lock_guard<std::mutex> lock(engine->switchMutex_);
+  if (cap == engine->switching_) {
+    engine->switching_ = nullptr;
+    engine->switchCond_.notify_all();
+  } else if (cap == engine->feeding_) {
     engine->running_ = false;
   }
 }
 
+// Formats offered in EnumFormat, most preferred first. Rate and channels are
+// left open, so the server hands over the device's own instead of resampling
+// and remixing for us.
+static const struct { enum spa_audio_format spa; SampleFormat format; } kFormats[] = {
+  { SPA_AUDIO_FORMAT_F32, SampleFormat::F32 },
+  { SPA_AUDIO_FORMAT_S32, SampleFormat::S32 },
+  { SPA_AUDIO_FORMAT_S24_32, SampleFormat::S24_32 },
+  { SPA_AUDIO_FORMAT_S24, SampleFormat::S24 },
+  { SPA_AUDIO_FORMAT_S16, SampleFormat::S16 },
+};
+
+void PipeWireEngine::onStreamParamChanged(void* data, uint32_t id, const struct spa_pod* param) {
+  auto* cap = static_cast<Capture*>(data);
+  if (!param || id != SPA_PARAM_Format) return;
+
+  uint32_t mediaType = 0, mediaSubtype = 0;
+  if (spa_format_parse(param, &mediaType, &mediaSubtype) < 0 ||
+      mediaType != SPA_MEDIA_TYPE_audio || mediaSubtype != SPA_MEDIA_SUBTYPE_raw) {
+    return;
+  }
+
+  struct spa_audio_info_raw info = {};
+  if (spa_format_audio_raw_parse(param, &info) < 0 || info.rate == 0 || info.channels == 0) return;
+
+  CaptureFormat f;
+  f.sampleRate = (int)info.rate;
+  f.channels = (int)info.channels;
+  bool known = false;
+  for (const auto& k : kFormats) {
+    if (k.spa == info.format) {
+      f.format = k.format;
+      known = true;
+    }
+  }
+  if (!known) {
+    std::cerr << "Unsupported sample format negotiated: " << info.format << std::endl;
+    return;
+  }
+
+  std::cerr << "Negotiated " << f.sampleRate << " Hz, " << f.channels << " ch, "
+            << sampleFormatName(f.format) << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(cap->formatMutex);
+    cap->negotiated = f;
+  }
+  cap->formatChanged = true;
+}
+
 void PipeWireEngine::onStreamProcess(void* data) {
-  auto* engine = static_cast<PipeWireEngine*>(data);
+  auto* cap = static_cast<Capture*>(data);
+  auto* engine = cap->engine;
 
-  struct pw_buffer* buf = pw_stream_dequeue_buffer(engine->stream_);
+  struct pw_buffer* buf = pw_stream_dequeue_buffer(cap->stream);
   if (!buf) {
     return;
   }
@@ -254,43 +539,57 @@ void PipeWireEngine::onStreamProcess(void* data) {
   struct spa_buffer* spaBuf = buf->buffer;
   struct spa_data* d = &spaBuf->datas[0];
 
-  if (d->data && d->chunk->size > 0) {
-    const float* samples = static_cast<const float*>(d->data);
-    size_t numFrames = d->chunk->size / (engine->nChannels_ * sizeof(float));
-    engine->processAudioData(samples, numFrames);
+  // Format changes arrive on the main loop; pick them up between buffers
+  if (cap->formatChanged.exchange(false)) {
+    std::lock_guard<std::mutex> lock(cap->formatMutex);
+    cap->format = cap->negotiated;
   }
 
-  pw_stream_queue_buffer(engine->stream_, buf);
-}
+  const size_t stride = (size_t)cap->format.channels * sampleFormatBytes(cap->format.format);
+  if (stride > 0 && d->data && d->chunk->size > 0) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(d->data) + d->chunk->offset;
+    engine->processAudioData(cap, bytes, d->chunk->size / stride);
+  }
 
-void PipeWireEngine::start() {
-  if (running_ || !coreReady_) return;
+  pw_stream_queue_buffer(cap->stream, buf);
+}
 
-  if (loop_ && !loopRunning_) {
-    if (pw_thread_loop_start(loop_) < 0) {
-      throw std::runtime_error("Failed to restart PipeWire thread loop");
-    }
-    loopRunning_ = true;
+void PipeWireEngine::setPaused(bool paused) {
+  if (!running_) {
+    if (!paused) start();
+    return;
   }
+  if (paused == paused_) return;
 
   pw_thread_loop_lock(loop_);
+  // The stream stays connected with its buffers negotiated; an inactive
+  // stream gets no process callbacks until it is activated again
+  pw_stream_set_active(capture_->stream, !paused);
+  paused_ = paused;
+  if (!paused) resumed_ = true;
+  pw_thread_loop_unlock(loop_);
 
-  // Create audio stream
-  const struct spa_pod* params[1];
-  uint8_t buffer[1024];
-  struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
-
-  // Setup audio format
-  struct spa_audio_info_raw audioInfo = {};
-  audioInfo.format = SPA_AUDIO_FORMAT_F32;
-  audioInfo.channels = 2;
-  audioInfo.rate = 48000;
+  // Frames already queued for output are stale by the time we resume
+  if (paused) delay_.clear();
+}
 
-  sampleRate_ = audioInfo.rate;
-  nChannels_ = audioInfo.channels;
-  isFloat_ = true;
+bool PipeWireEngine::paused() {
+  return paused_;
+}
 
-  params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &audioInfo);
+std::unique_ptr<PipeWireEngine::Capture> PipeWireEngine::openCapture(const std::string& target,
+                                                                    DeviceInfo::Flow flow,
+                                                                    bool inactive) {
+  // One EnumFormat per sample format; rate and channels stay unfixed
+  const uint32_t nParams = sizeof(kFormats) / sizeof(kFormats[0]);
+  const struct spa_pod* params[nParams];
+  uint8_t buffer[2048];
+  struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+  for (uint32_t i = 0; i < nParams; ++i) {
+    struct spa_audio_info_raw audioInfo = {};
+    audioInfo.format = kFormats[i].spa;
+    params[i] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &audioInfo);
+  }
 
   // Create stream properties
   struct pw_properties* props = pw_properties_new(
@@ -302,65 +601,122 @@ void PipeWireEngine::start() {
 
   // For render devices (sinks), use stream.capture.sink property to capture output
   // For capture devices (sources), use normal target
-  if (!currentDeviceId_.empty()) {
-    if (currentFlow_ == DeviceInfo::Flow::Render) {
+  if (!target.empty()) {
+    if (flow == DeviceInfo::Flow::Render) {
       // Capture from sink output (loopback)
       pw_properties_set(props, "stream.capture.sink", "true");
-      pw_properties_set(props, PW_KEY_TARGET_OBJECT, currentDeviceId_.c_str());
-      std::cerr << "Loopback capture from sink: " << currentDeviceId_ << std::endl;
+      pw_properties_set(props, PW_KEY_TARGET_OBJECT, target.c_str());
+      std::cerr << "Loopback capture from sink: " << target << std::endl;
     } else {
       // Normal capture from source
-      pw_properties_set(props, PW_KEY_TARGET_OBJECT, currentDeviceId_.c_str());
-      std::cerr << "Capturing from source: " << currentDeviceId_ << std::endl;
+      pw_properties_set(props, PW_KEY_TARGET_OBJECT, target.c_str());
+      std::cerr << "Capturing from source: " << target << std::endl;
     }
   } else {
     std::cerr << "Capturing from default device" << std::endl;
   }
 
-  stream_ = pw_stream_new(core_, "FFT Audio Capture", props);
-  if (!stream_) {
-    pw_thread_loop_unlock(loop_);
+  std::unique_ptr<Capture> cap(new Capture());
+  cap->engine = this;
+  cap->stream = pw_stream_new(core_, "FFT Audio Capture", props);
+  if (!cap->stream) {
     throw std::runtime_error("Failed to create PipeWire stream");
   }
 
-  pw_stream_add_listener(stream_, &streamListener_, &streamEvents, this);
+  pw_stream_add_listener(cap->stream, &cap->listener, &streamEvents, cap.get());
 
   // Connect stream
-  enum pw_stream_flags flags = (enum pw_stream_flags)(
-    PW_STREAM_FLAG_AUTOCONNECT |
-    PW_STREAM_FLAG_MAP_BUFFERS |
-    PW_STREAM_FLAG_RT_PROCESS
-  );
+  int flagBits = PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS;
+  if (inactive) flagBits |= PW_STREAM_FLAG_INACTIVE;
 
-  if (pw_stream_connect(stream_,
+  if (pw_stream_connect(cap->stream,
                         PW_DIRECTION_INPUT,
                         PW_ID_ANY,
-                        flags,
-                        params, 1) < 0) {
-    pw_stream_destroy(stream_);
-    stream_ = nullptr;
-    pw_thread_loop_unlock(loop_);
+                        (enum pw_stream_flags)flagBits,
+                        params, nParams) < 0) {
+    pw_stream_destroy(cap->stream);
     throw std::runtime_error("Failed to connect PipeWire stream");
   }
 
+  return cap;
+}
+
+void PipeWireEngine::closeCapture(std::unique_ptr<Capture>& cap) {
+  if (!cap) return;
+  pw_stream_disconnect(cap->stream);
+  pw_stream_destroy(cap->stream);
+  cap.reset();
+}
+
+bool PipeWireEngine::switchDevice(const std::string& deviceId, DeviceInfo::Flow flow) {
+  // Make before break: the current stream keeps feeding the analyzer while
+  // the new one connects; processAudioData() hands over once it delivers
+  pw_thread_loop_lock(loop_);
+  std::unique_ptr<Capture> next;
+  try {
+    next = openCapture(deviceId, flow, paused_);
+  } catch (...) {
+    pw_thread_loop_unlock(loop_);
+    throw;
+  }
   pw_thread_loop_unlock(loop_);
 
-  // Initialize FFT
-  binmap_ = makeBinMap(sampleRate_, plan_.fftSize, plan_.columns);
-  kiss_ = new Kiss();
-  kiss_->in.resize(plan_.fftSize);
-  kiss_->out.resize(plan_.fftSize / 2 + 1);
-  kiss_->cfg = kiss_fftr_alloc(plan_.fftSize, 0, nullptr, nullptr);
+  bool switched;
+  {
+    std::unique_lock<std::mutex> lock(switchMutex_);
+    if (paused_) {
+      // Nothing flows while paused, so there is nothing to wait for
+      feeding_ = next.get();
+    } else {
+      switchPrimed_ = false;
+      graceBlocks_ = 0;
+      switching_ = next.get();
+      switchCond_.wait_for(lock, std::chrono::milliseconds(kSwitchTimeoutMs),
+                           [&] { return switching_ != next.get(); });
+      switching_ = nullptr;
+    }
+    switched = feeding_ == next.get();
+  }
+
+  pw_thread_loop_lock(loop_);
+  if (switched) {
+    capture_.swap(next);
+  }
+  // Either the old stream after a switch, or the new one when rolling back
+  closeCapture(next);
+  pw_thread_loop_unlock(loop_);
+
+  if (!switched) {
+    std::cerr << "Device " << deviceId << " delivered no audio; staying on the current one" << std::endl;
+  }
+  return switched;
+}
+
+void PipeWireEngine::start() {
+  if (running_) return;
+  initialize();
+
+  pw_thread_loop_lock(loop_);
+  try {
+    capture_ = openCapture(currentDeviceId_, currentFlow_, false);
+  } catch (...) {
+    pw_thread_loop_unlock(loop_);
+    throw;
+  }
+  feeding_ = capture_.get();
+  pw_thread_loop_unlock(loop_);
+
+  // Initialize FFT at the last known rate; the first block after format
+  // negotiation reconfigures it if the device runs at another one
+  analyzer_.configure(sampleRate_, analyzer_.plan());
+  silence_.setSampleRate(sampleRate_);
 
   // Initialize buffers
   waveformBuf_.clear();
   waveformBuf_.reserve(2048);
 
-  vuBufs_.clear();
-  vuBufs_.resize(nChannels_);
-  for (auto& buf : vuBufs_) {
-    buf.reserve(4096);
-  }
+  vu_.resize(nChannels_);
+  stereo_.configure(sampleRate_);
 
   running_ = true;
 
@@ -375,6 +731,7 @@ void PipeWireEngine::stop() {
   if (!running_) return;
 
   running_ = false;
+  paused_ = false;
 
   // Stop publish thread first
   if (publishRunning_) {
@@ -389,40 +746,56 @@ void PipeWireEngine::stop() {
     pw_thread_loop_lock(loop_);
   }
 
-  if (stream_) {
-    pw_stream_disconnect(stream_);
-    pw_stream_destroy(stream_);
-    stream_ = nullptr;
+  feeding_ = nullptr;
+  closeCapture(capture_);
+  {
+    std::lock_guard<std::mutex> lock(formatMutex_);
+    reported_ = CaptureFormat();
   }
 
   if (loop_) {
     pw_thread_loop_unlock(loop_);
   }
 
-  // Stop thread loop to allow clean shutdown of the process (avoids lingering thread)
-  if (loop_ && loopRunning_) {
-    pw_thread_loop_stop(loop_);
-    loopRunning_ = false;
+  // Stop thread loop to allow clean shutdown of the process (avoids lingering
+  // thread); initialize() starts it again for the next stream or listDevices()
+  {
+    std::lock_guard<std::mutex> lock(initMutex_);
+    if (loop_ && loopRunning_) {
+      pw_thread_loop_stop(loop_);
+      loopRunning_ = false;
+    }
   }
 
   // Clean up FFT
-  if (kiss_) {
-    kiss_fft_free(kiss_->cfg);
-    delete kiss_;
-    kiss_ = nullptr;
-  }
+  analyzer_.release();
+  delay_.clear();
 
   std::cerr << "PipeWire stream stopped" << std::endl;
 }
 
 void PipeWireEngine::publishLoop() {
   const double publishInterval = 1.0 / 60.0;  // 60 Hz
+  int idleTicks = 0;
 
   while (publishRunning_) {
     auto start = std::chrono::high_resolution_clock::now();
 
-    publishWaveform();
-    computeAndPublishVu();
+    // While paused nothing new arrives, so there is nothing to publish
+    if (paused_) {
+      std::this_thread::sleep_for(std::chrono::duration<double>(publishInterval));
+      continue;
+    }
+
+    // While idle, wave and VU drop to a 1 Hz heartbeat
+    bool idle = analyzer_.idle();
+    idleTicks = idle ? idleTicks + 1 : 0;
+    if (!idle || idleTicks % 60 == 1) {
+      publishWaveform();
+      computeAndPublishVu();
+      publishStereo();
+    }
+    publishSpectrogram();
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end - start;
@@ -434,57 +807,151 @@ void PipeWireEngine::publishLoop() {
   }
 }
 
-void PipeWireEngine::processAudioData(const float* data, size_t numFrames) {
-  if (!running_ || !data || numFrames == 0) return;
+void PipeWireEngine::processAudioData(Capture* from, const uint8_t* data, size_t numFrames) {
+  if (!running_ || paused_ || !data || numFrames == 0) return;
+
+  // Device switch. Both streams' process callbacks run on the data thread.
+  // The new stream's first block proves it works; the outgoing stream then
+  // feeds up to the next hop boundary and hands over. If the outgoing one
+  // has gone quiet, the new stream takes over after a grace period.
+  bool handOver = false;
+  if (from != feeding_) {
+    if (from != switching_) return;
+    if (!switchPrimed_) {
+      switchPrimed_ = true;
+      return;
+    }
+    if (++graceBlocks_ < kSwitchGraceBlocks) return;
+    std::lock_guard<std::mutex> lock(switchMutex_);
+    if (from != switching_) return;
+    feeding_ = from;
+    switching_ = nullptr;
+    switchCond_.notify_all();
+  } else if (switchPrimed_ && switching_) {
+    numFrames = std::min(numFrames, analyzer_.samplesToHopBoundary());
+    handOver = true;
+  }
+
+  // First block after a warm pause: the analyzer's window and the wave/VU
+  // buffers still hold audio from before it
+  if (resumed_.exchange(false)) {
+    analyzer_.flushHistory();
+    std::lock_guard<std::mutex> wl(waveformMutex_);
+    std::lock_guard<std::mutex> vl(vuMutex_);
+    waveformBuf_.clear();
+    vu_.clear();
+    stereo_.reset();
+  }
+
+  const CaptureFormat& f = from->format;
+  if (f.sampleRate != sampleRate_ || f.channels != nChannels_ || f.format != format_) {
+    applyFormat(f);
+  }
+
+  // Float streams are used in place; integer ones go through the converter
+  const float* samples = reinterpret_cast<const float*>(data);
+  if (format_ != SampleFormat::F32) {
+    const size_t n = numFrames * nChannels_;
+    if (interleaved_.size() < n) interleaved_.resize(n);
+    convertToFloat(data, format_, n, interleaved_.data());
+    samples = interleaved_.data();
+  }
+  if (mono_.size() < numFrames) mono_.resize(numFrames);
+
+  // Silent input: keep feeding the analyzer's framing so the first loud
+  // block lands in a full window, but skip the wave/VU buffering
+  const bool idle = silence_.update(samples, numFrames, nChannels_);
+  analyzer_.setIdle(idle);
+
+  // Only buffer and analyse what somebody is listening to
+  analyzer_.setActive(demand_.wants(Product::Fft) || demand_.wants(Product::Spectrogram) ||
+                      demand_.wants(Product::Profiles));
+  analyzer_.setPitchTracking(demand_.wants(Product::Pitch));
+  analyzer_.setModules(demand_.wants(Product::Modules));
+  const bool wantWave = !idle && demand_.wants(Product::Wave);
+  const bool wantVu = !idle && demand_.wants(Product::Vu);
+  const bool wantStereo = !idle && demand_.wants(Product::Stereo);
+
+  // Fold the block into the analyzer input per the channel mode. In the
+  // default left mode the stereo meter fills it in the same pass.
+  const ChannelMode mode = channelMode_;
+  const bool dual = mode == ChannelMode::Dual;
+  if (dual && right_.size() < numFrames) right_.resize(numFrames);
+  if (wantStereo) {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    stereo_.process(samples, numFrames, nChannels_, mode == ChannelMode::Left ? mono_.data() : nullptr);
+  }
+  if (!wantStereo || mode != ChannelMode::Left) {
+    mixChannels(samples, numFrames, nChannels_, mode, mono_.data(), right_.data());
+  }
 
-  const float* samples = data;
-  std::vector<float> hop(plan_.hopSize);
-  static size_t hopFill = 0;
+  // Add to waveform buffer
+  if (wantWave) {
+    std::lock_guard<std::mutex> lock(waveformMutex_);
+    waveformBuf_.insert(waveformBuf_.end(), mono_.begin(), mono_.begin() + numFrames);
+    if (waveformBuf_.size() > 2048) {
+      waveformBuf_.erase(waveformBuf_.begin(), waveformBuf_.begin() + (waveformBuf_.size() - 2048));
+    }
+  }
 
-  for (size_t i = 0; i < numFrames; ++i) {
-    // Take left channel (mono for FFT)
-    float sample = samples[i * nChannels_];
+  // Add to VU buffers (all channels)
+  if (wantVu) {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    vu_.push(samples, numFrames);
+  }
 
-    // Add to hop buffer
-    hop[hopFill++] = sample;
+  // Hop framing, FFT and band mapping happen in the analyzer. The block
+  // arrives when its last sample is captured; back-date the first one.
+  auto firstSample = DelayLine::Clock::now() - std::chrono::duration_cast<DelayLine::Clock::duration>(
+    std::chrono::duration<double>(double(numFrames) / sampleRate_));
+  analyzer_.pushSamples(mono_.data(), numFrames, firstSample, dual ? right_.data() : nullptr);
 
-    // Add to waveform buffer
-    {
-      std::lock_guard<std::mutex> lock(waveformMutex_);
-      waveformBuf_.push_back(sample);
-      if (waveformBuf_.size() > 2048) {
-        waveformBuf_.erase(waveformBuf_.begin(), waveformBuf_.begin() + (waveformBuf_.size() - 2048));
-      }
+  if (handOver) {
+    std::lock_guard<std::mutex> lock(switchMutex_);
+    if (switching_) {
+      feeding_ = switching_.load();
+      switching_ = nullptr;
+      switchCond_.notify_all();
     }
+  }
+}
 
-    // Add to VU buffers (all channels)
-    {
-      std::lock_guard<std::mutex> lock(vuMutex_);
-      for (int ch = 0; ch < nChannels_; ++ch) {
-        float chSample = samples[i * nChannels_ + ch];
-        vuBufs_[ch].push_back(chSample);
-        if (vuBufs_[ch].size() > 4096) {
-          vuBufs_[ch].erase(vuBufs_[ch].begin());
-        }
-      }
-    }
+// Data thread. Adopts a newly negotiated format: a new rate rebuilds the
+// analyzer (and with it the bin map) for the real rate, a new channel count
+// resizes the VU buffers.
+void PipeWireEngine::applyFormat(const CaptureFormat& f) {
+  if (f.sampleRate != sampleRate_) {
+    sampleRate_ = f.sampleRate;
+    analyzer_.configure(sampleRate_, analyzer_.plan());
+    silence_.setSampleRate(sampleRate_);
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    stereo_.configure(sampleRate_);
+  }
+  if (f.channels != nChannels_) {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    nChannels_ = f.channels;
+    vu_.resize(nChannels_);
+  }
+  format_ = f.format;
 
-    // Process hop when full
-    if (hopFill == (size_t)plan_.hopSize) {
-      sampleBuf_.write(hop.data(), plan_.hopSize);
-      hopFill = 0;
+  std::lock_guard<std::mutex> lock(formatMutex_);
+  reported_ = f;
+}
 
-      if (sampleBuf_.count() >= (size_t)plan_.fftSize) {
-        std::vector<float> frame(plan_.fftSize);
-        sampleBuf_.readLatest(frame.data(), frame.size());
-        computeFftAndPublish(frame.data());
-      }
-    }
+CaptureFormat PipeWireEngine::captureFormat() {
+  std::lock_guard<std::mutex> lock(formatMutex_);
+  return reported_;
+}
+
+void PipeWireEngine::publishSpectrogram() {
+  if (!spectrogramCb_ || replaying_) return;
+  if (analyzer_.spectrogram().takeNewRows(spectrogramRows_)) {
+    delay_.emit(spectrogramCb_, spectrogramRows_, DelayLine::Clock::now());
   }
 }
 
 void PipeWireEngine::publishWaveform() {
-  if (!waveCb_) return;
+  if (replaying_ || !demand_.wants(Product::Wave)) return;
 
   std::vector<float> waveSamples;
   {
@@ -502,86 +969,36 @@ void PipeWireEngine::publishWaveform() {
     downsampled[i] = static_cast<int16_t>(val);
   }
 
-  waveCb_(downsampled);
+  auto now = DelayLine::Clock::now();
+  if (log_.logsWave()) log_.append(spectrumlog::kWave, now, downsampled.data(), downsampled.size() * sizeof(int16_t));
+  delay_.emit(waveCb_, std::move(downsampled), now);
 }
 
 void PipeWireEngine::computeAndPublishVu() {
-  if (!vuCb_ || nChannels_ == 0) return;
+  if (replaying_ || !demand_.wants(Product::Vu)) return;
 
-  std::vector<float> channelSamples[8];
+  // The channel count can change with the negotiated format; read it under
+  // the same lock as the history. One pass over the planes, no copies.
+  std::vector<uint8_t> vuLevels;
   {
     std::lock_guard<std::mutex> lock(vuMutex_);
-    for (int ch = 0; ch < nChannels_ && ch < 8; ++ch) {
-      if (vuBufs_[ch].empty()) return;
-      channelSamples[ch] = vuBufs_[ch];
-    }
-  }
-
-  std::vector<uint8_t> vuLevels(nChannels_);
-
-  for (int ch = 0; ch < nChannels_; ++ch) {
-    const auto& samples = channelSamples[ch];
-    if (samples.empty()) {
-      vuLevels[ch] = 0;
-      continue;
-    }
-
-    size_t n = std::min<size_t>(1024, samples.size());
-    size_t start = samples.size() - n;
-
-    double sumSquares = 0.0;
-    for (size_t i = start; i < samples.size(); ++i) {
-      double s = samples[i];
-      sumSquares += s * s;
-    }
-
-    double rms = std::sqrt(sumSquares / n);
-    rms *= masterGain_;
-    double db = 20.0 * std::log10(rms + 1e-10);
-
-    double normalized = (db + 60.0) / 60.0;
-    normalized = std::max(0.0, std::min(1.0, normalized));
-
-    vuLevels[ch] = static_cast<uint8_t>(std::round(normalized * 255.0));
+    if (vu_.channels() == 0 || vu_.frames() == 0) return;
+    vuLevels.resize(vu_.channels());
+    vu_.levels(masterGain_, vuLevels.data());
   }
 
-  vuCb_(vuLevels);
+  auto now = DelayLine::Clock::now();
+  if (log_.isOpen()) log_.append(spectrumlog::kVu, now, vuLevels.data(), vuLevels.size());
+  delay_.emit(vuCb_, std::move(vuLevels), now);
 }
 
-void PipeWireEngine::computeFftAndPublish(const float* frame) {
-  // Apply Hamming window
-  for (int i = 0; i < plan_.fftSize; ++i) {
-    float w = 0.54f - 0.46f * std::cos(2.0 * kPI * i / (plan_.fftSize - 1));
-    kiss_->in[i] = frame[i] * w;
-  }
+void PipeWireEngine::publishStereo() {
+  if (replaying_ || !demand_.wants(Product::Stereo)) return;
 
-  kiss_fftr(kiss_->cfg, kiss_->in.data(), kiss_->out.data());
-
-  auto& out = specBuf_.writeBuf();
-  out.resize(plan_.columns);
-  const float dbFloor = plan_.dbFloor;
-
-  for (int b = 0; b < plan_.columns; ++b) {
-    double sum = 0;
-    int cnt = 0;
-    for (int j = binmap_.start[b]; j < binmap_.end[b]; ++j, ++cnt) {
-      double re = kiss_->out[j].r;
-      double im = kiss_->out[j].i;
-      const double ampScale = 2.0 / double(plan_.fftSize);
-      sum += std::sqrt(re * re + im * im) * ampScale;
-    }
-    double lin = cnt > 0 ? sum / cnt : 0.0;
-    double db = 20.0 * std::log10(lin + 1e-20);
-
-    double clamped = std::max(db, (double)dbFloor);
-    double norm = double(b + 10) / double(plan_.columns + 10);
-    double gain = std::pow(norm, (double)tiltExp_);
-    float v = float(((clamped - dbFloor) / -dbFloor) * gain * masterGain_);
-    if (clampUnit_) v = std::max(0.0f, std::min(1.0f, v));
-
-    out[b] = static_cast<uint8_t>(std::round(v * 255.0f));
+  StereoFrame frame;
+  {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    stereo_.read(frame);
   }
-
-  specBuf_.publish();
-  if (cb_) cb_(specBuf_.readBuf());
+  delay_.emit(stereoCb_, std::move(frame), DelayLine::Clock::now());
 }
@@ -2,7 +2,11 @@
 
 #include "audio_engine.h"
 #include "fft_bands.h"
-#include "ringbuffers.h"
+#include "spectrum_analyzer.h"
+#include "silence_detector.h"
+#include "delay_line.h"
+#include "spectrum_log.h"
+#include "vu_meter.h"
 #include <pipewire/pipewire.h>
 #include <spa/param/audio/format-utils.h>
 #include <thread>
@@ -12,15 +16,18 @@
 #include <vector>
 #include <map>
 #include <functional>
+#include <memory>
 
 class PipeWireEngine : public AudioEngine {
 public:
   PipeWireEngine();
   ~PipeWireEngine() override;
 
+  void initialize() override;
   std::vector<DeviceInfo> listDevices() override;
   bool setDevice(const std::string& deviceId) override;
   DeviceInfo currentDevice() override;
+  CaptureFormat captureFormat() override;
 
   void setFftSize(int fft) override;
   void setHopSize(int hop) override;
@@ -33,8 +40,47 @@ public:
   void setCallback(FftCallback cb) override;
   void setWaveCallback(WaveCallback cb) override;
   void setVuCallback(VuCallback cb) override;
+  void setStereoCallback(StereoCallback cb) override;
 
   void enable(bool on) override;
+  void setPaused(bool paused) override;
+  bool paused() override;
+
+  void setSpectrogram(float seconds, bool rgba) override;
+  void setSpectrogramColormap(const std::vector<uint8_t>& lut) override;
+  bool spectrogramSnapshot(SpectrogramRows& out) override;
+  void setSpectrogramCallback(SpectrogramCallback cb) override;
+
+  void setProfile(const std::string& name, const ProfileSpec& spec) override;
+  void removeProfile(const std::string& name) override;
+  void setProfileCallback(ProfileCallback cb) override;
+  void setModuleCallback(ModuleCallback cb) override;
+  void setPitchRange(float minHz, float maxHz) override;
+  void setPitchCallback(PitchCallback cb) override;
+  void setAgc(const AgcSettings& s) override;
+  AgcSettings agc() override;
+  float agcGainDb() override;
+  void setNormalizer(const NormalizerSettings& s) override;
+  NormalizerSettings normalizer() override;
+
+  std::vector<TaskGraph::NodeStats> analyzerStats() override;
+
+  void setSilenceDetection(bool enabled, float thresholdDb, int holdMs) override;
+  bool isIdle() override;
+
+  void setCpuBudget(float fraction) override;
+  QualityInfo quality() override;
+  void setAnalysisRate(int hz) override;
+  void setChannelMode(ChannelMode mode) override;
+  ChannelMode channelMode() override;
+
+  void setOutputDelayMs(int ms) override;
+  int outputDelayMs() override;
+
+  void startLog(const std::string& path, bool logWave) override;
+  void stopLog() override;
+  void replayLog(const std::string& path, double fromMs, double toMs, double speed) override;
+  void stopReplay() override;
 
   // PipeWire callbacks (must be public for C struct initialization)
   static void onRegistryGlobal(void* data, uint32_t id, uint32_t permissions,
@@ -42,32 +88,63 @@ public:
   static void onRegistryGlobalRemove(void* data, uint32_t id);
   static void onStreamStateChanged(void* data, enum pw_stream_state old,
                                     enum pw_stream_state state, const char* error);
+  static void onStreamParamChanged(void* data, uint32_t id, const struct spa_pod* param);
   static void onStreamProcess(void* data);
+  static void onCoreDone(void* data, uint32_t id, int seq);
 
 private:
-  struct Kiss;
-
   void start();
   void stop();
   void publishLoop();
-  void processAudioData(const float* data, size_t numFrames);
+  // One connected pw_stream; its callbacks get the Capture as user data
+  struct Capture {
+    PipeWireEngine* engine = nullptr;
+    struct pw_stream* stream = nullptr;
+    struct spa_hook listener;
+    CaptureFormat format;                  // data thread
+    CaptureFormat negotiated;              // main loop, under formatMutex
+    std::mutex formatMutex;
+    std::atomic<bool> formatChanged{false};
+  };
+  // Loop lock held by the caller for both
+  std::unique_ptr<Capture> openCapture(const std::string& target, DeviceInfo::Flow flow, bool inactive);
+  void closeCapture(std::unique_ptr<Capture>& cap);
+  bool switchDevice(const std::string& deviceId, DeviceInfo::Flow flow);
+  void processAudioData(Capture* from, const uint8_t* data, size_t numFrames);
+  void applyFormat(const CaptureFormat& f);
   void publishWaveform();
+  void publishSpectrogram();
   void computeAndPublishVu();
-  void computeFftAndPublish(const float* frame);
+  void publishStereo();
 
   // PipeWire state
+  static const int kSyncTimeoutSec = 2;
+  std::mutex initMutex_;
+  bool pwInitialized_ = false;
   bool loopRunning_ = false;
   struct pw_thread_loop* loop_ = nullptr;
   struct pw_context* context_ = nullptr;
   struct pw_core* core_ = nullptr;
   struct pw_registry* registry_ = nullptr;
-  struct pw_stream* stream_ = nullptr;
+  std::unique_ptr<Capture> capture_;
 
+  struct spa_hook coreListener_;
   struct spa_hook registryListener_;
-  struct spa_hook streamListener_;
 
   std::atomic<bool> coreReady_{false};
+  int syncSeq_ = 0;                  // pending pw_core_sync, guarded by the loop lock
+  bool syncDone_ = false;
   std::atomic<bool> running_{false};
+  std::atomic<bool> paused_{false};   // stream kept but inactive
+  std::atomic<bool> resumed_{false};  // capture thread flushes stale audio
+
+  // Make-before-break device switching (see processAudioData)
+  std::atomic<Capture*> feeding_{nullptr};    // the stream the analyzer hears
+  std::atomic<Capture*> switching_{nullptr};  // being switched to; guarded by switchMutex_ for writes
+  std::atomic<bool> switchPrimed_{false};
+  int graceBlocks_ = 0;                       // data thread
+  std::mutex switchMutex_;
+  std::condition_variable switchCond_;
   std::atomic<bool> publishRunning_{false};
 
   // Device management
@@ -79,25 +156,30 @@ private:
   DeviceInfo::Flow currentFlow_ = DeviceInfo::Flow::Capture;
   bool loopback_ = false;
 
-  // Audio parameters
+  // Format the analyzer currently runs at (data thread); reported_ is the
+  // copy captureFormat() hands out
   int sampleRate_ = 48000;
   int nChannels_ = 2;
-  bool isFloat_ = true;
+  SampleFormat format_ = SampleFormat::F32;
+  CaptureFormat reported_;
+  std::mutex formatMutex_;
 
   // FFT state
-  BandPlan plan_;
-  BinMap binmap_;
-  Kiss* kiss_ = nullptr;
-  FloatRingBuffer sampleBuf_{4096*4};
-  TripleBuffer<uint8_t> specBuf_{256};
-  bool clampUnit_ = true;
+  BandPlan plan_;   // JS thread only; other threads read analyzer_.plan()
+  SpectrumAnalyzer analyzer_;
+  std::vector<float> mono_;  // scratch: analyzer input of the current block
+  std::vector<float> right_; // scratch: right channel in dual mode
+  std::atomic<ChannelMode> channelMode_{ChannelMode::Left};
+  std::vector<float> interleaved_;  // scratch: integer blocks converted to float
+  SilenceDetector silence_;
   float masterGain_ = 1.0f;
   float tiltExp_ = 0.0f;
 
   // Waveform & VU
   std::vector<float> waveformBuf_;
   std::mutex waveformMutex_;
-  std::vector<std::vector<float>> vuBufs_;
+  VuHistory vu_;                   // planar, one ring per channel
+  StereoMeter stereo_;             // guarded by vuMutex_ like vu_
   std::mutex vuMutex_;
 
   // Publish thread
@@ -107,4 +189,15 @@ private:
   FftCallback cb_;
   WaveCallback waveCb_;
   VuCallback vuCb_;
+  StereoCallback stereoCb_;
+  SpectrogramCallback spectrogramCb_;
+  SpectrogramRows spectrogramRows_;  // reused by the publish side
+  ProfileCallback profileCb_;
+  ModuleCallback moduleCb_;
+  PitchCallback pitchCb_;
+  DelayLine delay_;                  // sits between every product and its callback
+  SpectrumLogWriter log_;
+  std::atomic<bool> replaying_{false};  // live output muted while a log plays back
+  std::atomic<bool> stopReplay_{false};
+  float spectrogramSeconds_ = 0.0f;   // history length; > 0 holds Product::Spectrogram
 };
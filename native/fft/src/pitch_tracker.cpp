@@ -0,0 +1,144 @@
+#include "pitch_tracker.h"
+#include <algorithm>
+#include <cmath>
+
+extern "C" {
+  #include "kiss_fftr.h"
+}
+
+namespace {
+
+const float kThreshold = 0.15f;     // YIN absolute threshold
+const float kUnvoiced = 0.35f;      // best dip above this: no pitch
+const double kSilence = 1e-7;       // mean square below ~-70 dBFS: no pitch
+
+const char* const kNoteNames[12] = {
+  "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"
+};
+
+}  // namespace
+
+struct PitchTracker::Kiss {
+  kiss_fftr_cfg fwd = nullptr;
+  kiss_fftr_cfg inv = nullptr;
+  int size = 0;
+  std::vector<float> a, b, corr;
+  std::vector<kiss_fft_cpx> fa, fb;
+};
+
+PitchTracker::~PitchTracker() {
+  release();
+}
+
+void PitchTracker::release() {
+  if (!kiss_) return;
+  kiss_fft_free(kiss_->fwd);
+  kiss_fft_free(kiss_->inv);
+  delete kiss_;
+  kiss_ = nullptr;
+}
+
+void PitchTracker::configure(int sampleRate, float minHz, float maxHz) {
+  release();
+  sampleRate_ = sampleRate;
+  if (sampleRate <= 0) return;
+
+  const float hi = std::max(40.0f, std::min(maxHz, sampleRate / 4.0f));
+  const float lo = std::max(20.0f, std::min(minHz, hi / 2.0f));
+  minLag_ = std::max(2, (int)std::floor(sampleRate / hi));
+  maxLag_ = (int)std::ceil(sampleRate / lo) + 1;
+  window_ = 2 * maxLag_;
+
+  // Correlating maxLag_ samples against the whole frame never reaches past
+  // window_, so a circular correlation of that size does not wrap
+  int n = 1;
+  while (n < window_) n <<= 1;
+
+  kiss_ = new Kiss();
+  kiss_->size = n;
+  kiss_->fwd = kiss_fftr_alloc(n, 0, nullptr, nullptr);
+  kiss_->inv = kiss_fftr_alloc(n, 1, nullptr, nullptr);
+  kiss_->a.assign(n, 0.0f);
+  kiss_->b.assign(n, 0.0f);
+  kiss_->corr.assign(n, 0.0f);
+  kiss_->fa.resize(n / 2 + 1);
+  kiss_->fb.resize(n / 2 + 1);
+  sq_.assign(window_ + 1, 0.0);
+  cmnd_.assign(maxLag_ + 1, 1.0f);
+}
+
+PitchEstimate PitchTracker::analyze(const float* x) {
+  PitchEstimate est;
+  if (!kiss_ || !x) return est;
+
+  const int w = maxLag_;   // integration window
+  sq_[0] = 0.0;
+  for (int i = 0; i < window_; ++i) sq_[i + 1] = sq_[i] + double(x[i]) * x[i];
+  const double e0 = sq_[w];
+  if (e0 / w < kSilence) return est;
+
+  // r(tau) = sum_{j<w} x[j] * x[j + tau] via conj(FFT(a)) * FFT(b)
+  Kiss& k = *kiss_;
+  std::copy(x, x + w, k.a.begin());
+  std::copy(x, x + window_, k.b.begin());
+  kiss_fftr(k.fwd, k.a.data(), k.fa.data());
+  kiss_fftr(k.fwd, k.b.data(), k.fb.data());
+  for (size_t i = 0; i < k.fa.size(); ++i) {
+    const kiss_fft_cpx a = k.fa[i], b = k.fb[i];
+    k.fa[i].r = a.r * b.r + a.i * b.i;
+    k.fa[i].i = a.r * b.i - a.i * b.r;
+  }
+  kiss_fftri(k.inv, k.fa.data(), k.corr.data());
+  const double scale = 1.0 / k.size;
+
+  // Difference function and its cumulative mean normalization
+  double running = 0.0;
+  cmnd_[0] = 1.0f;
+  for (int tau = 1; tau <= maxLag_; ++tau) {
+    double et = sq_[tau + w] - sq_[tau];
+    double d = std::max(0.0, e0 + et - 2.0 * k.corr[tau] * scale);
+    running += d;
+    cmnd_[tau] = running > 0.0 ? float(d * tau / running) : 1.0f;
+  }
+
+  // First dip under the threshold, followed down to its minimum; failing
+  // that, the deepest dip in range
+  int best = -1;
+  for (int tau = minLag_; tau < maxLag_; ++tau) {
+    if (cmnd_[tau] < kThreshold) {
+      while (tau + 1 < maxLag_ && cmnd_[tau + 1] < cmnd_[tau]) ++tau;
+      best = tau;
+      break;
+    }
+  }
+  if (best < 0) {
+    best = minLag_;
+    for (int tau = minLag_ + 1; tau < maxLag_; ++tau) {
+      if (cmnd_[tau] < cmnd_[best]) best = tau;
+    }
+  }
+
+  const float dip = cmnd_[best];
+  est.confidence = std::max(0.0f, std::min(1.0f, 1.0f - dip));
+  if (dip > kUnvoiced) return est;
+
+  // Parabolic interpolation around the dip for sub-sample lag
+  double lag = best;
+  if (best > 1 && best < maxLag_) {
+    double s0 = cmnd_[best - 1], s1 = cmnd_[best], s2 = cmnd_[best + 1];
+    double den = s0 - 2.0 * s1 + s2;
+    if (den > 0.0) lag += 0.5 * (s0 - s2) / den;
+  }
+
+  est.hz = float(sampleRate_ / lag);
+  double semis = 69.0 + 12.0 * std::log2(est.hz / 440.0);
+  est.midi = (int)std::lround(semis);
+  est.cents = float((semis - est.midi) * 100.0);
+  est.note = noteName(est.midi);
+  return est;
+}
+
+std::string PitchTracker::noteName(int midi) {
+  if (midi < 0) return std::string();
+  return std::string(kNoteNames[midi % 12]) + std::to_string(midi / 12 - 1);
+}
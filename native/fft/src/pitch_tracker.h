@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// One pitch reading. hz is 0 (and note empty) when the frame is unvoiced.
+struct PitchEstimate {
+  float hz = 0.0f;
+  float confidence = 0.0f;   // 0..1, 1 - YIN aperiodicity at the chosen lag
+  int midi = -1;             // nearest MIDI note, -1 when unvoiced
+  float cents = 0.0f;        // deviation from that note, -50..50
+  std::string note;          // e.g. "A4"
+};
+
+// Monophonic pitch detector (YIN).
+//
+// Works on the newest windowSize() samples: twice the longest period of
+// interest, so the difference function always integrates over a full period.
+// The cross term of the difference function is an autocorrelation computed
+// with one forward/inverse real FFT pair, the energy terms come from a
+// running sum of squares, so a frame costs O(N log N) instead of O(N^2).
+class PitchTracker {
+public:
+  PitchTracker() = default;
+  ~PitchTracker();
+
+  PitchTracker(const PitchTracker&) = delete;
+  PitchTracker& operator=(const PitchTracker&) = delete;
+
+  // Range is clamped to 20 Hz .. sampleRate / 4.
+  void configure(int sampleRate, float minHz, float maxHz);
+  bool configured() const { return kiss_ != nullptr; }
+  int windowSize() const { return window_; }
+
+  // x holds windowSize() samples, oldest first.
+  PitchEstimate analyze(const float* x);
+
+  static std::string noteName(int midi);
+
+private:
+  struct Kiss;
+
+  void release();
+
+  int sampleRate_ = 0;
+  int minLag_ = 0;
+  int maxLag_ = 0;
+  int window_ = 0;           // frame length, 2 * maxLag_
+  Kiss* kiss_ = nullptr;
+  std::vector<double> sq_;   // running sum of x^2
+  std::vector<float> cmnd_;  // cumulative mean normalized difference
+};
@@ -6,53 +6,24 @@
 #include <chrono>
 #include <algorithm>
 
-#define _USE_MATH_DEFINES
-constexpr double kPI = 3.14159265358979323846;
-
-extern "C" {
-  #include "kiss_fftr.h"
-}
-
-struct PulseAudioEngine::Kiss {
-  kiss_fftr_cfg cfg = nullptr;
-  std::vector<float> in;
-  std::vector<kiss_fft_cpx> out;
-};
-
 PulseAudioEngine::PulseAudioEngine() {
-  // Initialize PulseAudio threaded mainloop
-  mainloop_ = pa_threaded_mainloop_new();
-  if (!mainloop_) {
-    throw std::runtime_error("Failed to create PulseAudio mainloop");
-  }
-
-  pa_threaded_mainloop_lock(mainloop_);
-
-  pa_mainloop_api* mlapi = pa_threaded_mainloop_get_api(mainloop_);
-  context_ = pa_context_new(mlapi, "FFT Audio Analyzer");
-  if (!context_) {
-    pa_threaded_mainloop_unlock(mainloop_);
-    throw std::runtime_error("Failed to create PulseAudio context");
-  }
-
-  pa_context_set_state_callback(context_, contextStateCallback, this);
-
-  if (pa_context_connect(context_, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0) {
-    pa_threaded_mainloop_unlock(mainloop_);
-    throw std::runtime_error("Failed to connect to PulseAudio server");
-  }
-
-  if (pa_threaded_mainloop_start(mainloop_) < 0) {
-    pa_threaded_mainloop_unlock(mainloop_);
-    throw std::runtime_error("Failed to start PulseAudio mainloop");
-  }
-  mainloopRunning_ = true;
-
-  pa_threaded_mainloop_unlock(mainloop_);
+  analyzer_.setTilt(tiltExp_);
+  analyzer_.setFrameCallback([this](const AnalysisFrame& f) {
+    if (replaying_) return;
+    if (demand_.wants(Product::Fft)) {
+      if (log_.isOpen()) log_.appendSpectrum(f.time, f.spectrum.data(), f.spectrum.size());
+      delay_.emit(cb_, f.spectrum, f.time);
+    }
+    if (demand_.wants(Product::Profiles)) {
+      for (const auto& p : f.profiles) delay_.emit(profileCb_, p, f.time);
+    }
+    if (demand_.wants(Product::Pitch)) delay_.emit(pitchCb_, f.pitch, f.time);
+    if (demand_.wants(Product::Modules)) {
+      for (const auto& m : f.modules) delay_.emit(moduleCb_, m, f.time);
+    }
+  });
 
-  // Don't wait in constructor - let PulseAudio connect asynchronously
-  // Operations will check contextReady_ before executing
-  std::cerr << "PulseAudio engine created, waiting for context to become ready..." << std::endl;
+  // PulseAudio itself is brought up by initialize(), on first use at the latest
 }
 
 PulseAudioEngine::~PulseAudioEngine() {
@@ -135,9 +106,73 @@ void PulseAudioEngine::sourceInfoCallback(pa_context* c, const pa_source_info* i
   }
 }
 
+void PulseAudioEngine::initialize() {
+  std::lock_guard<std::mutex> lock(initMutex_);
+  if (contextReady_) {
+    // stop() parks the mainloop; the context stays connected, so restarting
+    // it is enough for the next stream or device query
+    if (!mainloopRunning_) {
+      if (pa_threaded_mainloop_start(mainloop_) < 0) {
+        throw std::runtime_error("Failed to restart PulseAudio mainloop");
+      }
+      mainloopRunning_ = true;
+    }
+    return;
+  }
+
+  if (!mainloop_) {
+    // Initialize PulseAudio threaded mainloop
+    mainloop_ = pa_threaded_mainloop_new();
+    if (!mainloop_) {
+      throw std::runtime_error("Failed to create PulseAudio mainloop");
+    }
+
+    pa_threaded_mainloop_lock(mainloop_);
+
+    pa_mainloop_api* mlapi = pa_threaded_mainloop_get_api(mainloop_);
+    context_ = pa_context_new(mlapi, "FFT Audio Analyzer");
+    if (!context_) {
+      pa_threaded_mainloop_unlock(mainloop_);
+      throw std::runtime_error("Failed to create PulseAudio context");
+    }
+
+    pa_context_set_state_callback(context_, contextStateCallback, this);
+
+    if (pa_context_connect(context_, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0) {
+      pa_threaded_mainloop_unlock(mainloop_);
+      throw std::runtime_error("Failed to connect to PulseAudio server");
+    }
+
+    if (pa_threaded_mainloop_start(mainloop_) < 0) {
+      pa_threaded_mainloop_unlock(mainloop_);
+      throw std::runtime_error("Failed to start PulseAudio mainloop");
+    }
+    mainloopRunning_ = true;
+  } else {
+    pa_threaded_mainloop_lock(mainloop_);
+  }
+
+  // The state callback signals on READY, FAILED and TERMINATED
+  for (;;) {
+    pa_context_state_t state = pa_context_get_state(context_);
+    if (state == PA_CONTEXT_READY) break;
+    if (!PA_CONTEXT_IS_GOOD(state)) {
+      pa_threaded_mainloop_unlock(mainloop_);
+      throw std::runtime_error("PulseAudio context failed");
+    }
+    pa_threaded_mainloop_wait(mainloop_);
+  }
+  contextReady_ = true;
+
+  pa_threaded_mainloop_unlock(mainloop_);
+  std::cerr << "PulseAudio engine initialized successfully" << std::endl;
+}
+
 std::vector<DeviceInfo> PulseAudioEngine::listDevices() {
-  if (!contextReady_) {
-    std::cerr << "PulseAudio context not ready" << std::endl;
+  try {
+    initialize();
+  } catch (const std::exception& e) {
+    std::cerr << "PulseAudio context not ready: " << e.what() << std::endl;
     return {};
   }
 
@@ -190,8 +225,25 @@ std::vector<DeviceInfo> PulseAudioEngine::listDevices() {
 }
 
 bool PulseAudioEngine::setDevice(const std::string& deviceId) {
+  // Make before break: a running engine connects the new stream first and
+  // keeps the old one if that fails. Read callbacks run under the mainloop
+  // lock, so the swap lands between two blocks.
   if (running_) {
-    stop();
+    pa_threaded_mainloop_lock(mainloop_);
+    pa_stream* next = nullptr;
+    CaptureFormat f;
+    try {
+      next = openStream(deviceId, paused_, &f);
+    } catch (...) {
+      pa_threaded_mainloop_unlock(mainloop_);
+      throw;
+    }
+    pa_stream* old = stream_;
+    stream_ = next;
+    pa_stream_disconnect(old);
+    pa_stream_unref(old);
+    applyFormat(f);
+    pa_threaded_mainloop_unlock(mainloop_);
   }
 
   currentDeviceId_ = deviceId;
@@ -215,25 +267,175 @@ DeviceInfo PulseAudioEngine::currentDevice() {
   return di;
 }
 
-void PulseAudioEngine::setFftSize(int fft) { plan_.fftSize = fft; }
-void PulseAudioEngine::setHopSize(int hop) { plan_.hopSize = hop; }
+void PulseAudioEngine::setFftSize(int fft) {
+  plan_.fftSize = fft;
+  analyzer_.requestPlan(plan_);
+}
+void PulseAudioEngine::setHopSize(int hop) {
+  plan_.hopSize = hop;
+  analyzer_.requestPlan(plan_);
+}
 void PulseAudioEngine::setColumns(int c) {
   plan_.columns = std::max(1, std::min(c, 256));
-  if (sampleRate_ > 0) {
-    binmap_ = makeBinMap(sampleRate_, plan_.fftSize, plan_.columns);
-  }
+  analyzer_.requestPlan(plan_);
+}
+void PulseAudioEngine::setDbFloor(float db) {
+  plan_.dbFloor = db;
+  analyzer_.requestPlan(plan_);
+}
+void PulseAudioEngine::setMasterGain(float g) {
+  masterGain_ = g;
+  analyzer_.setMasterGain(g);
+}
+void PulseAudioEngine::setTilt(float exp) {
+  tiltExp_ = exp;
+  analyzer_.setTilt(exp);
 }
-void PulseAudioEngine::setDbFloor(float db) { plan_.dbFloor = db; }
-void PulseAudioEngine::setMasterGain(float g) { masterGain_ = g; }
-void PulseAudioEngine::setTilt(float exp) { tiltExp_ = exp; }
 void PulseAudioEngine::setLoopback(bool on) { loopback_ = on; }
 void PulseAudioEngine::setCallback(FftCallback cb) { cb_ = std::move(cb); }
 void PulseAudioEngine::setWaveCallback(WaveCallback cb) { waveCb_ = std::move(cb); }
 void PulseAudioEngine::setVuCallback(VuCallback cb) { vuCb_ = std::move(cb); }
+void PulseAudioEngine::setStereoCallback(StereoCallback cb) { stereoCb_ = std::move(cb); }
+
+void PulseAudioEngine::setSpectrogram(float seconds, bool rgba) {
+  demand_.set(Product::Spectrogram, spectrogramSeconds_ > 0.0f, seconds > 0.0f);
+  spectrogramSeconds_ = seconds;
+  analyzer_.spectrogram().setRgba(rgba);
+  analyzer_.setSpectrogramSeconds(seconds);
+}
+void PulseAudioEngine::setSpectrogramColormap(const std::vector<uint8_t>& lut) {
+  analyzer_.spectrogram().setColormap(lut.data(), lut.size());
+}
+bool PulseAudioEngine::spectrogramSnapshot(SpectrogramRows& out) {
+  return analyzer_.spectrogram().snapshot(out);
+}
+void PulseAudioEngine::setSpectrogramCallback(SpectrogramCallback cb) { spectrogramCb_ = std::move(cb); }
+
+void PulseAudioEngine::setProfile(const std::string& name, const ProfileSpec& spec) {
+  analyzer_.setProfile(name, spec);
+}
+void PulseAudioEngine::removeProfile(const std::string& name) {
+  analyzer_.removeProfile(name);
+}
+void PulseAudioEngine::setProfileCallback(ProfileCallback cb) { profileCb_ = std::move(cb); }
+void PulseAudioEngine::setModuleCallback(ModuleCallback cb) { moduleCb_ = std::move(cb); }
+void PulseAudioEngine::setPitchRange(float minHz, float maxHz) {
+  analyzer_.setPitchRange(minHz, maxHz);
+}
+void PulseAudioEngine::setPitchCallback(PitchCallback cb) { pitchCb_ = std::move(cb); }
+
+std::vector<TaskGraph::NodeStats> PulseAudioEngine::analyzerStats() {
+  return analyzer_.nodeStats();
+}
+
+void PulseAudioEngine::setSilenceDetection(bool enabled, float thresholdDb, int holdMs) {
+  silence_.setThresholdDb(thresholdDb);
+  silence_.setHoldMs(holdMs);
+  silence_.setEnabled(enabled);
+}
+
+bool PulseAudioEngine::isIdle() {
+  return analyzer_.idle();
+}
+
+void PulseAudioEngine::setCpuBudget(float fraction) {
+  analyzer_.setCpuBudget(fraction);
+}
+
+QualityInfo PulseAudioEngine::quality() {
+  return analyzer_.quality();
+}
+
+void PulseAudioEngine::setAnalysisRate(int hz) {
+  analyzer_.setDecimation(hz);
+}
+
+void PulseAudioEngine::setChannelMode(ChannelMode mode) {
+  channelMode_ = mode;
+  analyzer_.setDual(mode == ChannelMode::Dual);
+}
+
+ChannelMode PulseAudioEngine::channelMode() {
+  return channelMode_;
+}
+
+void PulseAudioEngine::setAgc(const AgcSettings& s) {
+  analyzer_.setAgc(s);
+}
+
+AgcSettings PulseAudioEngine::agc() {
+  return analyzer_.agc();
+}
+
+float PulseAudioEngine::agcGainDb() {
+  return analyzer_.agcGainDb();
+}
+
+void PulseAudioEngine::setNormalizer(const NormalizerSettings& s) {
+  analyzer_.setNormalizer(s);
+}
+
+NormalizerSettings PulseAudioEngine::normalizer() {
+  return analyzer_.normalizer();
+}
+
+void PulseAudioEngine::setOutputDelayMs(int ms) {
+  delay_.setDelayMs(ms);
+}
+
+int PulseAudioEngine::outputDelayMs() {
+  return delay_.delayMs();
+}
+
+void PulseAudioEngine::startLog(const std::string& path, bool logWave) {
+  stopLog();
+  log_.open(path, sampleRate_, plan_.columns, logWave);
+  // The log is a consumer in its own right
+  demand_.acquire(Product::Fft);
+  demand_.acquire(Product::Vu);
+  if (logWave) demand_.acquire(Product::Wave);
+}
+
+void PulseAudioEngine::stopLog() {
+  if (!log_.isOpen()) return;
+  demand_.release(Product::Fft);
+  demand_.release(Product::Vu);
+  if (log_.logsWave()) demand_.release(Product::Wave);
+  log_.close();
+}
+
+void PulseAudioEngine::replayLog(const std::string& path, double fromMs, double toMs, double speed) {
+  SpectrumLogReader reader;
+  reader.open(path);
+
+  // Replayed frames take the normal publish path; live output is muted meanwhile
+  SpectrumLogSinks sinks;
+  sinks.spectrum = [this](const std::vector<float>& v) { delay_.emit(cb_, v, DelayLine::Clock::now()); };
+  sinks.vu = [this](const std::vector<uint8_t>& v) { delay_.emit(vuCb_, v, DelayLine::Clock::now()); };
+  sinks.wave = [this](const std::vector<int16_t>& v) { delay_.emit(waveCb_, v, DelayLine::Clock::now()); };
+
+  stopReplay_ = false;
+  replaying_ = true;
+  try {
+    replaySpectrumLog(reader, fromMs, toMs, speed, stopReplay_, sinks);
+  } catch (...) {
+    replaying_ = false;
+    throw;
+  }
+  replaying_ = false;
+}
+
+void PulseAudioEngine::stopReplay() {
+  stopReplay_ = true;
+}
 
 void PulseAudioEngine::enable(bool on) {
   if (on) {
-    start();
+    if (paused_) {
+      setPaused(false);
+    } else {
+      start();
+    }
   } else {
     stop();
   }
@@ -267,7 +469,7 @@ void PulseAudioEngine::streamReadCallback(pa_stream* s, size_t nbytes, void* use
       return;
     }
 
-    if (data && bytes > 0) {
+    if (s == engine->stream_ && data && bytes > 0) {
       engine->processAudioData(data, bytes);
     }
 
@@ -275,42 +477,101 @@ void PulseAudioEngine::streamReadCallback(pa_stream* s, size_t nbytes, void* use
   }
 }
 
-void PulseAudioEngine::start() {
-  if (running_ || !contextReady_) return;
+void PulseAudioEngine::setPaused(bool paused) {
+  if (!running_) {
+    if (!paused) start();
+    return;
+  }
+  if (paused == paused_) return;
 
-  if (mainloop_ && !mainloopRunning_) {
-    if (pa_threaded_mainloop_start(mainloop_) < 0) {
-      throw std::runtime_error("Failed to restart PulseAudio mainloop");
-    }
-    mainloopRunning_ = true;
+  pa_threaded_mainloop_lock(mainloop_);
+  // Corking keeps the stream connected; the server just stops sending data
+  pa_operation* op = pa_stream_cork(stream_, paused ? 1 : 0, nullptr, nullptr);
+  if (op) pa_operation_unref(op);
+  paused_ = paused;
+  if (!paused) resumed_ = true;
+  pa_threaded_mainloop_unlock(mainloop_);
+
+  // Frames already queued for output are stale by the time we resume
+  if (paused) delay_.clear();
+}
+
+bool PulseAudioEngine::paused() {
+  return paused_;
+}
+
+// Sample formats we convert ourselves; anything else is delivered as float
+static const struct { pa_sample_format_t pa; SampleFormat format; } kFormats[] = {
+  { PA_SAMPLE_FLOAT32LE, SampleFormat::F32 },
+  { PA_SAMPLE_S16LE, SampleFormat::S16 },
+  { PA_SAMPLE_S24LE, SampleFormat::S24 },
+  { PA_SAMPLE_S24_32LE, SampleFormat::S24_32 },
+  { PA_SAMPLE_S32LE, SampleFormat::S32 },
+};
+
+namespace {
+struct SpecQuery {
+  pa_threaded_mainloop* mainloop;
+  pa_sample_spec spec;
+  bool found;
+  bool done;
+};
+
+void sourceSpecCallback(pa_context* c, const pa_source_info* info, int eol, void* userdata) {
+  auto* q = static_cast<SpecQuery*>(userdata);
+  if (info) {
+    q->spec = info->sample_spec;
+    q->found = true;
   }
+  if (eol != 0) {
+    q->done = true;
+    pa_threaded_mainloop_signal(q->mainloop, 0);
+  }
+}
+}  // namespace
 
-  if (currentDeviceId_.empty()) {
-    // Use default source
-    currentDeviceId_ = "@DEFAULT_SOURCE@";
+CaptureFormat PulseAudioEngine::nativeFormat(const std::string& deviceId) {
+  SpecQuery q = { mainloop_, pa_sample_spec(), false, false };
+  pa_operation* op = pa_context_get_source_info_by_name(context_, deviceId.c_str(), sourceSpecCallback, &q);
+  if (op) {
+    while (!q.done && pa_operation_get_state(op) == PA_OPERATION_RUNNING) {
+      pa_threaded_mainloop_wait(mainloop_);
+    }
+    pa_operation_unref(op);
   }
 
-  pa_threaded_mainloop_lock(mainloop_);
+  CaptureFormat f;
+  f.sampleRate = 48000;
+  f.channels = 2;
+  if (!q.found) return f;
 
-  // Setup sample spec
-  pa_sample_spec ss;
-  ss.format = PA_SAMPLE_FLOAT32LE;  // Use float32 for easier processing
-  ss.channels = 2;  // Stereo
-  ss.rate = 48000;  // 48kHz sample rate
+  f.sampleRate = (int)q.spec.rate;
+  f.channels = (int)q.spec.channels;
+  for (const auto& k : kFormats) {
+    if (k.pa == q.spec.format) f.format = k.format;
+  }
+  return f;
+}
 
-  sampleRate_ = ss.rate;
-  nChannels_ = ss.channels;
-  isFloat_ = true;
+pa_stream* PulseAudioEngine::openStream(const std::string& deviceId, bool corked, CaptureFormat* format) {
+  // The source's own spec, so the server neither resamples nor remixes
+  const CaptureFormat f = nativeFormat(deviceId);
+  pa_sample_spec ss;
+  ss.format = PA_SAMPLE_FLOAT32LE;
+  for (const auto& k : kFormats) {
+    if (k.format == f.format) ss.format = k.pa;
+  }
+  ss.channels = (uint8_t)f.channels;
+  ss.rate = (uint32_t)f.sampleRate;
 
   // Create stream
-  stream_ = pa_stream_new(context_, "Audio Capture", &ss, nullptr);
-  if (!stream_) {
-    pa_threaded_mainloop_unlock(mainloop_);
+  pa_stream* stream = pa_stream_new(context_, "Audio Capture", &ss, nullptr);
+  if (!stream) {
     throw std::runtime_error("Failed to create PulseAudio stream");
   }
 
-  pa_stream_set_state_callback(stream_, streamStateCallback, this);
-  pa_stream_set_read_callback(stream_, streamReadCallback, this);
+  pa_stream_set_state_callback(stream, streamStateCallback, this);
+  pa_stream_set_read_callback(stream, streamReadCallback, this);
 
   // Buffer attributes
   pa_buffer_attr attr;
@@ -321,13 +582,12 @@ void PulseAudioEngine::start() {
   attr.tlength = (uint32_t) -1;
 
   // Connect stream
-  const char* dev = (currentDeviceId_ == "@DEFAULT_SOURCE@") ? nullptr : currentDeviceId_.c_str();
-  pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_ADJUST_LATENCY);
+  const char* dev = (deviceId == "@DEFAULT_SOURCE@") ? nullptr : deviceId.c_str();
+  int flags = PA_STREAM_ADJUST_LATENCY;
+  if (corked) flags |= PA_STREAM_START_CORKED;
 
-  if (pa_stream_connect_record(stream_, dev, &attr, flags) < 0) {
-    pa_stream_unref(stream_);
-    stream_ = nullptr;
-    pa_threaded_mainloop_unlock(mainloop_);
+  if (pa_stream_connect_record(stream, dev, &attr, (pa_stream_flags_t)flags) < 0) {
+    pa_stream_unref(stream);
     throw std::runtime_error("Failed to connect PulseAudio stream");
   }
 
@@ -335,34 +595,54 @@ void PulseAudioEngine::start() {
   pa_stream_state_t state;
   do {
     pa_threaded_mainloop_wait(mainloop_);
-    state = pa_stream_get_state(stream_);
+    state = pa_stream_get_state(stream);
   } while (state != PA_STREAM_READY && state != PA_STREAM_FAILED && state != PA_STREAM_TERMINATED);
 
   if (state != PA_STREAM_READY) {
-    pa_stream_unref(stream_);
-    stream_ = nullptr;
-    pa_threaded_mainloop_unlock(mainloop_);
+    pa_stream_unref(stream);
     throw std::runtime_error("Stream failed to become ready");
   }
 
+  *format = f;
+  return stream;
+}
+
+void PulseAudioEngine::start() {
+  if (running_) return;
+  initialize();
+
+  if (currentDeviceId_.empty()) {
+    // Use default source
+    currentDeviceId_ = "@DEFAULT_SOURCE@";
+  }
+
+  CaptureFormat f;
+  pa_threaded_mainloop_lock(mainloop_);
+  try {
+    stream_ = openStream(currentDeviceId_, false, &f);
+  } catch (...) {
+    pa_threaded_mainloop_unlock(mainloop_);
+    throw;
+  }
   pa_threaded_mainloop_unlock(mainloop_);
 
-  // Initialize FFT
-  binmap_ = makeBinMap(sampleRate_, plan_.fftSize, plan_.columns);
-  kiss_ = new Kiss();
-  kiss_->in.resize(plan_.fftSize);
-  kiss_->out.resize(plan_.fftSize / 2 + 1);
-  kiss_->cfg = kiss_fftr_alloc(plan_.fftSize, 0, nullptr, nullptr);
+  // Initialize FFT for the stream's native rate
+  sampleRate_ = f.sampleRate;
+  nChannels_ = f.channels;
+  format_ = f.format;
+  {
+    std::lock_guard<std::mutex> lock(formatMutex_);
+    reported_ = f;
+  }
+  analyzer_.configure(sampleRate_, analyzer_.plan());
+  silence_.setSampleRate(sampleRate_);
 
   // Initialize buffers
   waveformBuf_.clear();
   waveformBuf_.reserve(2048);
 
-  vuBufs_.clear();
-  vuBufs_.resize(nChannels_);
-  for (auto& buf : vuBufs_) {
-    buf.reserve(4096);
-  }
+  vu_.resize(nChannels_);
+  stereo_.configure(sampleRate_);
 
   running_ = true;
 
@@ -375,6 +655,7 @@ void PulseAudioEngine::stop() {
   if (!running_) return;
 
   running_ = false;
+  paused_ = false;
 
   // Stop publish thread
   if (publishRunning_) {
@@ -394,28 +675,48 @@ void PulseAudioEngine::stop() {
 
   pa_threaded_mainloop_unlock(mainloop_);
 
-  // Stop mainloop thread to avoid lingering thread blocking shutdown
-  if (mainloop_ && mainloopRunning_) {
-    pa_threaded_mainloop_stop(mainloop_);
-    mainloopRunning_ = false;
+  // Stop mainloop thread to avoid lingering thread blocking shutdown;
+  // initialize() starts it again for the next stream or listDevices()
+  {
+    std::lock_guard<std::mutex> lock(initMutex_);
+    if (mainloop_ && mainloopRunning_) {
+      pa_threaded_mainloop_stop(mainloop_);
+      mainloopRunning_ = false;
+    }
   }
 
-  // Clean up FFT
-  if (kiss_) {
-    kiss_fft_free(kiss_->cfg);
-    delete kiss_;
-    kiss_ = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(formatMutex_);
+    reported_ = CaptureFormat();
   }
+
+  // Clean up FFT
+  analyzer_.release();
+  delay_.clear();
 }
 
 void PulseAudioEngine::publishLoop() {
   const double publishInterval = 1.0 / 60.0;  // 60 Hz
+  int idleTicks = 0;
 
   while (publishRunning_) {
     auto start = std::chrono::high_resolution_clock::now();
 
-    publishWaveform();
-    computeAndPublishVu();
+    // While paused nothing new arrives, so there is nothing to publish
+    if (paused_) {
+      std::this_thread::sleep_for(std::chrono::duration<double>(publishInterval));
+      continue;
+    }
+
+    // While idle, wave and VU drop to a 1 Hz heartbeat
+    bool idle = analyzer_.idle();
+    idleTicks = idle ? idleTicks + 1 : 0;
+    if (!idle || idleTicks % 60 == 1) {
+      publishWaveform();
+      computeAndPublishVu();
+      publishStereo();
+    }
+    publishSpectrogram();
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end - start;
@@ -427,59 +728,116 @@ void PulseAudioEngine::publishLoop() {
   }
 }
 
-void PulseAudioEngine::processAudioData(const void* data, size_t bytes) {
-  if (!running_ || !data || bytes == 0) return;
+// Mainloop locked. Adopts the format of a stream switched to mid-run: a new
+// rate rebuilds the analyzer (and its bin map), a new channel count resizes
+// the VU buffers.
+void PulseAudioEngine::applyFormat(const CaptureFormat& f) {
+  if (f.sampleRate != sampleRate_) {
+    sampleRate_ = f.sampleRate;
+    analyzer_.configure(sampleRate_, analyzer_.plan());
+    silence_.setSampleRate(sampleRate_);
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    stereo_.configure(sampleRate_);
+  }
+  if (f.channels != nChannels_) {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    nChannels_ = f.channels;
+    vu_.resize(nChannels_);
+  }
+  format_ = f.format;
 
-  const float* samples = static_cast<const float*>(data);
-  size_t numFrames = bytes / (nChannels_ * sizeof(float));
+  std::lock_guard<std::mutex> lock(formatMutex_);
+  reported_ = f;
+}
 
-  std::vector<float> hop(plan_.hopSize);
-  static size_t hopFill = 0;
+CaptureFormat PulseAudioEngine::captureFormat() {
+  std::lock_guard<std::mutex> lock(formatMutex_);
+  return reported_;
+}
 
-  for (size_t i = 0; i < numFrames; ++i) {
-    // Take left channel (mono for FFT)
-    float sample = samples[i * nChannels_];
+void PulseAudioEngine::processAudioData(const void* data, size_t bytes) {
+  if (!running_ || paused_ || !data || bytes == 0) return;
 
-    // Add to hop buffer
-    hop[hopFill++] = sample;
+  // First block after a warm pause: the analyzer's window and the wave/VU
+  // buffers still hold audio from before it
+  if (resumed_.exchange(false)) {
+    analyzer_.flushHistory();
+    std::lock_guard<std::mutex> wl(waveformMutex_);
+    std::lock_guard<std::mutex> vl(vuMutex_);
+    waveformBuf_.clear();
+    vu_.clear();
+    stereo_.reset();
+  }
 
-    // Add to waveform buffer
-    {
-      std::lock_guard<std::mutex> lock(waveformMutex_);
-      waveformBuf_.push_back(sample);
-      if (waveformBuf_.size() > 2048) {
-        waveformBuf_.erase(waveformBuf_.begin(), waveformBuf_.begin() + (waveformBuf_.size() - 2048));
-      }
-    }
+  // Float streams are used in place; integer ones go through the converter
+  const float* samples = static_cast<const float*>(data);
+  size_t numFrames = bytes / (nChannels_ * sampleFormatBytes(format_));
+  if (format_ != SampleFormat::F32) {
+    const size_t n = numFrames * nChannels_;
+    if (interleaved_.size() < n) interleaved_.resize(n);
+    convertToFloat(data, format_, n, interleaved_.data());
+    samples = interleaved_.data();
+  }
+  if (mono_.size() < numFrames) mono_.resize(numFrames);
+
+  // Silent input: keep feeding the analyzer's framing so the first loud
+  // block lands in a full window, but skip the wave/VU buffering
+  const bool idle = silence_.update(samples, numFrames, nChannels_);
+  analyzer_.setIdle(idle);
+
+  // Only buffer and analyse what somebody is listening to
+  analyzer_.setActive(demand_.wants(Product::Fft) || demand_.wants(Product::Spectrogram) ||
+                      demand_.wants(Product::Profiles));
+  analyzer_.setPitchTracking(demand_.wants(Product::Pitch));
+  analyzer_.setModules(demand_.wants(Product::Modules));
+  const bool wantWave = !idle && demand_.wants(Product::Wave);
+  const bool wantVu = !idle && demand_.wants(Product::Vu);
+  const bool wantStereo = !idle && demand_.wants(Product::Stereo);
+
+  // Fold the block into the analyzer input per the channel mode. In the
+  // default left mode the stereo meter fills it in the same pass.
+  const ChannelMode mode = channelMode_;
+  const bool dual = mode == ChannelMode::Dual;
+  if (dual && right_.size() < numFrames) right_.resize(numFrames);
+  if (wantStereo) {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    stereo_.process(samples, numFrames, nChannels_, mode == ChannelMode::Left ? mono_.data() : nullptr);
+  }
+  if (!wantStereo || mode != ChannelMode::Left) {
+    mixChannels(samples, numFrames, nChannels_, mode, mono_.data(), right_.data());
+  }
 
-    // Add to VU buffers (all channels)
-    {
-      std::lock_guard<std::mutex> lock(vuMutex_);
-      for (int ch = 0; ch < nChannels_; ++ch) {
-        float chSample = samples[i * nChannels_ + ch];
-        vuBufs_[ch].push_back(chSample);
-        if (vuBufs_[ch].size() > 4096) {
-          vuBufs_[ch].erase(vuBufs_[ch].begin());
-        }
-      }
+  // Add to waveform buffer
+  if (wantWave) {
+    std::lock_guard<std::mutex> lock(waveformMutex_);
+    waveformBuf_.insert(waveformBuf_.end(), mono_.begin(), mono_.begin() + numFrames);
+    if (waveformBuf_.size() > 2048) {
+      waveformBuf_.erase(waveformBuf_.begin(), waveformBuf_.begin() + (waveformBuf_.size() - 2048));
     }
+  }
 
-    // Process hop when full
-    if (hopFill == (size_t)plan_.hopSize) {
-      sampleBuf_.write(hop.data(), plan_.hopSize);
-      hopFill = 0;
+  // Add to VU buffers (all channels)
+  if (wantVu) {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    vu_.push(samples, numFrames);
+  }
 
-      if (sampleBuf_.count() >= (size_t)plan_.fftSize) {
-        std::vector<float> frame(plan_.fftSize);
-        sampleBuf_.readLatest(frame.data(), frame.size());
-        computeFftAndPublish(frame.data());
-      }
-    }
+  // Hop framing, FFT and band mapping happen in the analyzer. The block
+  // arrives when its last sample is captured; back-date the first one.
+  auto firstSample = DelayLine::Clock::now() - std::chrono::duration_cast<DelayLine::Clock::duration>(
+    std::chrono::duration<double>(double(numFrames) / sampleRate_));
+  analyzer_.pushSamples(mono_.data(), numFrames, firstSample, dual ? right_.data() : nullptr);
+}
+
+void PulseAudioEngine::publishSpectrogram() {
+  if (!spectrogramCb_ || replaying_) return;
+  if (analyzer_.spectrogram().takeNewRows(spectrogramRows_)) {
+    delay_.emit(spectrogramCb_, spectrogramRows_, DelayLine::Clock::now());
   }
 }
 
 void PulseAudioEngine::publishWaveform() {
-  if (!waveCb_) return;
+  if (replaying_ || !demand_.wants(Product::Wave)) return;
 
   std::vector<float> waveSamples;
   {
@@ -497,86 +855,36 @@ void PulseAudioEngine::publishWaveform() {
     downsampled[i] = static_cast<int16_t>(val);
   }
 
-  waveCb_(downsampled);
+  auto now = DelayLine::Clock::now();
+  if (log_.logsWave()) log_.append(spectrumlog::kWave, now, downsampled.data(), downsampled.size() * sizeof(int16_t));
+  delay_.emit(waveCb_, std::move(downsampled), now);
 }
 
 void PulseAudioEngine::computeAndPublishVu() {
-  if (!vuCb_ || nChannels_ == 0) return;
+  if (replaying_ || !demand_.wants(Product::Vu)) return;
 
-  std::vector<float> channelSamples[8];
+  // The channel count can change with the negotiated format; read it under
+  // the same lock as the history. One pass over the planes, no copies.
+  std::vector<uint8_t> vuLevels;
   {
     std::lock_guard<std::mutex> lock(vuMutex_);
-    for (int ch = 0; ch < nChannels_ && ch < 8; ++ch) {
-      if (vuBufs_[ch].empty()) return;
-      channelSamples[ch] = vuBufs_[ch];
-    }
+    if (vu_.channels() == 0 || vu_.frames() == 0) return;
+    vuLevels.resize(vu_.channels());
+    vu_.levels(masterGain_, vuLevels.data());
   }
 
-  std::vector<uint8_t> vuLevels(nChannels_);
-
-  for (int ch = 0; ch < nChannels_; ++ch) {
-    const auto& samples = channelSamples[ch];
-    if (samples.empty()) {
-      vuLevels[ch] = 0;
-      continue;
-    }
-
-    size_t n = std::min<size_t>(1024, samples.size());
-    size_t start = samples.size() - n;
-
-    double sumSquares = 0.0;
-    for (size_t i = start; i < samples.size(); ++i) {
-      double s = samples[i];
-      sumSquares += s * s;
-    }
-
-    double rms = std::sqrt(sumSquares / n);
-    rms *= masterGain_;
-    double db = 20.0 * std::log10(rms + 1e-10);
-
-    double normalized = (db + 60.0) / 60.0;
-    normalized = std::max(0.0, std::min(1.0, normalized));
-
-    vuLevels[ch] = static_cast<uint8_t>(std::round(normalized * 255.0));
-  }
-
-  vuCb_(vuLevels);
+  auto now = DelayLine::Clock::now();
+  if (log_.isOpen()) log_.append(spectrumlog::kVu, now, vuLevels.data(), vuLevels.size());
+  delay_.emit(vuCb_, std::move(vuLevels), now);
 }
 
-void PulseAudioEngine::computeFftAndPublish(const float* frame) {
-  // Apply Hamming window
-  for (int i = 0; i < plan_.fftSize; ++i) {
-    float w = 0.54f - 0.46f * std::cos(2.0 * kPI * i / (plan_.fftSize - 1));
-    kiss_->in[i] = frame[i] * w;
-  }
-
-  kiss_fftr(kiss_->cfg, kiss_->in.data(), kiss_->out.data());
-
-  auto& out = specBuf_.writeBuf();
-  out.resize(plan_.columns);
-  const float dbFloor = plan_.dbFloor;
+void PulseAudioEngine::publishStereo() {
+  if (replaying_ || !demand_.wants(Product::Stereo)) return;
 
-  for (int b = 0; b < plan_.columns; ++b) {
-    double sum = 0;
-    int cnt = 0;
-    for (int j = binmap_.start[b]; j < binmap_.end[b]; ++j, ++cnt) {
-      double re = kiss_->out[j].r;
-      double im = kiss_->out[j].i;
-      const double ampScale = 2.0 / double(plan_.fftSize);
-      sum += std::sqrt(re * re + im * im) * ampScale;
-    }
-    double lin = cnt > 0 ? sum / cnt : 0.0;
-    double db = 20.0 * std::log10(lin + 1e-20);
-
-    double clamped = std::max(db, (double)dbFloor);
-    double norm = double(b + 10) / double(plan_.columns + 10);
-    double gain = std::pow(norm, (double)tiltExp_);
-    float v = float(((clamped - dbFloor) / -dbFloor) * gain * masterGain_);
-    if (clampUnit_) v = std::max(0.0f, std::min(1.0f, v));
-
-    out[b] = static_cast<uint8_t>(std::round(v * 255.0f));
+  StereoFrame frame;
+  {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    stereo_.read(frame);
   }
-
-  specBuf_.publish();
-  if (cb_) cb_(specBuf_.readBuf());
+  delay_.emit(stereoCb_, std::move(frame), DelayLine::Clock::now());
 }
@@ -5,8 +5,12 @@
 #include <mutex>
 #include <condition_variable>
 #include <pulse/pulseaudio.h>
-#include "ringbuffers.h"
 #include "fft_bands.h"
+#include "spectrum_analyzer.h"
+#include "silence_detector.h"
+#include "delay_line.h"
+#include "spectrum_log.h"
+#include "vu_meter.h"
 
 class PulseAudioEngine : public AudioEngine {
 public:
@@ -14,9 +18,11 @@ public:
   ~PulseAudioEngine() override;
 
   // AudioEngine interface implementation
+  void initialize() override;
   std::vector<DeviceInfo> listDevices() override;
   bool setDevice(const std::string& deviceId) override;
   DeviceInfo currentDevice() override;
+  CaptureFormat captureFormat() override;
 
   void setFftSize(int fft) override;
   void setHopSize(int hop) override;
@@ -26,17 +32,61 @@ public:
   void setTilt(float exp) override;
   void setLoopback(bool on) override;
   void enable(bool on) override;
+  void setPaused(bool paused) override;
+  bool paused() override;
   void setCallback(FftCallback cb) override;
   void setWaveCallback(WaveCallback cb) override;
   void setVuCallback(VuCallback cb) override;
+  void setStereoCallback(StereoCallback cb) override;
+
+  void setSpectrogram(float seconds, bool rgba) override;
+  void setSpectrogramColormap(const std::vector<uint8_t>& lut) override;
+  bool spectrogramSnapshot(SpectrogramRows& out) override;
+  void setSpectrogramCallback(SpectrogramCallback cb) override;
+
+  void setProfile(const std::string& name, const ProfileSpec& spec) override;
+  void removeProfile(const std::string& name) override;
+  void setProfileCallback(ProfileCallback cb) override;
+  void setModuleCallback(ModuleCallback cb) override;
+  void setPitchRange(float minHz, float maxHz) override;
+  void setPitchCallback(PitchCallback cb) override;
+  void setAgc(const AgcSettings& s) override;
+  AgcSettings agc() override;
+  float agcGainDb() override;
+  void setNormalizer(const NormalizerSettings& s) override;
+  NormalizerSettings normalizer() override;
+
+  std::vector<TaskGraph::NodeStats> analyzerStats() override;
+
+  void setSilenceDetection(bool enabled, float thresholdDb, int holdMs) override;
+  bool isIdle() override;
+
+  void setCpuBudget(float fraction) override;
+  QualityInfo quality() override;
+  void setAnalysisRate(int hz) override;
+  void setChannelMode(ChannelMode mode) override;
+  ChannelMode channelMode() override;
+
+  void setOutputDelayMs(int ms) override;
+  int outputDelayMs() override;
+
+  void startLog(const std::string& path, bool logWave) override;
+  void stopLog() override;
+  void replayLog(const std::string& path, double fromMs, double toMs, double speed) override;
+  void stopReplay() override;
 
 private:
   void start();
   void stop();
-  void computeFftAndPublish(const float* frame);
   void computeAndPublishVu();
+  void publishStereo();
   void publishWaveform();
+  void publishSpectrogram();
   void processAudioData(const void* data, size_t bytes);
+  // Mainloop locked for these three
+  CaptureFormat nativeFormat(const std::string& deviceId);
+  pa_stream* openStream(const std::string& deviceId, bool corked, CaptureFormat* format);
+  void applyFormat(const CaptureFormat& f);
 
   // PulseAudio callbacks
   static void contextStateCallback(pa_context* c, void* userdata);
@@ -47,6 +97,7 @@ private:
 
   // PulseAudio objects
   bool mainloopRunning_ = false;
+  std::mutex initMutex_;
   pa_threaded_mainloop* mainloop_ = nullptr;
   pa_context* context_ = nullptr;
   pa_stream* stream_ = nullptr;
@@ -55,6 +106,8 @@ private:
   std::string currentDeviceName_;
   DeviceInfo::Flow currentFlow_ = DeviceInfo::Flow::Capture;
   std::atomic<bool> running_{false};
+  std::atomic<bool> paused_{false};   // stream kept but inactive
+  std::atomic<bool> resumed_{false};  // capture thread flushes stale audio
   std::atomic<bool> contextReady_{false};
 
   // Device list synchronization
@@ -63,34 +116,47 @@ private:
   std::condition_variable deviceListCond_;
   bool deviceListReady_ = false;
 
-  BandPlan plan_{};
-  BinMap binmap_{};
+  BandPlan plan_{};   // JS thread only; other threads read analyzer_.plan()
+  SpectrumAnalyzer analyzer_;
+  std::vector<float> mono_;  // scratch: analyzer input of the current block
+  std::vector<float> right_; // scratch: right channel in dual mode
+  std::atomic<ChannelMode> channelMode_{ChannelMode::Left};
+  std::vector<float> interleaved_;  // scratch: integer blocks converted to float
+  SilenceDetector silence_;
   int sampleRate_ = 0;
-  FloatRingBuffer sampleBuf_{4096*4};
-  TripleBuffer<uint8_t> specBuf_{256};
   FftCallback cb_;
   VuCallback vuCb_;
+  StereoCallback stereoCb_;
+  SpectrogramCallback spectrogramCb_;
+  SpectrogramRows spectrogramRows_;  // reused by the publish side
+  ProfileCallback profileCb_;
+  ModuleCallback moduleCb_;
+  PitchCallback pitchCb_;
+  DelayLine delay_;                  // sits between every product and its callback
+  SpectrumLogWriter log_;
+  std::atomic<bool> replaying_{false};  // live output muted while a log plays back
+  std::atomic<bool> stopReplay_{false};
+  float spectrogramSeconds_ = 0.0f;   // history length; > 0 holds Product::Spectrogram
   WaveCallback waveCb_;
 
-  // Audio format
+  // Audio format of stream_ (mainloop locked); reported_ is the copy
+  // captureFormat() hands out
   int nChannels_ = 0;
-  bool isFloat_ = false;
+  SampleFormat format_ = SampleFormat::F32;
+  CaptureFormat reported_;
+  std::mutex formatMutex_;
 
   // Output shaping
   float masterGain_ = 1.0f;
   float tiltExp_ = 0.35f;
-  bool clampUnit_ = true;
   bool loopback_ = true;
 
-  // kissfft state
-  struct Kiss;
-  Kiss* kiss_ = nullptr;
-
   std::vector<float> waveformBuf_;
   std::mutex waveformMutex_;
 
   // VU meter state
-  std::vector<std::vector<float>> vuBufs_;
+  VuHistory vu_;                   // planar, one ring per channel
+  StereoMeter stereo_;             // guarded by vuMutex_ like vu_
   std::mutex vuMutex_;
 
   // Timing for periodic callbacks
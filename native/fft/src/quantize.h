@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Wire encodings for spectrum levels. The analyzer works in float (0..1 when
+// clamped); each consumer picks how the levels are packed for it.
+enum class SpectrumFormat : int {
+  U8 = 0,    // 0..255
+  U16,       // 0..65535
+  F16,       // IEEE 754 half, raw bits (JS receives them in a Uint16Array)
+  F32,       // unquantized
+};
+
+inline size_t spectrumFormatBytes(SpectrumFormat f) {
+  switch (f) {
+    case SpectrumFormat::U8:  return 1;
+    case SpectrumFormat::U16: return 2;
+    case SpectrumFormat::F16: return 2;
+    case SpectrumFormat::F32: return 4;
+  }
+  return 1;
+}
+
+inline const char* spectrumFormatName(SpectrumFormat f) {
+  switch (f) {
+    case SpectrumFormat::U8:  return "uint8";
+    case SpectrumFormat::U16: return "uint16";
+    case SpectrumFormat::F16: return "float16";
+    case SpectrumFormat::F32: return "float32";
+  }
+  return "uint8";
+}
+
+// Returns false for an unknown name and leaves out untouched.
+inline bool parseSpectrumFormat(const std::string& name, SpectrumFormat* out) {
+  for (int i = 0; i <= (int)SpectrumFormat::F32; ++i) {
+    if (name == spectrumFormatName((SpectrumFormat)i)) {
+      *out = (SpectrumFormat)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace quantize_detail {
+
+// The loops below are kept branch-free (min/max and selects only) so the
+// compiler turns each into a straight SIMD pass over the row.
+
+template <typename T>
+inline void toUnsigned(const float* in, size_t n, float scale, T* out) {
+  for (size_t i = 0; i < n; ++i) {
+    float v = in[i] * scale + 0.5f;
+    v = v < 0.0f ? 0.0f : v;
+    v = v > scale ? scale : v;
+    out[i] = (T)(int32_t)v;
+  }
+}
+
+// Round-to-nearest-even float -> half. Levels are never NaN; infinities and
+// anything past 65504 saturate to +-inf, tiny values become subnormals.
+inline uint16_t toHalf(uint32_t x) {
+  const uint32_t sign = (x >> 16) & 0x8000u;
+  x &= 0x7fffffffu;
+
+  // Subnormal result: let the FPU align the mantissa by adding a magic number
+  const uint32_t denormMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+  float denormMagic, f;
+  std::memcpy(&denormMagic, &denormMagicBits, 4);
+  std::memcpy(&f, &x, 4);
+  f += denormMagic;
+  uint32_t sub;
+  std::memcpy(&sub, &f, 4);
+  sub -= denormMagicBits;
+
+  // Normal result: rebias the exponent and round on the dropped 13 bits
+  const uint32_t odd = (x >> 13) & 1u;
+  const uint32_t norm = (x + ((uint32_t)(15 - 127) << 23) + 0xfffu + odd) >> 13;
+
+  // Select with masks rather than branches
+  const uint32_t isSub = 0u - (uint32_t)(x < (113u << 23));
+  const uint32_t isInf = 0u - (uint32_t)(x >= ((127u + 16u) << 23));
+  uint32_t h = (sub & isSub) | (norm & ~isSub);
+  h = (0x7c00u & isInf) | (h & ~isInf);
+  return (uint16_t)(h | sign);
+}
+
+}  // namespace quantize_detail
+
+// Packs n levels into out, which must hold n * spectrumFormatBytes(f) bytes.
+// Integer formats clamp to 0..1 first.
+inline void encodeSpectrum(const float* in, size_t n, SpectrumFormat f, void* out) {
+  switch (f) {
+    case SpectrumFormat::U8:
+      quantize_detail::toUnsigned(in, n, 255.0f, static_cast<uint8_t*>(out));
+      break;
+    case SpectrumFormat::U16:
+      quantize_detail::toUnsigned(in, n, 65535.0f, static_cast<uint16_t*>(out));
+      break;
+    case SpectrumFormat::F16: {
+      uint16_t* o = static_cast<uint16_t*>(out);
+      for (size_t i = 0; i < n; ++i) {
+        uint32_t x;
+        std::memcpy(&x, &in[i], 4);
+        o[i] = quantize_detail::toHalf(x);
+      }
+      break;
+    }
+    case SpectrumFormat::F32:
+      std::memcpy(out, in, n * sizeof(float));
+      break;
+  }
+}
+
+// Inverse of the uint8 encoding, for data read back from a spectrum log.
+inline void decodeSpectrumU8(const uint8_t* in, size_t n, float* out) {
+  for (size_t i = 0; i < n; ++i) out[i] = in[i] * (1.0f / 255.0f);
+}
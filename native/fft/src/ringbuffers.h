@@ -13,6 +13,7 @@ public:
   explicit FloatRingBuffer(size_t size): buf_(size) {}
   size_t count() const { return count_; }
   size_t capacity() const { return buf_.size(); }
+  void clear() { wpos_ = 0; count_ = 0; }
   void write(const float* src, size_t n) {
     for (size_t i=0;i<n;++i){ buf_[wpos_] = src[i]; wpos_=(wpos_+1)%buf_.size(); if(count_<buf_.size())++count_; }
   }
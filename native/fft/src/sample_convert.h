@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Interleaved PCM layouts a capture stream may negotiate. Everything is
+// little-endian; the analyzer always works on float.
+enum class SampleFormat : int {
+  F32 = 0,   // IEEE float, -1..1
+  S16,       // 16-bit signed
+  S24,       // 24-bit signed, packed in 3 bytes
+  S24_32,    // 24-bit signed in the low bits of 4 bytes
+  S32,       // 32-bit signed
+};
+
+// Native capture format as negotiated with the sound server.
+struct CaptureFormat {
+  int sampleRate = 0;
+  int channels = 0;
+  SampleFormat format = SampleFormat::F32;
+};
+
+inline size_t sampleFormatBytes(SampleFormat f) {
+  switch (f) {
+    case SampleFormat::F32:    return 4;
+    case SampleFormat::S16:    return 2;
+    case SampleFormat::S24:    return 3;
+    case SampleFormat::S24_32: return 4;
+    case SampleFormat::S32:    return 4;
+  }
+  return 4;
+}
+
+inline const char* sampleFormatName(SampleFormat f) {
+  switch (f) {
+    case SampleFormat::F32:    return "f32";
+    case SampleFormat::S16:    return "s16";
+    case SampleFormat::S24:    return "s24";
+    case SampleFormat::S24_32: return "s24_32";
+    case SampleFormat::S32:    return "s32";
+  }
+  return "f32";
+}
+
+namespace sample_convert_detail {
+
+// Each kernel is a flat loop with a single multiply per sample so the
+// compiler vectorizes it. Loads go through memcpy to stay alignment-safe.
+inline void fromS16(const uint8_t* in, size_t n, float* out) {
+  const float k = 1.0f / 32768.0f;
+  for (size_t i = 0; i < n; ++i) {
+    int16_t v;
+    std::memcpy(&v, in + i * 2, 2);
+    out[i] = v * k;
+  }
+}
+
+inline void fromS32(const uint8_t* in, size_t n, float* out) {
+  const float k = 1.0f / 2147483648.0f;
+  for (size_t i = 0; i < n; ++i) {
+    int32_t v;
+    std::memcpy(&v, in + i * 4, 4);
+    out[i] = (float)v * k;
+  }
+}
+
+// The shift pair sign-extends bit 23
+inline void fromS24_32(const uint8_t* in, size_t n, float* out) {
+  const float k = 1.0f / 8388608.0f;
+  for (size_t i = 0; i < n; ++i) {
+    int32_t v;
+    std::memcpy(&v, in + i * 4, 4);
+    out[i] = (float)((int32_t)((uint32_t)v << 8) >> 8) * k;
+  }
+}
+
+// Assembles each sample into the top three bytes of an int32 so the sign
+// comes for free, then scales by 2^-31
+inline void fromS24(const uint8_t* in, size_t n, float* out) {
+  const float k = 1.0f / 2147483648.0f;
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t* p = in + i * 3;
+    const uint32_t u = ((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24);
+    out[i] = (float)(int32_t)u * k;
+  }
+}
+
+}  // namespace sample_convert_detail
+
+// Converts n interleaved samples (frames * channels) to float in out.
+inline void convertToFloat(const void* in, SampleFormat f, size_t n, float* out) {
+  const uint8_t* p = static_cast<const uint8_t*>(in);
+  switch (f) {
+    case SampleFormat::F32:    std::memcpy(out, p, n * sizeof(float)); break;
+    case SampleFormat::S16:    sample_convert_detail::fromS16(p, n, out); break;
+    case SampleFormat::S24:    sample_convert_detail::fromS24(p, n, out); break;
+    case SampleFormat::S24_32: sample_convert_detail::fromS24_32(p, n, out); break;
+    case SampleFormat::S32:    sample_convert_detail::fromS32(p, n, out); break;
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Decides when the captured signal has been silent long enough for the
+// engine to go idle. Runs on the capture thread over every block.
+//
+// Going idle needs the peak to stay under the threshold for holdMs; waking up
+// needs a single block above it, so the block that carries an onset is
+// always analysed.
+class SilenceDetector {
+public:
+  void setSampleRate(int rate) { sampleRate_ = rate > 0 ? rate : 48000; reset(); }
+  void setEnabled(bool on) { enabled_ = on; }
+  void setThresholdDb(float db) { threshold_ = std::pow(10.0f, db / 20.0f); thresholdDb_ = db; }
+  void setHoldMs(int ms) { holdMs_ = ms < 0 ? 0 : ms; }
+
+  bool enabled() const { return enabled_; }
+  float thresholdDb() const { return thresholdDb_; }
+  int holdMs() const { return holdMs_; }
+  bool idle() const { return idle_; }
+
+  void reset() {
+    silentFrames_ = 0;
+    idle_ = false;
+  }
+
+  // samples: interleaved block of frames * channels. Returns the idle state
+  // that applies to this block.
+  bool update(const float* samples, size_t frames, int channels) {
+    if (!enabled_) {
+      if (idle_) reset();
+      return false;
+    }
+
+    float peak = 0.0f;
+    const size_t n = frames * (size_t)channels;
+    for (size_t i = 0; i < n; ++i) {
+      float a = std::fabs(samples[i]);
+      peak = a > peak ? a : peak;
+    }
+    return updatePeak(peak, frames);
+  }
+
+  // For blocks the driver already flagged as silent.
+  bool updateSilent(size_t frames) { return enabled_ ? updatePeak(0.0f, frames) : false; }
+
+private:
+  bool updatePeak(float peak, size_t frames) {
+    if (peak > threshold_.load()) {
+      silentFrames_ = 0;
+      idle_ = false;
+      return false;
+    }
+    silentFrames_ += frames;
+    if (!idle_ && silentFrames_ * 1000 >= (uint64_t)holdMs_ * (uint64_t)sampleRate_) {
+      idle_ = true;
+    }
+    return idle_;
+  }
+
+  int sampleRate_ = 48000;
+  std::atomic<bool> enabled_{true};
+  std::atomic<float> threshold_{0.00003162f};  // -90 dBFS
+  std::atomic<float> thresholdDb_{-90.0f};
+  std::atomic<int> holdMs_{2000};
+  uint64_t silentFrames_ = 0;
+  std::atomic<bool> idle_{false};
+};
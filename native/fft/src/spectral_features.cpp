@@ -0,0 +1,82 @@
+#include "analyzer_module.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Classic per-hop timbre descriptors, for beat/onset-driven overlay effects.
+// All of them work on the power spectrum: the analyzer's Hamming window
+// leaks a slow 1/k tail off every tone, which would drag magnitude-weighted
+// features toward the middle of the band.
+//   [0] centroid in Hz (brightness), 0 while silent
+//   [1] rolloff in Hz: 85 % of the spectral energy lies below it
+//   [2] flatness 0..1: geometric over arithmetic mean, ~0.56 = white noise,
+//       0 = pure tones
+//   [3] flux 0..1: rise in power since the previous hop, relative to the
+//       total, the usual onset detection function
+class SpectralFeatures : public IAnalyzer {
+public:
+  size_t configure(const ModulePlan& plan) override {
+    prev_.assign(plan.fftSize / 2 + 1, 0.0f);
+    primed_ = false;
+    return 4;
+  }
+
+  void process(const FrameView& f) override {
+    const float* m = f.magnitude;
+    const size_t n = std::min(f.bins, prev_.size());
+    double sum = 0.0, weighted = 0.0, logSum = 0.0, rise = 0.0;
+    // DC says nothing about timbre
+    for (size_t j = 1; j < n; ++j) {
+      const float p = m[j] * m[j];
+      sum += p;
+      weighted += double(p) * j;
+      logSum += std::log(p + 1e-20);
+      const float d = p - prev_[j];
+      if (d > 0.0f) rise += d;
+      prev_[j] = p;
+    }
+
+    if (sum < 1e-14 || n < 2) {
+      centroid_ = rolloff_ = flatness_ = flux_ = 0.0f;
+      primed_ = true;
+      return;
+    }
+
+    centroid_ = float(weighted / sum * f.binHz);
+    const double target = 0.85 * sum;
+    double acc = 0.0;
+    size_t k = 1;
+    for (; k < n; ++k) {
+      acc += prev_[k];
+      if (acc >= target) break;
+    }
+    rolloff_ = float(std::min(k, n - 1) * f.binHz);
+    const double mean = sum / (n - 1);
+    flatness_ = float(std::min(1.0, std::exp(logSum / (n - 1)) / mean));
+    // The first hop has nothing to compare against
+    flux_ = primed_ ? float(std::min(1.0, rise / sum)) : 0.0f;
+    primed_ = true;
+  }
+
+  void publish(FrameWriter& out) override {
+    out[0] = centroid_;
+    out[1] = rolloff_;
+    out[2] = flatness_;
+    out[3] = flux_;
+  }
+
+  void reset() override {
+    std::fill(prev_.begin(), prev_.end(), 0.0f);
+    primed_ = false;
+  }
+
+private:
+  std::vector<float> prev_;  // power per bin of the last hop
+  bool primed_ = false;
+  float centroid_ = 0.0f, rolloff_ = 0.0f, flatness_ = 0.0f, flux_ = 0.0f;
+};
+
+}  // namespace
+
+REGISTER_ANALYZER_MODULE(SpectralFeatures, "spectral");
@@ -0,0 +1,139 @@
+#include "spectrogram.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Default colormap: black -> indigo -> magenta -> orange -> pale yellow,
+// close to the perceptual "inferno" ramp used by most waterfall displays.
+void buildDefaultLut(std::vector<uint8_t>& lut) {
+  static const float stops[][4] = {
+    {0.00f,   0,   0,   4},
+    {0.25f,  87,  16, 110},
+    {0.50f, 188,  55,  84},
+    {0.75f, 249, 142,   9},
+    {1.00f, 252, 255, 164},
+  };
+  const int nStops = sizeof(stops) / sizeof(stops[0]);
+  lut.resize(256 * 4);
+  for (int i = 0; i < 256; ++i) {
+    float t = i / 255.0f;
+    int k = 0;
+    while (k < nStops - 2 && t > stops[k + 1][0]) ++k;
+    float u = (t - stops[k][0]) / (stops[k + 1][0] - stops[k][0]);
+    for (int c = 0; c < 3; ++c) {
+      float v = stops[k][c + 1] + u * (stops[k + 1][c + 1] - stops[k][c + 1]);
+      lut[i * 4 + c] = (uint8_t)std::max(0.0f, std::min(255.0f, v + 0.5f));
+    }
+    lut[i * 4 + 3] = 255;
+  }
+}
+
+}  // namespace
+
+SpectrogramHistory::SpectrogramHistory() {
+  buildDefaultLut(lut_);
+}
+
+void SpectrogramHistory::configure(int columns, int rows, double rowSeconds) {
+  std::lock_guard<std::mutex> lock(mu_);
+  columns_ = std::max(0, columns);
+  rows_ = std::max(0, rows);
+  rowSeconds_ = rowSeconds;
+  image_.assign((size_t)columns_ * rows_, 0);
+  head_ = 0;
+  filled_ = 0;
+  published_ = appended_;
+}
+
+void SpectrogramHistory::setRgba(bool on) {
+  std::lock_guard<std::mutex> lock(mu_);
+  rgba_ = on;
+}
+
+void SpectrogramHistory::setColormap(const uint8_t* lut, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (lut && bytes == 256 * 4) {
+    lut_.assign(lut, lut + bytes);
+  } else {
+    buildDefaultLut(lut_);
+  }
+}
+
+void SpectrogramHistory::append(const uint8_t* row, int columns) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (rows_ == 0 || columns != columns_) return;
+
+  uint8_t* dst = image_.data() + head_;
+  for (int c = 0; c < columns_; ++c) {
+    dst[(size_t)c * rows_] = row[c];
+  }
+  head_ = (head_ + 1) % rows_;
+  filled_ = std::min(filled_ + 1, rows_);
+  ++appended_;
+}
+
+inline void SpectrogramHistory::emit(uint8_t v, uint8_t* dst) const {
+  if (rgba_) {
+    std::memcpy(dst, &lut_[v * 4], 4);
+  } else {
+    *dst = v;
+  }
+}
+
+bool SpectrogramHistory::takeNewRows(SpectrogramRows& out) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (rows_ == 0 || appended_ == published_) return false;
+
+  // If the consumer fell behind by more than the history, skip what was overwritten
+  int n = (int)std::min<uint64_t>(appended_ - published_, (uint64_t)filled_);
+  const int bpp = rgba_ ? 4 : 1;
+
+  out.columns = columns_;
+  out.rows = n;
+  out.rgba = rgba_;
+  out.columnMajor = false;
+  out.firstRow = appended_ - n;
+  out.rowSeconds = rowSeconds_;
+  out.data.resize((size_t)n * columns_ * bpp);
+
+  int r = (head_ - n + rows_) % rows_;
+  uint8_t* dst = out.data.data();
+  for (int i = 0; i < n; ++i) {
+    for (int c = 0; c < columns_; ++c, dst += bpp) {
+      emit(image_[(size_t)c * rows_ + r], dst);
+    }
+    r = (r + 1) % rows_;
+  }
+
+  published_ = appended_;
+  return true;
+}
+
+bool SpectrogramHistory::snapshot(SpectrogramRows& out) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (rows_ == 0 || filled_ == 0) return false;
+
+  const int n = filled_;
+  const int bpp = rgba_ ? 4 : 1;
+  const int oldest = (head_ - n + rows_) % rows_;
+
+  out.columns = columns_;
+  out.rows = n;
+  out.rgba = rgba_;
+  out.columnMajor = true;
+  out.firstRow = appended_ - n;
+  out.rowSeconds = rowSeconds_;
+  out.data.resize((size_t)n * columns_ * bpp);
+
+  uint8_t* dst = out.data.data();
+  for (int c = 0; c < columns_; ++c) {
+    const uint8_t* col = image_.data() + (size_t)c * rows_;
+    int r = oldest;
+    for (int i = 0; i < n; ++i, dst += bpp) {
+      emit(col[r], dst);
+      r = (r + 1 == rows_) ? 0 : r + 1;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// A batch of spectrogram rows handed to the publish side.
+struct SpectrogramRows {
+  int columns = 0;
+  int rows = 0;
+  bool rgba = false;          // 4 bytes per cell through the colormap, else 1
+  bool columnMajor = false;   // true only for full-history snapshots
+  uint64_t firstRow = 0;      // sequence number of the first row in data
+  double rowSeconds = 0.0;    // audio time per row, the hop actually analysed
+  std::vector<uint8_t> data;
+};
+
+// Rolling waterfall history of the last N analysis frames.
+//
+// The image is stored column-major (every frequency column is a contiguous
+// strip of history), one row per analysis frame, in a ring so appending is
+// O(columns) with no allocation. The publish side pulls only the rows
+// appended since its last call, optionally expanded to RGBA through a
+// 256-entry colormap, so clients never have to rebuild history themselves.
+class SpectrogramHistory {
+public:
+  SpectrogramHistory();
+
+  // Resets history. rows == 0 disables the history.
+  void configure(int columns, int rows, double rowSeconds);
+  bool enabled() const { return rows_ > 0; }
+  int rows() const { return rows_; }
+  int columns() const { return columns_; }
+  double rowSeconds() const { return rowSeconds_; }
+
+  void setRgba(bool on);
+  // lut holds 256 RGBA entries (1024 bytes); anything else restores the default.
+  void setColormap(const uint8_t* lut, size_t bytes);
+
+  // Capture thread: appends one frame. Ignored if the width does not match.
+  void append(const uint8_t* row, int columns);
+
+  // Publish thread: rows appended since the previous call, oldest first,
+  // row-major. Returns false when there is nothing new.
+  bool takeNewRows(SpectrogramRows& out);
+
+  // Full history, oldest first, in the native column-major layout.
+  bool snapshot(SpectrogramRows& out);
+
+private:
+  void emit(uint8_t v, uint8_t* dst) const;
+
+  std::mutex mu_;
+  int columns_ = 0;
+  int rows_ = 0;
+  double rowSeconds_ = 0.0;
+  bool rgba_ = false;
+  std::vector<uint8_t> image_;   // image_[c * rows_ + r]
+  int head_ = 0;                 // ring slot of the next row
+  int filled_ = 0;
+  uint64_t appended_ = 0;
+  uint64_t published_ = 0;
+  std::vector<uint8_t> lut_;     // 256 * RGBA
+};
@@ -0,0 +1,536 @@
+#include "spectrum_analyzer.h"
+#include "batch_fft.h"
+#include "quantize.h"
+#include <algorithm>
+#include <cmath>
+
+constexpr double kPI = 3.14159265358979323846;
+
+extern "C" {
+  #include "kiss_fftr.h"
+}
+
+namespace {
+
+void computeTiltGain(std::vector<float>& out, int cols, double tilt, double gain) {
+  out.resize(cols);
+  for (int b = 0; b < cols; ++b) {
+    double norm = double(b + 10) / double(cols + 10);
+    out[b] = float(std::pow(norm, tilt) * gain);
+  }
+}
+
+}  // namespace
+
+struct SpectrumAnalyzer::Kiss {
+  kiss_fftr_cfg cfg = nullptr;
+  int size = 0;
+  std::vector<float> in;
+  std::vector<kiss_fft_cpx> out;
+  // Dual mode: both channels in one batched transform
+  BatchFft batch;
+  std::vector<float> inRight;
+  std::vector<kiss_fft_cpx> outRight;
+
+  ~Kiss() {
+    kiss_fftr_free(cfg);
+  }
+};
+
+SpectrumAnalyzer::SpectrumAnalyzer(int workerThreads)
+  : pool_(workerThreads) {
+  for (const auto& m : analyzerModules()) {
+    modules_.push_back(m.create());
+    out_.modules.emplace_back();
+    out_.modules.back().name = m.name;
+  }
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+  release();
+}
+
+void SpectrumAnalyzer::configure(int sampleRate, const BandPlan& plan) {
+  inputRate_ = sampleRate;
+  decimDirty_ = false;
+  dual_ = dualReq_;
+  modulePlan_ = ModulePlan();  // modules start over with the new stream
+  decim_.configure(sampleRate, decimTarget_);
+  decimated_.assign(Decimator::kChunk / 2 + 1, 0.0f);
+  decimRight_.configure(sampleRate, decimTarget_);
+  decimatedRight_.assign(dual_ ? Decimator::kChunk / 2 + 1 : 0, 0.0f);
+  sampleRate_ = decim_.outputRate();
+  {
+    std::lock_guard<std::mutex> lock(planMutex_);
+    plan_ = plan;
+    plan_.columns = std::max(1, std::min(plan_.columns, 256));
+    pendingPlan_ = plan_;
+    planDirty_ = false;
+  }
+  governor_.reset();
+  rebuild();
+  ring_.reset(new FloatRingBuffer(std::max<size_t>(std::max<size_t>(4096 * 4, (size_t)plan_.fftSize * 2),
+                                                   pitchFrame_.size() * 2)));
+  ringRight_.reset(dual_ ? new FloatRingBuffer(ring_->capacity()) : nullptr);
+  hopFill_ = 0;
+  idle_ = false;
+  out_.index = 0;
+}
+
+void SpectrumAnalyzer::release() {
+  graph_.clear();
+  if (kiss_) {
+    delete kiss_;
+    kiss_ = nullptr;
+  }
+  ring_.reset();
+  ringRight_.reset();
+}
+
+void SpectrumAnalyzer::requestPlan(const BandPlan& plan) {
+  std::lock_guard<std::mutex> lock(planMutex_);
+  pendingPlan_ = plan;
+  pendingPlan_.columns = std::max(1, std::min(pendingPlan_.columns, 256));
+  planDirty_ = true;
+}
+
+void SpectrumAnalyzer::setSpectrogramSeconds(float seconds) {
+  std::lock_guard<std::mutex> lock(planMutex_);
+  spectrogramSeconds_ = std::max(0.0f, seconds);
+  planDirty_ = true;
+}
+
+void SpectrumAnalyzer::setProfile(const std::string& name, const ProfileSpec& spec) {
+  std::lock_guard<std::mutex> lock(planMutex_);
+  ProfileSpec& p = profileSpecs_[name];
+  p = spec;
+  p.columns = std::max(1, std::min(p.columns, 256));
+  planDirty_ = true;
+}
+
+void SpectrumAnalyzer::removeProfile(const std::string& name) {
+  std::lock_guard<std::mutex> lock(planMutex_);
+  if (profileSpecs_.erase(name)) planDirty_ = true;
+}
+
+void SpectrumAnalyzer::setPitchRange(float minHz, float maxHz) {
+  std::lock_guard<std::mutex> lock(planMutex_);
+  pitchMinHz_ = minHz;
+  pitchMaxHz_ = std::max(minHz, maxHz);
+  planDirty_ = true;
+}
+
+BandPlan SpectrumAnalyzer::plan() const {
+  std::lock_guard<std::mutex> lock(planMutex_);
+  return planDirty_ ? pendingPlan_ : plan_;
+}
+
+std::vector<TaskGraph::NodeStats> SpectrumAnalyzer::nodeStats() const {
+  return graph_.stats();
+}
+
+QualityInfo SpectrumAnalyzer::quality() const {
+  QualityInfo q = governor_.info(plan());
+  q.sampleRate = sampleRate_;
+  return q;
+}
+
+void SpectrumAnalyzer::rebuild() {
+  // The governor may run a cheaper plan than requested; the output width and
+  // the spectrogram columns always follow the requested one.
+  run_ = governor_.apply(plan_, &columnStep_);
+  levelDirty_ = false;
+  const int n = run_.fftSize;
+
+  if (!kiss_ || kiss_->size != n) {
+    if (kiss_) {
+      delete kiss_;
+    }
+    kiss_ = new Kiss();
+    kiss_->size = n;
+    kiss_->in.resize(n);
+    kiss_->out.resize(n / 2 + 1);
+    kiss_->cfg = kiss_fftr_alloc(n, 0, nullptr, nullptr);
+
+    frame_.assign(n, 0.0f);
+    magnitude_.assign(n / 2 + 1, 0.0f);
+    magPrefix_.assign(n / 2 + 2, 0.0);
+    window_.resize(n);
+    for (int i = 0; i < n; ++i) {
+      window_[i] = float(0.54 - 0.46 * std::cos(2.0 * kPI * i / (n - 1)));
+    }
+  }
+
+  if (dual_ && kiss_->batch.size() != n) {
+    kiss_->batch.configure(n);
+    kiss_->inRight.resize(n);
+    kiss_->outRight.resize(n / 2 + 1);
+  }
+  if (dual_) {
+    frameRight_.assign(n, 0.0f);
+    magRight_.assign(n / 2 + 1, 0.0f);
+    magPrefixRight_.assign(n / 2 + 2, 0.0);
+  }
+
+  if (ring_ && ring_->capacity() < (size_t)n) {
+    ring_.reset(new FloatRingBuffer((size_t)n * 2));
+    if (ringRight_) ringRight_.reset(new FloatRingBuffer((size_t)n * 2));
+  }
+  // Both channels keep a partial hop across a rebuild or lose it together
+  const size_t rightSize = dual_ ? (size_t)run_.hopSize : 0;
+  if ((int)hop_.size() != run_.hopSize || hopRight_.size() != rightSize) {
+    hop_.assign(run_.hopSize, 0.0f);
+    hopRight_.assign(rightSize, 0.0f);
+    hopFill_ = 0;
+  }
+
+  binmap_ = makeBinMap(sampleRate_, run_.fftSize, plan_.columns);
+  normalizing_ = false;
+  out_.spectrum.assign(dual_ ? 2 * plan_.columns : plan_.columns, 0.0f);
+  rebuildProfiles();
+  shapingDirty_ = true;
+
+  float seconds, pitchMin, pitchMax;
+  {
+    std::lock_guard<std::mutex> lock(planMutex_);
+    seconds = spectrogramSeconds_;
+    pitchMin = pitchMinHz_;
+    pitchMax = pitchMaxHz_;
+  }
+  // One row per hop actually run, so the history keeps covering the
+  // requested seconds when the governor stretches the hop
+  const double rowSeconds = sampleRate_ > 0 ? double(run_.hopSize) / sampleRate_ : 0.0;
+  int rows = seconds > 0.0f && rowSeconds > 0.0
+    ? (int)std::ceil(seconds / rowSeconds) : 0;
+  if (rows != spectrogram_.rows() || plan_.columns != spectrogram_.columns() ||
+      rowSeconds != spectrogram_.rowSeconds()) {
+    spectrogram_.configure(plan_.columns, rows, rowSeconds);
+  }
+
+  ModulePlan mp;
+  mp.sampleRate = sampleRate_;
+  mp.fftSize = run_.fftSize;
+  mp.hopSize = run_.hopSize;
+  mp.dual = dual_;
+  if (mp.sampleRate != modulePlan_.sampleRate || mp.fftSize != modulePlan_.fftSize ||
+      mp.hopSize != modulePlan_.hopSize || mp.dual != modulePlan_.dual) {
+    modulePlan_ = mp;
+    for (size_t i = 0; i < modules_.size(); ++i) {
+      out_.modules[i].values.assign(modules_[i]->configure(mp), 0.0f);
+    }
+  }
+
+  pitch_.configure(sampleRate_, pitchMin, pitchMax);
+  pitchFrame_.assign(pitch_.windowSize(), 0.0f);
+  if (ring_ && ring_->capacity() < pitchFrame_.size()) {
+    ring_.reset(new FloatRingBuffer(pitchFrame_.size() * 2));
+    if (ringRight_) ringRight_.reset(new FloatRingBuffer(pitchFrame_.size() * 2));
+  }
+
+  if (graph_.empty()) buildGraph();
+}
+
+void SpectrumAnalyzer::buildGraph() {
+  graph_.clear();
+  int frame = graph_.addNode("frame", [this] { nodeFrame(); });
+  int fft = fftNode_ = graph_.addNode("fft", [this] { nodeFft(); }, {frame});
+  graph_.addNode("level", [this] { nodeLevel(); }, {frame});
+  int mag = graph_.addNode("magnitude", [this] { nodeMagnitude(); }, {fft});
+  int bands = bandsNode_ = graph_.addNode("bands", [this] { nodeBands(); }, {mag});
+  graph_.addNode("spectrogram", [this] { nodeSpectrogram(); }, {bands});
+  profilesNode_ = graph_.addNode("profiles", [this] { nodeProfiles(); }, {mag});
+  pitchNode_ = graph_.addNode("pitch", [this] { nodePitch(); });
+  moduleNodes_.clear();
+  for (size_t i = 0; i < modules_.size(); ++i) {
+    moduleNodes_.push_back(graph_.addNode(out_.modules[i].name, [this, i] { nodeModule(i); }, {mag}));
+  }
+  graph_.compile();
+}
+
+void SpectrumAnalyzer::rebuildProfiles() {
+  std::map<std::string, ProfileSpec> specs;
+  {
+    std::lock_guard<std::mutex> lock(planMutex_);
+    specs = profileSpecs_;
+  }
+
+  profiles_.resize(specs.size());
+  out_.profiles.resize(specs.size());
+  size_t i = 0;
+  for (const auto& kv : specs) {
+    Profile& p = profiles_[i];
+    p.spec = kv.second;
+    p.binmap = makeSpreadBinMap(sampleRate_, run_.fftSize, p.spec.columns);
+    out_.profiles[i].name = kv.first;
+    out_.profiles[i].spectrum.assign(p.spec.columns, 0.0f);
+    ++i;
+  }
+}
+
+void SpectrumAnalyzer::updateShaping() {
+  shapingDirty_ = false;
+  const double gain = masterGain_;
+  // The normalizer equalizes columns by itself; the tilt would fight it
+  computeTiltGain(tiltGain_, plan_.columns, normalizer_.enabled() ? 0.0 : double(tiltExp_), gain);
+  for (auto& p : profiles_) {
+    computeTiltGain(p.tiltGain, p.spec.columns, p.spec.tilt, gain * p.spec.gain);
+  }
+}
+
+void SpectrumAnalyzer::pushSamples(const float* mono, size_t n,
+                                   std::chrono::steady_clock::time_point firstSample,
+                                   const float* right) {
+  if (!kiss_ || !ring_ || !mono) return;
+  if (decimDirty_ || dualReq_ != dual_) configure(inputRate_, plan());
+  // A dual analyzer fed a single channel shows it on both sides
+  if (!dual_) right = nullptr;
+  else if (!right) right = mono;
+  if (decim_.factor() == 1) {
+    pushFramed(mono, right, n, firstSample);
+    return;
+  }
+
+  // Chunk timestamps are exact; within a chunk the decimated samples are
+  // spaced at the analysis rate, which is what pushFramed() assumes.
+  for (size_t off = 0; off < n; off += Decimator::kChunk) {
+    const size_t len = std::min<size_t>(Decimator::kChunk, n - off);
+    const size_t m = decim_.process(mono + off, len, decimated_.data());
+    if (right) decimRight_.process(right + off, len, decimatedRight_.data());
+    pushFramed(decimated_.data(), right ? decimatedRight_.data() : nullptr, m,
+               firstSample + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                 std::chrono::duration<double>(double(off) / inputRate_)));
+  }
+}
+
+void SpectrumAnalyzer::pushFramed(const float* mono, const float* right, size_t n,
+                                  std::chrono::steady_clock::time_point firstSample) {
+
+  size_t i = 0;
+  while (i < n) {
+    if (planDirty_) {
+      {
+        std::lock_guard<std::mutex> lock(planMutex_);
+        plan_ = pendingPlan_;
+        planDirty_ = false;
+      }
+      rebuild();
+    } else if (levelDirty_) {
+      rebuild();
+    }
+
+    size_t toCopy = std::min(hop_.size() - hopFill_, n - i);
+    std::copy(mono + i, mono + i + toCopy, hop_.begin() + hopFill_);
+    if (right) std::copy(right + i, right + i + toCopy, hopRight_.begin() + hopFill_);
+    hopFill_ += toCopy;
+    i += toCopy;
+
+    if (hopFill_ == hop_.size()) {
+      ring_->write(hop_.data(), hop_.size());
+      if (right) ringRight_->write(hopRight_.data(), hopRight_.size());
+      hopFill_ = 0;
+      const size_t need = std::max((size_t)run_.fftSize, pitchOn_ ? pitchFrame_.size() : 0);
+      if ((active_ || pitchOn_ || modulesOn_) && !idle_ && ring_->count() >= need) {
+        out_.time = firstSample + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(double(i) / sampleRate_));
+        processFrame();
+      }
+    }
+  }
+}
+
+void SpectrumAnalyzer::flushHistory() {
+  for (auto& m : modules_) m->reset();
+  if (ring_) ring_->clear();
+  if (ringRight_) ringRight_->clear();
+  hopFill_ = 0;
+  decim_.reset();
+  decimRight_.reset();
+}
+
+void SpectrumAnalyzer::setIdle(bool idle) {
+  if (idle == idle_) return;
+  idle_ = idle;
+  if (!idle || !kiss_) return;
+
+  std::fill(out_.spectrum.begin(), out_.spectrum.end(), 0.0f);
+  for (auto& p : out_.profiles) std::fill(p.spectrum.begin(), p.spectrum.end(), 0.0f);
+  for (auto& m : out_.modules) std::fill(m.values.begin(), m.values.end(), 0.0f);
+  out_.pitch = PitchEstimate();
+  out_.rmsDb = -120.0f;
+  out_.time = std::chrono::steady_clock::now();
+  nodeSpectrogram();
+  ++out_.index;
+  if (cb_) cb_(out_);
+}
+
+void SpectrumAnalyzer::processFrame() {
+  if (shapingDirty_) updateShaping();
+  // Fixed for the whole graph run so bands and profiles agree
+  if (active_) frameGainDb_ = agc_.update(peakDb_, plan_.dbFloor, double(run_.hopSize) / sampleRate_);
+  // Modules need the FFT even while no spectrum is wanted
+  const bool modules = modulesOn_ && !modules_.empty();
+  graph_.setEnabled(fftNode_, active_ || modules);
+  graph_.setEnabled(bandsNode_, active_);
+  graph_.setEnabled(profilesNode_, active_);
+  graph_.setEnabled(pitchNode_, pitchOn_);
+  for (int id : moduleNodes_) graph_.setEnabled(id, modules);
+  graph_.run(&pool_);
+  ++out_.index;
+  if (cb_) cb_(out_);
+
+  if (governor_.record(graph_.lastCpuUs(), double(run_.hopSize) / sampleRate_)) {
+    levelDirty_ = true;
+  }
+}
+
+void SpectrumAnalyzer::nodeFrame() {
+  ring_->readLatest(frame_.data(), frame_.size());
+  if (dual_) {
+    ringRight_->readLatest(frameRight_.data(), frameRight_.size());
+    float* in = kiss_->inRight.data();
+    for (size_t i = 0; i < frameRight_.size(); ++i) {
+      in[i] = frameRight_[i] * window_[i];
+    }
+  }
+  float* in = kiss_->in.data();
+  for (size_t i = 0; i < frame_.size(); ++i) {
+    in[i] = frame_[i] * window_[i];
+  }
+}
+
+void SpectrumAnalyzer::nodeFft() {
+  if (dual_) {
+    const float* in[2] = { kiss_->in.data(), kiss_->inRight.data() };
+    kiss_fft_cpx* out[2] = { kiss_->out.data(), kiss_->outRight.data() };
+    kiss_->batch.run(in, 2, out);
+  } else {
+    kiss_fftr(kiss_->cfg, kiss_->in.data(), kiss_->out.data());
+  }
+}
+
+void SpectrumAnalyzer::nodeLevel() {
+  double sum = 0.0;
+  for (float s : frame_) sum += double(s) * s;
+  double rms = std::sqrt(sum / std::max<size_t>(1, frame_.size()));
+  out_.rmsDb = float(20.0 * std::log10(rms + 1e-6));
+}
+
+void SpectrumAnalyzer::nodeMagnitude() {
+  const float ampScale = 2.0f / float(run_.fftSize);
+  const kiss_fft_cpx* c = kiss_->out.data();
+  double run = 0.0;
+  magPrefix_[0] = 0.0;
+  for (size_t j = 0; j < magnitude_.size(); ++j) {
+    magnitude_[j] = std::sqrt(c[j].r * c[j].r + c[j].i * c[j].i) * ampScale;
+    run += magnitude_[j];
+    magPrefix_[j + 1] = run;
+  }
+  if (!dual_) return;
+
+  c = kiss_->outRight.data();
+  run = 0.0;
+  magPrefixRight_[0] = 0.0;
+  for (size_t j = 0; j < magRight_.size(); ++j) {
+    magRight_[j] = std::sqrt(c[j].r * c[j].r + c[j].i * c[j].i) * ampScale;
+    run += magRight_[j];
+    magPrefixRight_[j + 1] = run;
+  }
+}
+
+double SpectrumAnalyzer::mapBands(const BinMap& binmap, const double* prefix, const float* tiltGain,
+                                  double dbFloor, double gainDb, int cols, float* out,
+                                  ColumnNormalizer* norm, int normBase) const {
+  const bool clamp = clampUnit_;
+  const int step = columnStep_;
+  double peak = -300.0;
+
+  // With step > 1 (governor under load) adjacent columns are averaged as one
+  // band and only the tilt is applied per column
+  for (int g = 0; g < cols; g += step) {
+    const int last = std::min(g + step, cols) - 1;
+    const int s = binmap.start[g];
+    const int e = binmap.end[last];
+    double lin = e > s ? (prefix[e] - prefix[s]) / (e - s) : 0.0;
+    double db = 20.0 * std::log10(lin + 1e-20);
+    peak = std::max(peak, db);
+
+    double level;
+    if (norm) {
+      level = norm->apply(normBase + g, db + gainDb, dbFloor);
+    } else {
+      double clamped = std::max(db + gainDb, dbFloor);
+      level = (clamped - dbFloor) / -dbFloor;
+    }
+    for (int b = g; b <= last; ++b) {
+      float v = float(level * tiltGain[b]);
+      if (clamp) v = std::max(0.0f, std::min(1.0f, v));
+      out[b] = v;
+    }
+  }
+  return peak;
+}
+
+void SpectrumAnalyzer::nodeBands() {
+  ColumnNormalizer* norm = nullptr;
+  if (normalizer_.enabled()) {
+    // Ranges learned under another layout or before a pause are stale
+    if (!normalizing_) normalizer_.resize((int)out_.spectrum.size());
+    normalizer_.beginFrame(double(run_.hopSize) / sampleRate_);
+    norm = &normalizer_;
+  }
+  normalizing_ = norm != nullptr;
+
+  peakDb_ = mapBands(binmap_, magPrefix_.data(), tiltGain_.data(), plan_.dbFloor, frameGainDb_,
+                     plan_.columns, out_.spectrum.data(), norm);
+  if (dual_) {
+    const double right = mapBands(binmap_, magPrefixRight_.data(), tiltGain_.data(), plan_.dbFloor,
+                                  frameGainDb_, plan_.columns, out_.spectrum.data() + plan_.columns,
+                                  norm, plan_.columns);
+    peakDb_ = std::max(peakDb_, right);
+  }
+  if (norm) norm->endFrame();
+}
+
+void SpectrumAnalyzer::nodeProfiles() {
+  for (size_t i = 0; i < profiles_.size(); ++i) {
+    const Profile& p = profiles_[i];
+    mapBands(p.binmap, magPrefix_.data(), p.tiltGain.data(), p.spec.dbFloor, frameGainDb_,
+             p.spec.columns, out_.profiles[i].spectrum.data());
+  }
+}
+
+void SpectrumAnalyzer::nodeSpectrogram() {
+  if (!spectrogram_.enabled()) return;
+  // Dual mode keeps the left half; the history geometry follows the columns
+  rowBytes_.resize(plan_.columns);
+  encodeSpectrum(out_.spectrum.data(), plan_.columns, SpectrumFormat::U8, rowBytes_.data());
+  spectrogram_.append(rowBytes_.data(), (int)rowBytes_.size());
+}
+
+void SpectrumAnalyzer::nodePitch() {
+  ring_->readLatest(pitchFrame_.data(), pitchFrame_.size());
+  out_.pitch = pitch_.analyze(pitchFrame_.data());
+}
+
+void SpectrumAnalyzer::nodeModule(size_t i) {
+  FrameView v;
+  v.index = out_.index;
+  v.time = out_.time;
+  v.size = frame_.size();
+  v.bins = magnitude_.size();
+  v.binHz = float(sampleRate_) / float(run_.fftSize);
+  v.samples = frame_.data();
+  v.windowed = kiss_->in.data();
+  v.spectrum = reinterpret_cast<const float*>(kiss_->out.data());
+  v.magnitude = magnitude_.data();
+  if (dual_) {
+    v.samplesRight = frameRight_.data();
+    v.windowedRight = kiss_->inRight.data();
+    v.spectrumRight = reinterpret_cast<const float*>(kiss_->outRight.data());
+    v.magnitudeRight = magRight_.data();
+  }
+  modules_[i]->process(v);
+  ModuleFrame& slot = out_.modules[i];
+  FrameWriter w(slot.values.data(), slot.values.size());
+  modules_[i]->publish(w);
+}
@@ -0,0 +1,263 @@
+#pragma once
+#include "agc.h"
+#include "analyzer_module.h"
+#include "column_normalizer.h"
+#include "cpu_governor.h"
+#include "decimator.h"
+#include "fft_bands.h"
+#include "pitch_tracker.h"
+#include "ringbuffers.h"
+#include "spectrogram.h"
+#include "task_graph.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Shaping for one named output profile. Profiles share the FFT with the main
+// output and only differ in band layout and shaping.
+struct ProfileSpec {
+  int columns = 64;
+  float dbFloor = -80.0f;
+  float tilt = 0.0f;
+  float gain = 1.0f;      // on top of the master gain
+};
+
+struct ProfileFrame {
+  std::string name;
+  std::vector<float> spectrum;     // one level per profile column
+};
+
+// Output slot of one analysis module (see analyzer_module.h).
+struct ModuleFrame {
+  std::string name;
+  std::vector<float> values;       // layout defined by the module
+};
+
+// Everything the analyzer produced for one hop. Engines publish from it.
+struct AnalysisFrame {
+  uint64_t index = 0;              // hops since the analyzer was configured
+  std::vector<float> spectrum;     // one level per column, 0..1 when clamped;
+                                   // dual: left columns, then right columns
+  float rmsDb = -120.0f;           // level of the unwindowed frame
+  std::chrono::steady_clock::time_point time;  // capture time of the newest sample
+  std::vector<ProfileFrame> profiles;          // one per named profile
+  PitchEstimate pitch;                         // only updated while pitch tracking is on
+  std::vector<ModuleFrame> modules;            // one per registered module, only updated while on
+};
+
+// Platform-independent analysis core shared by the capture engines.
+//
+// Engines feed mono samples (or a left/right pair in dual mode); the analyzer
+// does hop framing and runs a small task graph per hop:
+//
+//   frame (ring -> windowed FFT input) -+-> fft -> magnitude -+-> bands -> spectrogram
+//                                       +-> level             +-> profiles
+//                                                             +-> one node per module
+//   pitch (ring -> YIN)
+//
+// Independent nodes run in parallel on a fixed worker pool and every node is
+// timed. Plan changes requested from other threads are applied on the next
+// hop boundary, so the capture thread never sees a half-updated plan.
+class SpectrumAnalyzer {
+public:
+  using FrameCallback = std::function<void(const AnalysisFrame&)>;
+
+  explicit SpectrumAnalyzer(int workerThreads = WorkerPool::defaultThreadCount());
+  ~SpectrumAnalyzer();
+
+  SpectrumAnalyzer(const SpectrumAnalyzer&) = delete;
+  SpectrumAnalyzer& operator=(const SpectrumAnalyzer&) = delete;
+
+  // Allocates FFT state and clears history. Call before streaming starts.
+  // sampleRate is the capture rate; analysis may run lower, see setDecimation().
+  void configure(int sampleRate, const BandPlan& plan);
+  // Frees FFT state; pushSamples() becomes a no-op until configure().
+  void release();
+
+  // Thread-safe; takes effect on the next hop boundary.
+  void requestPlan(const BandPlan& plan);
+  void setMasterGain(float g) { masterGain_ = g; shapingDirty_ = true; }
+  void setTilt(float exp) { tiltExp_ = exp; shapingDirty_ = true; }
+  void setClampUnit(bool on) { clampUnit_ = on; }
+  // Automatic gain in front of the dB floor mapping; applies to profiles too.
+  void setAgc(const AgcSettings& s) { agc_.setSettings(s); }
+  AgcSettings agc() const { return agc_.settings(); }
+  float agcGainDb() const { return agc_.gainDb(); }
+  // Per-column percentile normalization of the main output. While enabled it
+  // replaces the dB floor mapping and the tilt curve (master gain still applies).
+  void setNormalizer(const NormalizerSettings& s) { normalizer_.setSettings(s); shapingDirty_ = true; }
+  NormalizerSettings normalizer() const { return normalizer_.settings(); }
+  // Named output profiles; thread-safe, applied on the next hop boundary.
+  // Setting an existing name replaces its spec.
+  void setProfile(const std::string& name, const ProfileSpec& spec);
+  void removeProfile(const std::string& name);
+
+  // Waterfall history length; 0 turns it off. Applied on the next hop boundary.
+  void setSpectrogramSeconds(float seconds);
+  SpectrogramHistory& spectrogram() { return spectrogram_; }
+
+  // Set once by the owning engine before streaming; invoked on the capture thread.
+  void setFrameCallback(FrameCallback cb) { cb_ = std::move(cb); }
+
+  // Capture thread only. firstSample is the capture time of mono[0]; frame
+  // timestamps are derived from it per sample. In dual mode mono is the left
+  // channel and right the right one; right is ignored otherwise.
+  void pushSamples(const float* mono, size_t n,
+                   std::chrono::steady_clock::time_point firstSample = std::chrono::steady_clock::now(),
+                   const float* right = nullptr);
+  // Dual mode: left and right go through one batched FFT and the main
+  // spectrum carries both (left columns, then right). Profiles, pitch, level
+  // and the spectrogram follow the left channel. Thread-safe; applied on the
+  // capture thread, which clears history.
+  void setDual(bool on) { dualReq_ = on; }
+  bool dual() const { return dual_; }
+  // While idle, samples are still framed (so an onset after silence lands in
+  // a complete window) but no analysis runs. Entering idle publishes one
+  // all-zero frame so consumers settle.
+  void setIdle(bool idle);
+  bool idle() const { return idle_; }
+  // Half-band decimation in front of the analysis: high capture rates are
+  // halved towards targetRate (never below 40 kHz). 0 analyses at the capture
+  // rate. Thread-safe; applied on the capture thread, which clears history.
+  void setDecimation(int targetRate) { decimTarget_ = std::max(0, targetRate); decimDirty_ = true; }
+  // Capture thread. Drops buffered audio but keeps plans and scratch, so
+  // analysis picks up cleanly after a gap in the input (e.g. a warm pause).
+  void flushHistory();
+  // Capture thread. Samples still needed to complete the current hop.
+  // Counted at the capture rate.
+  size_t samplesToHopBoundary() const { return (hop_.size() - hopFill_) * decim_.factor(); }
+  // Inactive when no consumer wants spectra. Framing continues so the first
+  // frame after reactivation is built from current audio, but nothing runs.
+  void setActive(bool active) { active_ = active; }
+  bool active() const { return active_; }
+  // Pitch tracking runs on its own window of the ring, independent of the
+  // FFT size, and keeps frames coming while spectra are inactive.
+  void setPitchTracking(bool on) { pitchOn_ = on; }
+  // Analysis modules (analyzer_module.h) run while on; like pitch tracking
+  // they keep frames coming while spectra are inactive.
+  void setModules(bool on) { modulesOn_ = on; }
+  // Detection range in Hz; applied on the next hop boundary.
+  void setPitchRange(float minHz, float maxHz);
+
+  // CPU governor: fraction of one core the analysis may use (0 = off). Under
+  // load the analyzer steps to a cheaper plan and back when load drops.
+  void setCpuBudget(float fraction) { governor_.setBudget(fraction); }
+  QualityInfo quality() const;
+
+  // The requested plan; quality() reports what is actually running.
+  BandPlan plan() const;
+  // Analysis rate, after decimation.
+  int sampleRate() const { return sampleRate_; }
+  std::vector<TaskGraph::NodeStats> nodeStats() const;
+
+private:
+  struct Kiss;
+
+  void rebuild();
+  void buildGraph();
+  // pushSamples() after decimation; samples are at the analysis rate.
+  void pushFramed(const float* mono, const float* right, size_t n,
+                  std::chrono::steady_clock::time_point firstSample);
+  void updateShaping();
+  void processFrame();
+  void rebuildProfiles();
+  // Returns the loudest band in dB before gainDb was added.
+  // prefix is a running sum of magnitudes; norm columns start at normBase.
+  double mapBands(const BinMap& binmap, const double* prefix, const float* tiltGain, double dbFloor,
+                  double gainDb, int cols, float* out, ColumnNormalizer* norm = nullptr,
+                  int normBase = 0) const;
+
+  struct Profile {
+    ProfileSpec spec;
+    BinMap binmap;
+    std::vector<float> tiltGain;
+  };
+
+  // Graph nodes
+  void nodeFrame();
+  void nodeFft();
+  void nodeLevel();
+  void nodeMagnitude();
+  void nodeBands();
+  void nodeProfiles();
+  void nodeSpectrogram();
+  void nodePitch();
+  void nodeModule(size_t i);
+
+  WorkerPool pool_;
+  TaskGraph graph_;
+  int fftNode_ = -1;
+  int pitchNode_ = -1;
+  int bandsNode_ = -1;
+  int profilesNode_ = -1;
+  std::vector<int> moduleNodes_;
+  std::vector<std::unique_ptr<IAnalyzer>> modules_;  // parallel to out_.modules
+  ModulePlan modulePlan_;
+
+  int sampleRate_ = 0;             // analysis rate
+  int inputRate_ = 0;              // capture rate
+  Decimator decim_;
+  std::vector<float> decimated_;   // one decimated chunk
+  Decimator decimRight_;           // dual mode
+  std::vector<float> decimatedRight_;
+  std::atomic<int> decimTarget_{0};
+  std::atomic<bool> decimDirty_{false};
+  BandPlan plan_;                  // requested
+  BandPlan run_;                   // effective, after the governor
+  int columnStep_ = 1;
+  bool levelDirty_ = false;
+  CpuGovernor governor_;
+  Agc agc_;
+  ColumnNormalizer normalizer_;
+  bool normalizing_ = false;       // normalizer state matches the current frame
+  double frameGainDb_ = 0.0;       // AGC gain for the frame being analysed
+  double peakDb_ = -300.0;         // loudest band of the last frame, before AGC
+  BinMap binmap_;
+  Kiss* kiss_ = nullptr;
+  std::unique_ptr<FloatRingBuffer> ring_;
+  std::vector<float> hop_;
+  size_t hopFill_ = 0;
+  std::atomic<bool> dualReq_{false};
+  bool dual_ = false;              // applied on the capture thread
+  std::unique_ptr<FloatRingBuffer> ringRight_;  // dual mode, written in step with ring_
+  std::vector<float> hopRight_;
+  std::atomic<bool> idle_{false};
+  std::atomic<bool> active_{true};
+  std::atomic<bool> pitchOn_{false};
+  std::atomic<bool> modulesOn_{false};
+  PitchTracker pitch_;
+  std::vector<float> pitchFrame_;
+  std::vector<float> frame_;       // raw samples of the current frame
+  std::vector<float> window_;      // precomputed Hamming window
+  std::vector<float> magnitude_;   // per-bin amplitude, shared by consumers
+  std::vector<double> magPrefix_;  // running sum of magnitude_: any band average is O(1)
+  std::vector<float> frameRight_;  // dual mode counterparts
+  std::vector<float> magRight_;
+  std::vector<double> magPrefixRight_;
+  std::vector<Profile> profiles_;  // parallel to out_.profiles
+  std::vector<float> tiltGain_;    // per-column tilt * master gain
+  std::vector<uint8_t> rowBytes_;  // spectrum quantized for the spectrogram
+
+  AnalysisFrame out_;
+  SpectrogramHistory spectrogram_;
+  FrameCallback cb_;
+
+  // Requested from other threads
+  mutable std::mutex planMutex_;
+  BandPlan pendingPlan_;
+  float spectrogramSeconds_ = 0.0f;
+  std::map<std::string, ProfileSpec> profileSpecs_;
+  float pitchMinHz_ = 60.0f;
+  float pitchMaxHz_ = 1500.0f;
+  std::atomic<bool> planDirty_{false};
+  std::atomic<float> masterGain_{1.0f};
+  std::atomic<float> tiltExp_{0.35f};
+  std::atomic<bool> clampUnit_{true};
+  std::atomic<bool> shapingDirty_{true};
+};
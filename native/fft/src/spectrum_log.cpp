@@ -0,0 +1,380 @@
+#include "spectrum_log.h"
+#include "quantize.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+using namespace spectrumlog;
+
+namespace {
+
+const uint32_t kIndexStepTicks = 10000;     // one index entry per second
+const size_t kFlushThreshold = 256 * 1024;  // wake the flush thread early past this
+
+uint64_t tell(std::FILE* f) {
+#ifdef _WIN32
+  return (uint64_t)_ftelli64(f);
+#else
+  return (uint64_t)ftello(f);
+#endif
+}
+
+uint64_t unixMsNow() {
+  using namespace std::chrono;
+  return (uint64_t)duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// Writer
+
+SpectrumLogWriter::~SpectrumLogWriter() {
+  close();
+}
+
+void SpectrumLogWriter::open(const std::string& path, int sampleRate, int columns, bool logWave) {
+  close();
+
+  std::FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) throw std::runtime_error("Cannot create spectrum log: " + path);
+
+  FileHeader h{};
+  std::memcpy(h.magic, "SPLG", 4);
+  h.version = kVersion;
+  h.columns = (uint16_t)columns;
+  h.sampleRate = (uint32_t)sampleRate;
+  h.startUnixMs = unixMsNow();
+  if (std::fwrite(&h, sizeof(h), 1, f) != 1) {
+    std::fclose(f);
+    throw std::runtime_error("Cannot write spectrum log header: " + path);
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  file_ = f;
+  logWave_ = logWave;
+  quit_ = false;
+  start_ = Clock::now();
+  pending_.clear();
+  offset_ = sizeof(FileHeader);
+  index_.clear();
+  nextIndexTicks_ = 0;
+  thread_ = std::thread(&SpectrumLogWriter::flushLoop, this);
+  open_ = true;
+}
+
+void SpectrumLogWriter::close() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!file_) return;
+    open_ = false;
+    quit_ = true;
+  }
+  wake_.notify_all();
+  if (thread_.joinable()) thread_.join();
+
+  // Appends re-check open_ under mu_, so nothing lands after this; loop in
+  // case one landed while the flush thread had the lock released for fwrite
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!pending_.empty()) flushLocked(lock);
+
+  // Where the records actually end, whatever offset_ counted
+  FileFooter footer{};
+  footer.indexOffset = tell(file_);
+  footer.indexCount = (uint32_t)index_.size();
+  std::memcpy(footer.magic, "SPLX", 4);
+  if (!index_.empty()) std::fwrite(index_.data(), sizeof(IndexEntry), index_.size(), file_);
+  std::fwrite(&footer, sizeof(footer), 1, file_);
+  std::fclose(file_);
+  file_ = nullptr;
+}
+
+void SpectrumLogWriter::append(uint8_t type, Clock::time_point t, const void* data, size_t bytes) {
+  const uint8_t* dp = static_cast<const uint8_t*>(data);
+  appendRecord(type, t, bytes, [dp](uint8_t* out, size_t n) { std::memcpy(out, dp, n); });
+}
+
+void SpectrumLogWriter::appendSpectrum(Clock::time_point t, const float* levels, size_t n) {
+  appendRecord(kSpectrum, t, n, [levels](uint8_t* out, size_t m) {
+    encodeSpectrum(levels, m, SpectrumFormat::U8, out);
+  });
+}
+
+void SpectrumLogWriter::appendRecord(uint8_t type, Clock::time_point t, size_t bytes,
+                                     const std::function<void(uint8_t*, size_t)>& fill) {
+  if (!open_) return;
+  bytes = std::min<size_t>(bytes, std::numeric_limits<uint16_t>::max());
+
+  // Frames stamped slightly before open() land on tick 0
+  double ticks = std::chrono::duration<double, std::milli>(t - start_).count() * kTicksPerMs;
+  ticks = std::max(0.0, std::min(ticks, (double)std::numeric_limits<uint32_t>::max()));
+
+  RecordHeader r{};
+  r.type = type;
+  r.bytes = (uint16_t)bytes;
+  r.ticks = (uint32_t)ticks;
+
+  std::unique_lock<std::mutex> lock(mu_);
+  if (!open_ || !file_) return;
+
+  while (r.ticks >= nextIndexTicks_) {
+    index_.push_back(IndexEntry{nextIndexTicks_, offset_});
+    nextIndexTicks_ += kIndexStepTicks;
+  }
+
+  const uint8_t* rp = reinterpret_cast<const uint8_t*>(&r);
+  pending_.insert(pending_.end(), rp, rp + sizeof(r));
+  const size_t at = pending_.size();
+  pending_.resize(at + bytes);
+  fill(pending_.data() + at, bytes);
+  offset_ += sizeof(r) + bytes;
+
+  if (pending_.size() >= kFlushThreshold) {
+    lock.unlock();
+    wake_.notify_one();
+  }
+}
+
+void SpectrumLogWriter::flushLoop() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!quit_) {
+    wake_.wait_for(lock, std::chrono::milliseconds(250));
+    flushLocked(lock);
+  }
+}
+
+void SpectrumLogWriter::flushLocked(std::unique_lock<std::mutex>& lock) {
+  if (pending_.empty()) return;
+  writing_.swap(pending_);
+  lock.unlock();
+  std::fwrite(writing_.data(), 1, writing_.size(), file_);
+  std::fflush(file_);
+  writing_.clear();
+  lock.lock();
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+SpectrumLogReader::~SpectrumLogReader() {
+  close();
+}
+
+void SpectrumLogReader::open(const std::string& path) {
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open spectrum log: " + path);
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    throw std::runtime_error("Spectrum log is empty: " + path);
+  }
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!view) {
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("Cannot map spectrum log: " + path);
+  }
+  file_ = file;
+  mapping_ = mapping;
+  base_ = static_cast<const uint8_t*>(view);
+  size_ = (size_t)size.QuadPart;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("Cannot open spectrum log: " + path);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    throw std::runtime_error("Spectrum log is empty: " + path);
+  }
+  void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (view == MAP_FAILED) {
+    ::close(fd);
+    throw std::runtime_error("Cannot map spectrum log: " + path);
+  }
+  fd_ = fd;
+  base_ = static_cast<const uint8_t*>(view);
+  size_ = (size_t)st.st_size;
+#endif
+
+  if (size_ < sizeof(FileHeader)) {
+    close();
+    throw std::runtime_error("Not a spectrum log: " + path);
+  }
+  std::memcpy(&header_, base_, sizeof(header_));
+  if (std::memcmp(header_.magic, "SPLG", 4) != 0 || header_.version != kVersion) {
+    close();
+    throw std::runtime_error("Not a spectrum log: " + path);
+  }
+
+  // A log from a session that did not shut down cleanly has no footer
+  if (!readFooter()) rebuildIndex();
+
+  records_ = 0;
+  uint32_t maxTicks = 0;
+  size_t off = sizeof(FileHeader);
+  while (off + sizeof(RecordHeader) <= dataEnd_) {
+    RecordHeader r;
+    std::memcpy(&r, base_ + off, sizeof(r));
+    maxTicks = std::max(maxTicks, r.ticks);
+    ++records_;
+    off += sizeof(r) + r.bytes;
+  }
+  durationMs_ = maxTicks / kTicksPerMs;
+}
+
+void SpectrumLogReader::close() {
+#ifdef _WIN32
+  if (base_) UnmapViewOfFile(base_);
+  if (mapping_) CloseHandle((HANDLE)mapping_);
+  if (file_) CloseHandle((HANDLE)file_);
+  mapping_ = nullptr;
+  file_ = nullptr;
+#else
+  if (base_) munmap(const_cast<uint8_t*>(base_), size_);
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+#endif
+  base_ = nullptr;
+  size_ = 0;
+  dataEnd_ = 0;
+  index_.clear();
+  durationMs_ = 0.0;
+  records_ = 0;
+}
+
+bool SpectrumLogReader::readFooter() {
+  if (size_ < sizeof(FileHeader) + sizeof(FileFooter)) return false;
+
+  FileFooter f;
+  std::memcpy(&f, base_ + size_ - sizeof(f), sizeof(f));
+  if (std::memcmp(f.magic, "SPLX", 4) != 0) return false;
+  const uint64_t indexBytes = (uint64_t)f.indexCount * sizeof(IndexEntry);
+  if (f.indexOffset < sizeof(FileHeader) ||
+      f.indexOffset + indexBytes + sizeof(f) != size_) return false;
+
+  index_.resize(f.indexCount);
+  if (f.indexCount) std::memcpy(index_.data(), base_ + f.indexOffset, (size_t)indexBytes);
+  dataEnd_ = (size_t)f.indexOffset;
+  return true;
+}
+
+void SpectrumLogReader::rebuildIndex() {
+  index_.clear();
+  uint32_t next = 0;
+  size_t off = sizeof(FileHeader);
+  while (off + sizeof(RecordHeader) <= size_) {
+    RecordHeader r;
+    std::memcpy(&r, base_ + off, sizeof(r));
+    if (off + sizeof(r) + r.bytes > size_) break;  // torn last record
+    while (r.ticks >= next) {
+      index_.push_back(IndexEntry{next, off});
+      next += kIndexStepTicks;
+    }
+    off += sizeof(r) + r.bytes;
+  }
+  dataEnd_ = off;
+}
+
+size_t SpectrumLogReader::seek(double fromMs) const {
+  // Step back one index entry to pick up records written slightly out of order
+  const double ticks = fromMs * kTicksPerMs - kIndexStepTicks;
+  size_t off = sizeof(FileHeader);
+  auto it = std::upper_bound(index_.begin(), index_.end(), ticks,
+    [](double t, const IndexEntry& e) { return t < e.ticks; });
+  if (it != index_.begin()) off = (size_t)std::prev(it)->offset;
+  return off;
+}
+
+void SpectrumLogReader::scan(double fromMs, double toMs,
+                             const std::function<bool(const SpectrumLogRecord&)>& fn) const {
+  if (!base_) return;
+  // Same slack at the end: stop a full index step past the range
+  const double stopMs = toMs + kIndexStepTicks / kTicksPerMs;
+
+  size_t off = seek(fromMs);
+  while (off + sizeof(RecordHeader) <= dataEnd_) {
+    RecordHeader r;
+    std::memcpy(&r, base_ + off, sizeof(r));
+    if (off + sizeof(r) + r.bytes > dataEnd_) break;
+
+    SpectrumLogRecord rec;
+    rec.type = r.type;
+    rec.timeMs = r.ticks / kTicksPerMs;
+    rec.data = base_ + off + sizeof(r);
+    rec.bytes = r.bytes;
+    off += sizeof(r) + r.bytes;
+
+    if (rec.timeMs >= stopMs) break;
+    if (rec.timeMs < fromMs || rec.timeMs >= toMs) continue;
+    if (!fn(rec)) break;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+
+void replaySpectrumLog(const SpectrumLogReader& reader, double fromMs, double toMs,
+                       double speed, const std::atomic<bool>& stop,
+                       const SpectrumLogSinks& sinks) {
+  using Clock = std::chrono::steady_clock;
+  if (speed <= 0.0) speed = 1.0;
+  const auto wallStart = Clock::now();
+
+  std::vector<uint8_t> bytes;
+  std::vector<float> levels;
+  std::vector<int16_t> samples;
+
+  reader.scan(fromMs, toMs, [&](const SpectrumLogRecord& rec) {
+    const auto due = wallStart + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double, std::milli>((rec.timeMs - fromMs) / speed));
+
+    // Sleep in slices so a stop request is honoured promptly
+    for (;;) {
+      if (stop) return false;
+      auto now = Clock::now();
+      if (now >= due) break;
+      std::this_thread::sleep_for(std::min<Clock::duration>(due - now, std::chrono::milliseconds(50)));
+    }
+
+    switch (rec.type) {
+      case kSpectrum:
+        if (sinks.spectrum) {
+          levels.resize(rec.bytes);
+          decodeSpectrumU8(rec.data, rec.bytes, levels.data());
+          sinks.spectrum(levels);
+        }
+        break;
+      case kVu:
+        if (sinks.vu) {
+          bytes.assign(rec.data, rec.data + rec.bytes);
+          sinks.vu(bytes);
+        }
+        break;
+      case kWave:
+        if (sinks.wave) {
+          samples.resize(rec.bytes / sizeof(int16_t));
+          std::memcpy(samples.data(), rec.data, samples.size() * sizeof(int16_t));
+          sinks.wave(samples);
+        }
+        break;
+      default:
+        break;  // newer record types are skipped
+    }
+    return true;
+  });
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compact binary log of everything the engine published.
+//
+// Layout (little-endian):
+//
+//   FileHeader
+//   { RecordHeader payload }*      appended while streaming
+//   IndexEntry*                    one per second of log time  } written on close,
+//   FileFooter                                                 } rebuilt by a scan if missing
+//
+// Times are stored in 100 us ticks since the log was opened (good for ~5 days).
+// Records are written in publish order, which can run a few ms out of time
+// order between products; readers seek one index step early to cover that.
+namespace spectrumlog {
+
+enum RecordType : uint8_t {
+  kSpectrum = 1,   // uint8 per column
+  kVu = 2,         // uint8 per channel
+  kWave = 3,       // int16 samples
+};
+
+#pragma pack(push, 1)
+struct FileHeader {
+  char magic[4];           // "SPLG"
+  uint16_t version;
+  uint16_t columns;
+  uint32_t sampleRate;
+  uint64_t startUnixMs;    // wall clock at tick 0
+};
+
+struct RecordHeader {
+  uint8_t type;
+  uint8_t reserved;
+  uint16_t bytes;          // payload size
+  uint32_t ticks;          // 100 us units since open
+};
+
+struct IndexEntry {
+  uint32_t ticks;
+  uint64_t offset;         // first record at or after ticks
+};
+
+struct FileFooter {
+  uint64_t indexOffset;
+  uint32_t indexCount;
+  char magic[4];           // "SPLX"
+};
+#pragma pack(pop)
+
+const uint16_t kVersion = 1;
+const double kTicksPerMs = 10.0;
+
+}  // namespace spectrumlog
+
+struct SpectrumLogRecord {
+  uint8_t type = 0;
+  double timeMs = 0.0;
+  const uint8_t* data = nullptr;
+  size_t bytes = 0;
+};
+
+// Appends records from the capture and publish threads. Records go to an
+// in-memory buffer; a background thread writes it out a few times per
+// second so the real-time threads never touch the disk.
+class SpectrumLogWriter {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  SpectrumLogWriter() = default;
+  ~SpectrumLogWriter();
+
+  SpectrumLogWriter(const SpectrumLogWriter&) = delete;
+  SpectrumLogWriter& operator=(const SpectrumLogWriter&) = delete;
+
+  // Throws std::runtime_error if the file cannot be created.
+  void open(const std::string& path, int sampleRate, int columns, bool logWave);
+  // Flushes, writes the index and footer and closes the file.
+  void close();
+
+  bool isOpen() const { return open_; }
+  bool logsWave() const { return logWave_; }
+
+  // t is the capture or publish time of the data.
+  void append(uint8_t type, Clock::time_point t, const void* data, size_t bytes);
+  // Spectrum levels are stored as uint8, quantized straight into the buffer.
+  void appendSpectrum(Clock::time_point t, const float* levels, size_t n);
+
+private:
+  void appendRecord(uint8_t type, Clock::time_point t, size_t bytes,
+                    const std::function<void(uint8_t*, size_t)>& fill);
+  void flushLoop();
+  void flushLocked(std::unique_lock<std::mutex>& lock);
+
+  std::mutex mu_;
+  std::condition_variable wake_;
+  std::thread thread_;
+  std::FILE* file_ = nullptr;
+  std::atomic<bool> open_{false};
+  bool logWave_ = false;
+  bool quit_ = false;
+
+  Clock::time_point start_;
+  std::vector<uint8_t> pending_;        // records not yet on disk
+  std::vector<uint8_t> writing_;        // swapped out by the flush thread
+  uint64_t offset_ = 0;                 // file offset of the end of pending_
+  std::vector<spectrumlog::IndexEntry> index_;
+  uint32_t nextIndexTicks_ = 0;
+};
+
+// Read-only, memory-mapped view of a log for random access and replay.
+class SpectrumLogReader {
+public:
+  SpectrumLogReader() = default;
+  ~SpectrumLogReader();
+
+  SpectrumLogReader(const SpectrumLogReader&) = delete;
+  SpectrumLogReader& operator=(const SpectrumLogReader&) = delete;
+
+  // Throws std::runtime_error if the file is missing or not a log.
+  void open(const std::string& path);
+  void close();
+
+  int columns() const { return header_.columns; }
+  int sampleRate() const { return (int)header_.sampleRate; }
+  uint64_t startUnixMs() const { return header_.startUnixMs; }
+  double durationMs() const { return durationMs_; }
+  size_t records() const { return records_; }
+
+  // Calls fn for every record with fromMs <= time < toMs, in file order.
+  // fn returns false to stop early.
+  void scan(double fromMs, double toMs,
+            const std::function<bool(const SpectrumLogRecord&)>& fn) const;
+
+private:
+  bool readFooter();
+  void rebuildIndex();
+  size_t seek(double fromMs) const;
+
+  const uint8_t* base_ = nullptr;
+  size_t size_ = 0;
+  size_t dataEnd_ = 0;
+#ifdef _WIN32
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  spectrumlog::FileHeader header_{};
+  std::vector<spectrumlog::IndexEntry> index_;
+  double durationMs_ = 0.0;
+  size_t records_ = 0;
+};
+
+// Where replayed records go; unset sinks skip that product.
+struct SpectrumLogSinks {
+  std::function<void(const std::vector<float>&)> spectrum;   // decoded to levels
+  std::function<void(const std::vector<uint8_t>&)> vu;
+  std::function<void(const std::vector<int16_t>&)> wave;
+};
+
+// Plays [fromMs, toMs) back at the original pace (scaled by speed) on the
+// calling thread. Returns early once stop is set.
+void replaySpectrumLog(const SpectrumLogReader& reader, double fromMs, double toMs,
+                       double speed, const std::atomic<bool>& stop,
+                       const SpectrumLogSinks& sinks);
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// One stereo reading, published alongside the VU levels.
+struct StereoFrame {
+  float correlation = 0.0f;   // -1 (out of phase) .. 1 (mono); 0 while silent
+  float balance = 0.0f;       // -1 (left only) .. 1 (right only), from RMS
+  // Vectorscope points gathered since the last reading, as x,y pairs: x is
+  // the side signal (R - L), y the mid (L + R), both scaled by 1/sqrt(2)
+  std::vector<float> points;
+};
+
+// Phase correlation, balance and a decimated goniometer point cloud of the
+// first two capture channels. A mono stream reads as fully correlated.
+//
+// process() can also write the left channel to the analyzer's mono buffer,
+// so the capture thread walks each block once. Not thread-safe: the engine
+// guards it with its VU lock.
+class StereoMeter {
+public:
+  static const int kMaxPoints = 1024;  // held between two readings
+  static const int kPointsPerRead = 400;
+
+  // Integration time of the correlation and balance, and the point rate for
+  // a 60 Hz reader.
+  void configure(int sampleRate, float windowSeconds = 0.3f) {
+    sampleRate_ = std::max(1, sampleRate);
+    window_ = std::max(0.01f, windowSeconds);
+    const int perRead = std::max(1, sampleRate_ / 60);
+    step_ = std::max(1, (perRead + kPointsPerRead - 1) / kPointsPerRead);
+    points_.reserve(2 * kMaxPoints);
+    reset();
+  }
+
+  void reset() {
+    ll_ = rr_ = lr_ = 0.0;
+    phase_ = 0;
+    points_.clear();
+  }
+
+  // Deinterleaves one block: stereo sums and points into the meter, and
+  // channel 0 into mono unless that is null.
+  void process(const float* interleaved, size_t frames, int channels, float* mono) {
+    if (channels <= 0) return;
+    const size_t r = channels > 1 ? 1 : 0;
+    const float k = 0.70710678f;
+    double ll = 0.0, rr = 0.0, lr = 0.0;
+    for (size_t i = 0; i < frames; ++i) {
+      const float* f = interleaved + i * channels;
+      const float L = f[0], R = f[r];
+      if (mono) mono[i] = L;
+      ll += L * L;
+      rr += R * R;
+      lr += L * R;
+      if (++phase_ >= step_) {
+        phase_ = 0;
+        // A late reader loses the newest points, not the allocation
+        if (points_.size() < 2 * (size_t)kMaxPoints) {
+          points_.push_back((R - L) * k);
+          points_.push_back((L + R) * k);
+        }
+      }
+    }
+    // Blocks arrive in varying sizes; decay by the time each one covers
+    const double a = std::exp(-double(frames) / (window_ * sampleRate_));
+    ll_ = ll_ * a + ll;
+    rr_ = rr_ * a + rr;
+    lr_ = lr_ * a + lr;
+  }
+
+  // Fills out and starts a new point batch.
+  void read(StereoFrame& out) {
+    const double energy = std::sqrt(ll_ * rr_);
+    out.correlation = energy > 1e-12 ? (float)std::max(-1.0, std::min(1.0, lr_ / energy)) : 0.0f;
+    const double l = std::sqrt(ll_), r = std::sqrt(rr_);
+    out.balance = (l + r) > 1e-9 ? (float)((r - l) / (l + r)) : 0.0f;
+    out.points.assign(points_.begin(), points_.end());
+    points_.clear();
+  }
+
+private:
+  int sampleRate_ = 48000;
+  float window_ = 0.3f;
+  int step_ = 2;     // keep every step_-th frame as a point
+  int phase_ = 0;
+  double ll_ = 0.0, rr_ = 0.0, lr_ = 0.0;
+  std::vector<float> points_;
+};
@@ -0,0 +1,212 @@
+#include "task_graph.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+WorkerPool::WorkerPool(int threads) {
+  for (int i = 0; i < threads; ++i) {
+    threads_.emplace_back(&WorkerPool::workerLoop, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    quit_ = true;
+  }
+  wake_.notify_all();
+  for (auto& t : threads_) {
+    if (t.joinable()) t.join();
+  }
+}
+
+int WorkerPool::defaultThreadCount() {
+  int hc = (int)std::thread::hardware_concurrency();
+  return std::max(0, std::min(3, hc - 2));
+}
+
+void WorkerPool::drain(uint32_t gen, const std::function<void(int)>* fn, int n, bool caller) {
+  const uint64_t tag = uint64_t(gen) << 32;
+  uint64_t c = claim_.load();
+  for (;;) {
+    if ((c & ~0xFFFFFFFFull) != tag || int(c & 0xFFFFFFFFu) >= n) return;
+    if (!claim_.compare_exchange_weak(c, c + 1)) continue;
+    (*fn)(int(c & 0xFFFFFFFFu));
+    if (remaining_.fetch_sub(1) == 1 && !caller) {
+      // Last item: the caller may already be waiting for it
+      std::lock_guard<std::mutex> lock(mu_);
+      done_.notify_one();
+    }
+    c = claim_.load();
+  }
+}
+
+void WorkerPool::workerLoop() {
+  uint32_t seen = 0;
+  for (;;) {
+    const std::function<void(int)>* fn;
+    int n;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      wake_.wait(lock, [&] { return quit_ || generation_ != seen; });
+      if (quit_) return;
+      seen = generation_;
+      fn = job_;
+      n = jobSize_;
+    }
+    // Woken too late the claim tag has moved on and this returns at once.
+    if (fn) drain(seen, fn, n, false);
+  }
+}
+
+void WorkerPool::parallelFor(int n, const std::function<void(int)>& fn) {
+  if (n <= 0) return;
+  if (threads_.empty() || n == 1) {
+    for (int i = 0; i < n; ++i) fn(i);
+    return;
+  }
+
+  uint32_t gen;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    gen = ++generation_;
+    job_ = &fn;
+    jobSize_ = n;
+    remaining_ = n;
+    claim_ = uint64_t(gen) << 32;
+  }
+  // The caller works too, so n items need at most n - 1 helpers.
+  const int helpers = std::min(n - 1, (int)threads_.size());
+  for (int i = 0; i < helpers; ++i) wake_.notify_one();
+
+  drain(gen, &fn, n, true);
+  if (remaining_.load() == 0) return;
+
+  std::unique_lock<std::mutex> lock(mu_);
+  done_.wait(lock, [&] { return remaining_.load() == 0; });
+}
+
+int TaskGraph::addNode(const std::string& name, NodeFn fn, const std::vector<int>& deps) {
+  std::lock_guard<std::mutex> lock(statsMu_);
+  for (int d : deps) {
+    if (d < 0 || d >= (int)nodes_.size()) {
+      throw std::logic_error("TaskGraph: unknown dependency for node " + name);
+    }
+  }
+  Node n;
+  n.name = name;
+  n.fn = std::move(fn);
+  n.deps = deps;
+  nodes_.push_back(std::move(n));
+  levels_.clear();
+  return (int)nodes_.size() - 1;
+}
+
+void TaskGraph::setEnabled(int id, bool on) {
+  if (id >= 0 && id < (int)nodes_.size()) nodes_[id].enabled = on;
+}
+
+void TaskGraph::clear() {
+  std::lock_guard<std::mutex> lock(statsMu_);
+  nodes_.clear();
+  levels_.clear();
+  ready_.clear();
+  active_.clear();
+}
+
+void TaskGraph::compile() {
+  std::lock_guard<std::mutex> lock(statsMu_);
+  const int n = (int)nodes_.size();
+  std::vector<int> level(n, -1);
+
+  // Nodes can only depend on earlier ids, but compute levels generically so
+  // a future insertion order change cannot silently break ordering.
+  bool progress = true;
+  int assigned = 0;
+  while (progress && assigned < n) {
+    progress = false;
+    for (int i = 0; i < n; ++i) {
+      if (level[i] >= 0) continue;
+      int lv = 0;
+      bool ok = true;
+      for (int d : nodes_[i].deps) {
+        if (level[d] < 0) { ok = false; break; }
+        lv = std::max(lv, level[d] + 1);
+      }
+      if (ok) { level[i] = lv; ++assigned; progress = true; }
+    }
+  }
+  if (assigned < n) throw std::logic_error("TaskGraph: dependency cycle");
+
+  levels_.clear();
+  for (int i = 0; i < n; ++i) {
+    if ((int)levels_.size() <= level[i]) levels_.resize(level[i] + 1);
+    levels_[level[i]].push_back(i);
+  }
+  ready_.reserve(n);
+  active_.assign(n, 0);
+}
+
+void TaskGraph::runNode(Node& n) {
+  auto t0 = std::chrono::steady_clock::now();
+  n.fn();
+  auto t1 = std::chrono::steady_clock::now();
+  double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+
+  std::lock_guard<std::mutex> lock(statsMu_);
+  n.lastUs = us;
+  n.avgUs = n.runs == 0 ? us : n.avgUs + 0.05 * (us - n.avgUs);
+  ++n.runs;
+}
+
+void TaskGraph::run(WorkerPool* pool) {
+  if (levels_.empty() && !nodes_.empty()) compile();
+  auto t0 = std::chrono::steady_clock::now();
+  double cpuUs = 0.0;
+
+  for (auto& lv : levels_) {
+    ready_.clear();
+    for (int id : lv) {
+      // A disabled node also switches off everything downstream of it.
+      bool on = nodes_[id].enabled;
+      for (size_t k = 0; on && k < nodes_[id].deps.size(); ++k) {
+        on = active_[nodes_[id].deps[k]] != 0;
+      }
+      active_[id] = on ? 1 : 0;
+      if (on) ready_.push_back(id);
+    }
+
+    // Handing a node to a worker costs a wakeup. Only the nodes beyond the
+    // heaviest one are offloaded, since the caller runs that one meanwhile.
+    double sum = 0.0, heaviest = 0.0;
+    for (int id : ready_) {
+      sum += nodes_[id].avgUs;
+      heaviest = std::max(heaviest, nodes_[id].avgUs);
+    }
+
+    if (ready_.size() < 2 || !pool || sum - heaviest < kMinParallelUs) {
+      for (int id : ready_) runNode(nodes_[id]);
+    } else {
+      pool->parallelFor((int)ready_.size(), [this](int i) { runNode(nodes_[ready_[i]]); });
+    }
+    for (int id : ready_) cpuUs += nodes_[id].lastUs;
+  }
+
+  lastCpuUs_ = cpuUs;
+  lastRunUs_ = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+std::vector<TaskGraph::NodeStats> TaskGraph::stats() const {
+  std::lock_guard<std::mutex> lock(statsMu_);
+  std::vector<NodeStats> r;
+  r.reserve(nodes_.size());
+  for (auto& n : nodes_) {
+    NodeStats s;
+    s.name = n.name;
+    s.lastUs = n.lastUs;
+    s.avgUs = n.avgUs;
+    s.runs = n.runs;
+    r.push_back(s);
+  }
+  return r;
+}
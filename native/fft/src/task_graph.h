@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads used to fan out independent analysis
+// nodes. Threads are created once and parked on a condition variable between
+// jobs, so nothing is spawned or allocated per hop. The caller joins on the
+// items of a job, not on the workers: a worker that wakes after the caller
+// has done the work itself finds nothing left and goes back to sleep.
+class WorkerPool {
+public:
+  explicit WorkerPool(int threads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  int size() const { return (int)threads_.size(); }
+
+  // Runs fn(0..n-1) on the pool and the calling thread; returns as soon as
+  // every item has finished.
+  void parallelFor(int n, const std::function<void(int)>& fn);
+
+  // Sensible default for a streaming PC: leave cores for the encoder and OBS.
+  static int defaultThreadCount();
+
+private:
+  void workerLoop();
+  void drain(uint32_t gen, const std::function<void(int)>* fn, int n, bool caller);
+
+  std::vector<std::thread> threads_;
+  std::mutex mu_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(int)>* job_ = nullptr;
+  int jobSize_ = 0;
+  uint32_t generation_ = 0;
+  // Next item to claim, tagged with the generation in the high 32 bits so a
+  // late worker can never claim an item of a newer job with a stale fn.
+  std::atomic<uint64_t> claim_{0};
+  std::atomic<int> remaining_{0};
+  bool quit_ = false;
+};
+
+// Small static DAG of analysis nodes executed once per hop. Nodes are grouped
+// into dependency levels when the graph is compiled; nodes on the same level
+// have no edges between them and run in parallel on the pool. A node that
+// several others depend on (e.g. the FFT) therefore runs exactly once.
+class TaskGraph {
+public:
+  using NodeFn = std::function<void()>;
+
+  struct NodeStats {
+    std::string name;
+    double lastUs = 0.0;   // duration of the most recent run
+    double avgUs = 0.0;    // exponential moving average
+    uint64_t runs = 0;
+  };
+
+  int addNode(const std::string& name, NodeFn fn, const std::vector<int>& deps = {});
+  void setEnabled(int id, bool on);
+  bool enabled(int id) const { return nodes_[id].enabled; }
+  bool empty() const { return nodes_.empty(); }
+
+  // Topologically sorts the nodes; throws std::logic_error on a cycle.
+  void compile();
+  void clear();
+
+  // Executes every enabled node once, level by level. pool may be null.
+  // A level only goes to the pool when the work it would hand off outweighs
+  // a wakeup; cheaper levels run inline on the calling thread.
+  void run(WorkerPool* pool);
+
+  // Below this much offloadable work (by each node's average) a level runs inline.
+  static constexpr double kMinParallelUs = 50.0;
+
+  std::vector<NodeStats> stats() const;
+  // Wall time of the last run, and the node time it added up to across
+  // threads; the latter is the CPU cost when levels run on the pool.
+  double lastRunUs() const { return lastRunUs_; }
+  double lastCpuUs() const { return lastCpuUs_; }
+
+private:
+  struct Node {
+    std::string name;
+    NodeFn fn;
+    std::vector<int> deps;
+    bool enabled = true;
+    double lastUs = 0.0;
+    double avgUs = 0.0;
+    uint64_t runs = 0;
+  };
+
+  void runNode(Node& n);
+
+  std::vector<Node> nodes_;
+  std::vector<std::vector<int>> levels_;
+  std::vector<int> ready_;   // scratch: enabled nodes of the current level
+  std::vector<char> active_; // scratch: nodes that run in the current pass
+  double lastRunUs_ = 0.0;
+  double lastCpuUs_ = 0.0;
+  // Node timings, and the node list itself: the graph is rebuilt on the
+  // capture thread while stats() may be reading it from JS
+  mutable std::mutex statsMu_;
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Recent samples of every capture channel for the VU meters, for any channel
+// count the device negotiates.
+//
+// Planar: one allocation holds a ring of kFrames samples per channel, back to
+// back, and all channels share the write position. A meter pass then streams
+// through each channel's plane contiguously instead of striding over frames.
+class VuHistory {
+public:
+  static const int kFrames = 4096;  // history per channel
+  static const int kWindow = 1024;  // frames behind one reading
+
+  // Drops history. Allocates, so call outside the steady state.
+  void resize(int channels) {
+    channels_ = std::max(0, channels);
+    planes_.assign((size_t)channels_ * kFrames, 0.0f);
+    clear();
+  }
+
+  void clear() {
+    pos_ = 0;
+    count_ = 0;
+  }
+
+  int channels() const { return channels_; }
+  size_t frames() const { return count_; }
+
+  // Deinterleaves frames of channels() samples each.
+  void push(const float* interleaved, size_t frames) {
+    if (channels_ == 0 || !interleaved) return;
+    // Only the newest kFrames survive anyway
+    if (frames > (size_t)kFrames) {
+      interleaved += (frames - kFrames) * channels_;
+      frames = kFrames;
+    }
+    size_t done = 0;
+    while (done < frames) {
+      const size_t run = std::min(frames - done, (size_t)kFrames - pos_);
+      for (int ch = 0; ch < channels_; ++ch) {
+        float* dst = planes_.data() + (size_t)ch * kFrames + pos_;
+        const float* src = interleaved + done * channels_ + ch;
+        for (size_t i = 0; i < run; ++i) dst[i] = src[i * channels_];
+      }
+      pos_ = (pos_ + run) % kFrames;
+      done += run;
+    }
+    count_ = std::min<size_t>(kFrames, count_ + frames);
+  }
+
+  // One byte per channel into out: RMS of the last kWindow frames times gain,
+  // -60..0 dBFS mapped onto 0..255. Needs at least one frame of history.
+  void levels(float gain, uint8_t* out) const {
+    const size_t n = std::min<size_t>(kWindow, count_);
+    if (n == 0) return;
+    const size_t start = (pos_ + kFrames - n) % kFrames;
+    const size_t head = std::min(n, (size_t)kFrames - start);
+    for (int ch = 0; ch < channels_; ++ch) {
+      const float* plane = planes_.data() + (size_t)ch * kFrames;
+      const double sum = sumSquares(plane + start, head) + sumSquares(plane, n - head);
+      const double rms = std::sqrt(sum / n) * gain;
+      const double db = 20.0 * std::log10(rms + 1e-10);
+      const double normalized = std::max(0.0, std::min(1.0, (db + 60.0) / 60.0));
+      out[ch] = static_cast<uint8_t>(std::round(normalized * 255.0));
+    }
+  }
+
+private:
+  // Eight independent partial sums, so the compiler vectorizes the reduction
+  // without having to reorder floating-point adds
+  static double sumSquares(const float* x, size_t n) {
+    float lane[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      for (int j = 0; j < 8; ++j) lane[j] += x[i + j] * x[i + j];
+    }
+    double sum = 0.0;
+    for (int j = 0; j < 8; ++j) sum += lane[j];
+    for (; i < n; ++i) sum += (double)x[i] * x[i];
+    return sum;
+  }
+
+  std::vector<float> planes_;  // channel-major, kFrames per channel
+  int channels_ = 0;
+  size_t pos_ = 0;             // next write index, shared by all channels
+  size_t count_ = 0;           // valid frames, up to kFrames
+};
@@ -1,30 +1,58 @@
 #include "wasapi_engine.h"
 #include <iostream>
-#define _USE_MATH_DEFINES
 #include <stdexcept>
-constexpr double kPI = 3.14159265358979323846;
 #include <chrono>
 #include <cmath>
 #include <functional>
 #include <windows.h>
-extern "C" {
-  #include "kiss_fftr.h"
-}
 
-struct WasapiEngine::Kiss { kiss_fftr_cfg cfg = nullptr; std::vector<float> in; std::vector<kiss_fft_cpx> out; };
+// Device switching: how long a new client gets to deliver audio before it
+// is handed over anyway (loopback of an idle render device delivers nothing
+// until something plays), and how many polls the old client has to reach a
+// hop boundary before the new one takes over regardless
+static const int kSwitchTimeoutMs = 1500;
+static const int kSwitchGraceWakeups = 8;
 
 static void check(HRESULT hr, const char* where){ if(FAILED(hr)) throw std::runtime_error(std::string(where)+" hr=0x"+std::to_string(hr)); }
 
 WasapiEngine::WasapiEngine(){
+  analyzer_.setTilt(tiltExp_);
+  analyzer_.setFrameCallback([this](const AnalysisFrame& f){
+    if(replaying_) return;
+    if(demand_.wants(Product::Fft)){
+      if(log_.isOpen()) log_.appendSpectrum(f.time, f.spectrum.data(), f.spectrum.size());
+      delay_.emit(cb_, f.spectrum, f.time);
+    }
+    if(demand_.wants(Product::Profiles)){
+      for(const auto& p : f.profiles) delay_.emit(profileCb_, p, f.time);
+    }
+    if(demand_.wants(Product::Pitch)) delay_.emit(pitchCb_, f.pitch, f.time);
+    if(demand_.wants(Product::Modules)){
+      for(const auto& m : f.modules) delay_.emit(moduleCb_, m, f.time);
+    }
+  });
   CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-  check(CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, IID_PPV_ARGS(&enumr_)), "MMDeviceEnumerator");
   stopEvent_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);  // Manual reset event
+  controlEvent_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);  // Auto reset; wakes the capture thread
+  // The device enumerator is created by initialize(), on first use at the latest
+}
+
+void WasapiEngine::initialize(){
+  std::lock_guard<std::mutex> lock(initMutex_);
+  if(enumr_) return;
+  // May run on a worker thread: join the MTA just for the call. The
+  // enumerator is free-threaded, and the constructing thread keeps the MTA alive.
+  HRESULT co = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+  HRESULT hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, IID_PPV_ARGS(&enumr_));
+  if(SUCCEEDED(co)) CoUninitialize();
+  check(hr, "MMDeviceEnumerator");
 }
 
 WasapiEngine::~WasapiEngine(){
   std::cout << "[WasapiEngine] Destructor called" << std::endl;
   enable(false);
   if(stopEvent_) CloseHandle(stopEvent_);
+  if(controlEvent_) CloseHandle(controlEvent_);
   CoUninitialize();
   std::cout << "[WasapiEngine] Destructor finished" << std::endl;
 }
@@ -46,6 +74,7 @@ std::string WasapiEngine::wstringToString(const std::wstring& wstr) {
 }
 
 std::vector<DeviceInfo> WasapiEngine::listDevices(){
+  initialize();
   std::vector<DeviceInfo> r;
   for(int pass=0; pass<2; ++pass){
     EDataFlow flow = pass==0? eRender : eCapture;
@@ -72,18 +101,68 @@ std::vector<DeviceInfo> WasapiEngine::listDevices(){
 }
 
 bool WasapiEngine::setDevice(const std::string& deviceId){
-  if(running_) stop();
-  device_.Reset();
+  initialize();
+  Microsoft::WRL::ComPtr<IMMDevice> dev;
   std::wstring wDeviceId = stringToWstring(deviceId);
-  HRESULT hr = enumr_->GetDevice(wDeviceId.c_str(), &device_);
+  HRESULT hr = enumr_->GetDevice(wDeviceId.c_str(), &dev);
   if(FAILED(hr)) return false;
-  Microsoft::WRL::ComPtr<IMMEndpoint> ep; dataflow_ = eRender;
-  if(SUCCEEDED(device_->QueryInterface(IID_PPV_ARGS(&ep)))){
-    ep->GetDataFlow(&dataflow_);
+  EDataFlow flow = eRender;
+  Microsoft::WRL::ComPtr<IMMEndpoint> ep;
+  if(SUCCEEDED(dev->QueryInterface(IID_PPV_ARGS(&ep)))){
+    ep->GetDataFlow(&flow);
   }
+  // A running engine switches live and keeps the old device on failure
+  if(running_ && !switchDevice(dev, flow)) return false;
+  device_ = dev; dataflow_ = flow;
   return true;
 }
 
+// Make before break: the new client is opened and started here while the
+// old one keeps capturing; the capture thread hands over once the new one
+// has a packet (see drainPackets), or at the timeout if it is merely silent.
+// Failing to open or start it, or losing the device, leaves the old client running.
+bool WasapiEngine::switchDevice(Microsoft::WRL::ComPtr<IMMDevice> dev, EDataFlow flow){
+  Client next = openClient(dev, flow);
+  if(!paused_){
+    HRESULT hr = next.audio->Start();
+    if(FAILED(hr)){ closeClient(next); check(hr, "Start"); }
+  }
+
+  bool switched;
+  {
+    std::unique_lock<std::mutex> lock(switchMutex_);
+    switched_ = false;
+    forceHandOver_ = false;
+    switching_ = &next;
+    SetEvent(controlEvent_);
+    auto settled = [&]{ return switching_ == nullptr; };
+    if(!switchCond_.wait_for(lock, std::chrono::milliseconds(kSwitchTimeoutMs), settled)){
+      // Silent but healthy: hand over without waiting for audio
+      UINT32 packet = 0;
+      if(SUCCEEDED(next.capture->GetNextPacketSize(&packet))){
+        forceHandOver_ = true;
+        SetEvent(controlEvent_);
+        switchCond_.wait_for(lock, std::chrono::milliseconds(kSwitchTimeoutMs), settled);
+      }
+    }
+    // From here on the capture thread no longer touches `next`
+    switching_ = nullptr;
+    forceHandOver_ = false;
+    switched = switched_;
+  }
+
+  // After a switch `next` holds the old client
+  next.audio->Stop();
+  closeClient(next);
+  if(!switched) std::cout << "[WasapiEngine] new device failed; staying on the current one" << std::endl;
+  return switched;
+}
+
+CaptureFormat WasapiEngine::captureFormat(){
+  std::lock_guard<std::mutex> lock(formatMutex_);
+  return reported_;
+}
+
 DeviceInfo WasapiEngine::currentDevice(){
   DeviceInfo di;
   if(!device_) return di;
@@ -109,218 +188,333 @@ DeviceInfo WasapiEngine::currentDevice(){
   return di;
 }
 
-void WasapiEngine::setFftSize(int fft){ plan_.fftSize = fft; }
-void WasapiEngine::setHopSize(int hop){ plan_.hopSize = hop; }
+void WasapiEngine::setFftSize(int fft){ plan_.fftSize = fft; analyzer_.requestPlan(plan_); }
+void WasapiEngine::setHopSize(int hop){ plan_.hopSize = hop; analyzer_.requestPlan(plan_); }
 void WasapiEngine::setColumns(int c){
   plan_.columns = std::max(1, std::min(c, 256));
-  if(sampleRate_>0) binmap_ = makeBinMap(sampleRate_, plan_.fftSize, plan_.columns);
+  analyzer_.requestPlan(plan_);
 }
-void WasapiEngine::setDbFloor(float db){ plan_.dbFloor = db; }
-void WasapiEngine::setMasterGain(float g){ masterGain_ = g; }
-void WasapiEngine::setTilt(float exp){ tiltExp_ = exp; }
+void WasapiEngine::setDbFloor(float db){ plan_.dbFloor = db; analyzer_.requestPlan(plan_); }
+void WasapiEngine::setMasterGain(float g){ masterGain_ = g; analyzer_.setMasterGain(g); }
+void WasapiEngine::setTilt(float exp){ tiltExp_ = exp; analyzer_.setTilt(exp); }
 void WasapiEngine::setLoopback(bool on){ loopback_ = on; }
 void WasapiEngine::setCallback(FftCallback cb){ cb_ = std::move(cb); }
 void WasapiEngine::setWaveCallback(WaveCallback cb) { waveCb_ = std::move(cb); }
 void WasapiEngine::setVuCallback(VuCallback cb) { vuCb_ = std::move(cb); }
+void WasapiEngine::setStereoCallback(StereoCallback cb) { stereoCb_ = std::move(cb); }
+
+void WasapiEngine::setSpectrogram(float seconds, bool rgba){
+  demand_.set(Product::Spectrogram, spectrogramSeconds_ > 0.0f, seconds > 0.0f);
+  spectrogramSeconds_ = seconds;
+  analyzer_.spectrogram().setRgba(rgba);
+  analyzer_.setSpectrogramSeconds(seconds);
+}
+void WasapiEngine::setSpectrogramColormap(const std::vector<uint8_t>& lut){
+  analyzer_.spectrogram().setColormap(lut.data(), lut.size());
+}
+bool WasapiEngine::spectrogramSnapshot(SpectrogramRows& out){
+  return analyzer_.spectrogram().snapshot(out);
+}
+void WasapiEngine::setSpectrogramCallback(SpectrogramCallback cb) { spectrogramCb_ = std::move(cb); }
+
+void WasapiEngine::setProfile(const std::string& name, const ProfileSpec& spec){ analyzer_.setProfile(name, spec); }
+void WasapiEngine::removeProfile(const std::string& name){ analyzer_.removeProfile(name); }
+void WasapiEngine::setProfileCallback(ProfileCallback cb) { profileCb_ = std::move(cb); }
+void WasapiEngine::setModuleCallback(ModuleCallback cb) { moduleCb_ = std::move(cb); }
+void WasapiEngine::setPitchRange(float minHz, float maxHz){ analyzer_.setPitchRange(minHz, maxHz); }
+void WasapiEngine::setPitchCallback(PitchCallback cb) { pitchCb_ = std::move(cb); }
+
+std::vector<TaskGraph::NodeStats> WasapiEngine::analyzerStats(){
+  return analyzer_.nodeStats();
+}
+
+void WasapiEngine::setSilenceDetection(bool enabled, float thresholdDb, int holdMs){
+  silence_.setThresholdDb(thresholdDb);
+  silence_.setHoldMs(holdMs);
+  silence_.setEnabled(enabled);
+}
+bool WasapiEngine::isIdle(){ return analyzer_.idle(); }
+
+void WasapiEngine::setCpuBudget(float fraction){ analyzer_.setCpuBudget(fraction); }
+QualityInfo WasapiEngine::quality(){ return analyzer_.quality(); }
+void WasapiEngine::setAnalysisRate(int hz){ analyzer_.setDecimation(hz); }
+void WasapiEngine::setChannelMode(ChannelMode mode){
+  channelMode_ = mode;
+  analyzer_.setDual(mode == ChannelMode::Dual);
+}
+ChannelMode WasapiEngine::channelMode(){ return channelMode_; }
+
+void WasapiEngine::setAgc(const AgcSettings& s){ analyzer_.setAgc(s); }
+AgcSettings WasapiEngine::agc(){ return analyzer_.agc(); }
+float WasapiEngine::agcGainDb(){ return analyzer_.agcGainDb(); }
+void WasapiEngine::setNormalizer(const NormalizerSettings& s){ analyzer_.setNormalizer(s); }
+NormalizerSettings WasapiEngine::normalizer(){ return analyzer_.normalizer(); }
+
+void WasapiEngine::setOutputDelayMs(int ms){ delay_.setDelayMs(ms); }
+int WasapiEngine::outputDelayMs(){ return delay_.delayMs(); }
+
+void WasapiEngine::startLog(const std::string& path, bool logWave){
+  stopLog();
+  log_.open(path, sampleRate_, plan_.columns, logWave);
+  // The log is a consumer in its own right
+  demand_.acquire(Product::Fft);
+  demand_.acquire(Product::Vu);
+  if(logWave) demand_.acquire(Product::Wave);
+}
+
+void WasapiEngine::stopLog(){
+  if(!log_.isOpen()) return;
+  demand_.release(Product::Fft);
+  demand_.release(Product::Vu);
+  if(log_.logsWave()) demand_.release(Product::Wave);
+  log_.close();
+}
+
+void WasapiEngine::replayLog(const std::string& path, double fromMs, double toMs, double speed){
+  SpectrumLogReader reader;
+  reader.open(path);
+
+  // Replayed frames take the normal publish path; live output is muted meanwhile
+  SpectrumLogSinks sinks;
+  sinks.spectrum = [this](const std::vector<float>& v){ delay_.emit(cb_, v, DelayLine::Clock::now()); };
+  sinks.vu = [this](const std::vector<uint8_t>& v){ delay_.emit(vuCb_, v, DelayLine::Clock::now()); };
+  sinks.wave = [this](const std::vector<int16_t>& v){ delay_.emit(waveCb_, v, DelayLine::Clock::now()); };
+
+  stopReplay_ = false;
+  replaying_ = true;
+  try{
+    replaySpectrumLog(reader, fromMs, toMs, speed, stopReplay_, sinks);
+  } catch(...) {
+    replaying_ = false;
+    throw;
+  }
+  replaying_ = false;
+}
+
+void WasapiEngine::stopReplay(){ stopReplay_ = true; }
 
 void WasapiEngine::enable(bool on){
   std::cout << "[WasapiEngine] enable(" << (on ? "true" : "false") << ")" << std::endl;
   std::cout.flush();
-  if(on){ start(); } else { stop(); }
+  if(on){ if(paused_) setPaused(false); else start(); } else { stop(); }
+}
+
+// The client is stopped and started on the capture thread, which owns it;
+// this only flips the flag and wakes that thread up
+void WasapiEngine::setPaused(bool paused){
+  if(!running_){ if(!paused) start(); return; }
+  if(paused == paused_) return;
+  paused_ = paused;
+  if(paused) delay_.clear();
+  SetEvent(controlEvent_);
+}
+
+bool WasapiEngine::paused(){ return paused_; }
+
+WasapiEngine::Client WasapiEngine::openClient(Microsoft::WRL::ComPtr<IMMDevice> dev, EDataFlow flow){
+  Client c; c.device = dev; c.flow = flow;
+  try{
+    check(dev->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, &c.audio), "Activate IAudioClient");
+    check(c.audio->GetMixFormat(&c.wfx), "GetMixFormat");
+
+    // Shared mode captures in the engine's mix format; take it as it is
+    bool isFloat = false; WORD validBits = c.wfx->wBitsPerSample;
+    if(c.wfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE){
+      auto* fext = reinterpret_cast<WAVEFORMATEXTENSIBLE*>(c.wfx);
+      isFloat = IsEqualGUID(fext->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) != 0;
+      if(fext->Samples.wValidBitsPerSample) validBits = fext->Samples.wValidBitsPerSample;
+    } else {
+      isFloat = (c.wfx->wFormatTag == WAVE_FORMAT_IEEE_FLOAT);
+    }
+    c.channels = c.wfx->nChannels; c.sampleRate = c.wfx->nSamplesPerSec;
+    switch(c.wfx->wBitsPerSample){
+      case 16: c.format = SampleFormat::S16; break;
+      case 24: c.format = SampleFormat::S24; break;
+      case 32: c.format = isFloat ? SampleFormat::F32 : (validBits == 24 ? SampleFormat::S24_32 : SampleFormat::S32); break;
+      default: throw std::runtime_error("Unsupported mix format: " + std::to_string(c.wfx->wBitsPerSample) + " bits");
+    }
+
+    REFERENCE_TIME dur = 10000000;
+    DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+    if(flow == eRender && loopback_) flags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
+    check(c.audio->Initialize(AUDCLNT_SHAREMODE_SHARED, flags, dur, 0, c.wfx, nullptr), "Initialize");
+    check(c.audio->GetService(IID_PPV_ARGS(&c.capture)), "GetService IAudioCaptureClient");
+    c.event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    check(c.audio->SetEventHandle(c.event), "SetEventHandle");
+  } catch(...) {
+    closeClient(c);
+    throw;
+  }
+  return c;
+}
+
+void WasapiEngine::closeClient(Client& c){
+  if(c.wfx){ CoTaskMemFree(c.wfx); c.wfx=nullptr; }
+  if(c.event){ CloseHandle(c.event); c.event=nullptr; }
+  c.capture.Reset();
+  c.audio.Reset();
+  c.device.Reset();
+}
+
+void WasapiEngine::reportFormat(){
+  std::lock_guard<std::mutex> lock(formatMutex_);
+  reported_.sampleRate = client_.sampleRate;
+  reported_.channels = client_.channels;
+  reported_.format = client_.format;
+}
+
+// Capture thread. Swaps in the client that setDevice() prepared; the old
+// one goes back to setDevice() for release.
+void WasapiEngine::handOver(){
+  std::lock_guard<std::mutex> lock(switchMutex_);
+  Client* next = switching_;
+  if(!next) return;
+  client_.audio->Stop();
+  std::swap(client_, *next);
+  if(client_.sampleRate != sampleRate_){
+    sampleRate_ = client_.sampleRate;
+    analyzer_.configure(sampleRate_, analyzer_.plan());
+    silence_.setSampleRate(sampleRate_);
+    std::lock_guard<std::mutex> vl(vuMutex_);
+    stereo_.configure(sampleRate_);
+  }
+  if(client_.channels != nChannels_){
+    std::lock_guard<std::mutex> vl(vuMutex_);
+    nChannels_ = client_.channels;
+    vu_.resize(nChannels_);
+  }
+  reportFormat();
+  switched_ = true;
+  switching_ = nullptr;
+  switchCond_.notify_all();
+}
+
+// Capture thread. Feeds every queued packet of the current client. While a
+// switch is pending and the new client already has audio (or switchDevice()
+// gave up waiting for it), the old client is fed up to the next hop boundary
+// and then handed over; if it has gone quiet the new one takes over after a
+// few polls regardless.
+void WasapiEngine::drainPackets(){
+  bool primed = false;
+  if(switching_){
+    // Probed under the lock: switchDevice() releases the client once it
+    // clears switching_
+    std::lock_guard<std::mutex> lock(switchMutex_);
+    Client* next = switching_;
+    UINT32 nextPacket = 0;
+    if(next && FAILED(next->capture->GetNextPacketSize(&nextPacket))){
+      // Device lost; switchDevice() rolls back
+      switching_ = nullptr;
+      switchCond_.notify_all();
+    } else {
+      primed = next && (forceHandOver_ || nextPacket > 0);
+    }
+  }
+  if(!primed) graceWakeups_ = 0;
+
+  BYTE* data=nullptr; UINT32 frames=0; DWORD flags=0; UINT64 pos=0; UINT64 qpc=0;
+  for(;;){
+    HRESULT hr = client_.capture->GetBuffer(&data, &frames, &flags, &pos, &qpc);
+    if(hr==AUDCLNT_S_BUFFER_EMPTY) break;
+    if(FAILED(hr)) break;
+
+    const bool silent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
+    const UINT32 use = primed ? std::min<UINT32>(frames, (UINT32)analyzer_.samplesToHopBoundary()) : frames;
+    processAudioData(data, use, client_.format, silent);
+
+    client_.capture->ReleaseBuffer(frames);
+    if(primed){ handOver(); return; }
+  }
+  if(primed && ++graceWakeups_ >= kSwitchGraceWakeups) handOver();
 }
 
 void WasapiEngine::start(){
   if(running_) return;
+  initialize();
   if(!device_) {
     enumr_->GetDefaultAudioEndpoint(eRender, eConsole, &device_);
     dataflow_ = eRender;
   }
-  check(device_->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, &audioClient_), "Activate IAudioClient");
-  check(audioClient_->GetMixFormat(&wfx_), "GetMixFormat");
-
-  bool isFloat = false; WORD nChannels = 0; DWORD sampleRate = 0;
-  if(wfx_->wFormatTag == WAVE_FORMAT_EXTENSIBLE){
-    auto* fext = reinterpret_cast<WAVEFORMATEXTENSIBLE*>(wfx_);
-    isFloat = IsEqualGUID(fext->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) != 0;
-    nChannels = fext->Format.nChannels; sampleRate = fext->Format.nSamplesPerSec;
-  } else {
-    isFloat = (wfx_->wFormatTag == WAVE_FORMAT_IEEE_FLOAT);
-    nChannels = wfx_->nChannels; sampleRate = wfx_->nSamplesPerSec;
-  }
+  client_ = openClient(device_, dataflow_);
+  sampleRate_ = client_.sampleRate;
+  nChannels_ = client_.channels;
+  reportFormat();
 
-  REFERENCE_TIME dur = 10000000;
-  DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
-  if(dataflow_ == eRender && loopback_) flags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
-  check(audioClient_->Initialize(AUDCLNT_SHAREMODE_SHARED, flags, dur, 0, wfx_, nullptr), "Initialize");
-  check(audioClient_->GetService(IID_PPV_ARGS(&cap_)), "GetService IAudioCaptureClient");
-  sampleRate_ = (int)sampleRate; binmap_ = makeBinMap(sampleRate_, plan_.fftSize, plan_.columns);
-  nChannels_ = (int)nChannels;
-
-  kiss_ = new Kiss();
-  kiss_->in.resize(plan_.fftSize);
-  kiss_->out.resize(plan_.fftSize/2+1);
-  kiss_->cfg = kiss_fftr_alloc(plan_.fftSize, 0, nullptr, nullptr);
+  analyzer_.configure(sampleRate_, analyzer_.plan());
+  silence_.setSampleRate(sampleRate_);
 
   waveformBuf_.clear();
   waveformBuf_.reserve(2048);
 
-  vuBufs_.clear();
-  vuBufs_.resize(nChannels_);
-  for(auto& buf : vuBufs_) {
-    buf.reserve(4096);
-  }
+  vu_.resize(nChannels_);
+  stereo_.configure(sampleRate_);
 
-  HANDLE evt = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-  check(audioClient_->SetEventHandle(evt), "SetEventHandle");
   ResetEvent(stopEvent_);  // Reset stop event before starting
   running_ = true;
-  th_ = std::thread([&,evt,isFloat,nChannels]{
+  th_ = std::thread([this]{
     DWORD taskIndex = 0; HANDLE task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
 
     auto lastWavePublish = std::chrono::high_resolution_clock::now();
     const double wavePublishInterval = 1.0 / 60.0;
+    int idleTicks = 0;
 
     try{
-      check(audioClient_->Start(), "Start");
-      BYTE* data=nullptr; UINT32 frames=0; DWORD flags=0; UINT64 pos=0; UINT64 qpc=0;
-      std::vector<float> hop(plan_.hopSize);
-      size_t hopFill = 0;
+      check(client_.audio->Start(), "Start");
+      bool clientPaused = false;
 
       while(running_){
-        HANDLE events[2] = {evt, stopEvent_};
-        DWORD result = WaitForMultipleObjects(2, events, FALSE, 2000);
+        // A pending device switch polls the new client for its first packet
+        HANDLE events[3] = {client_.event, stopEvent_, controlEvent_};
+        DWORD result = WaitForMultipleObjects(3, events, FALSE, switching_ ? 5 : 2000);
 
         // If stop event signaled, break immediately
         if(result == WAIT_OBJECT_0 + 1 || !running_){
           break;
         }
-        UINT32 p=0; audioClient_->GetCurrentPadding(&p);
-
-        for(;;){
-          HRESULT hr = cap_->GetBuffer(&data, &frames, &flags, &pos, &qpc);
-          if(hr==AUDCLNT_S_BUFFER_EMPTY) break;
-          if(FAILED(hr)) break;
-
-          const bool silent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
-
-          if(isFloat){
-            const float* f = reinterpret_cast<const float*>(data);
-            UINT32 i = 0;
-            while(i < frames){
-              size_t toCopy = std::min<size_t>(plan_.hopSize - hopFill, frames - i);
-
-              if(silent){
-                std::fill(hop.begin() + hopFill, hop.begin() + hopFill + toCopy, 0.0f);
-              }else{
-                for(size_t k = 0; k < toCopy; ++k){
-                  hop[hopFill + k] = f[(i + (UINT32)k) * nChannels];
-                }
-              }
-
-              {
-                std::lock_guard<std::mutex> lock(waveformMutex_);
-                for(size_t k = 0; k < toCopy; ++k){
-                  waveformBuf_.push_back(hop[hopFill + k]);
-                  if(waveformBuf_.size() > 2048) {
-                    waveformBuf_.erase(waveformBuf_.begin(), waveformBuf_.begin() + (waveformBuf_.size() - 2048));
-                  }
-                }
-              }
-
-              {
-                std::lock_guard<std::mutex> lock(vuMutex_);
-                for(size_t k = 0; k < toCopy; ++k){
-                  for(int ch = 0; ch < nChannels_; ++ch){
-                    float sample = silent ? 0.0f : f[(i + (UINT32)k) * nChannels_ + ch];
-                    vuBufs_[ch].push_back(sample);
-                    if(vuBufs_[ch].size() > 4096) {
-                      vuBufs_[ch].erase(vuBufs_[ch].begin());
-                    }
-                  }
-                }
-              }
-
-              hopFill += toCopy;
-              i += (UINT32)toCopy;
-
-              if(hopFill == (size_t)plan_.hopSize){
-                sampleBuf_.write(hop.data(), plan_.hopSize);
-                hopFill = 0;
-
-                if(sampleBuf_.count() >= (size_t)plan_.fftSize){
-                  std::vector<float> frame(plan_.fftSize);
-                  sampleBuf_.readLatest(frame.data(), frame.size());
-                  computeFftAndPublish(frame.data());
-                }
-              }
-            }
+
+        // Warm pause: the client keeps its format and buffer, it just stops
+        // capturing. Reset() drops what was queued before the pause, and the
+        // analyzer and wave/VU buffers start over from fresh audio.
+        if(paused_ != clientPaused){
+          clientPaused = paused_;
+          if(clientPaused){
+            client_.audio->Stop();
           } else {
-            const int16_t* s = reinterpret_cast<const int16_t*>(data);
-            UINT32 i = 0;
-            while(i < frames){
-              size_t toCopy = std::min<size_t>(plan_.hopSize - hopFill, frames - i);
-              if(silent){
-                std::fill(hop.begin() + hopFill, hop.begin() + hopFill + toCopy, 0.0f);
-              }else{
-                for(size_t k = 0; k < toCopy; ++k){
-                  hop[hopFill + k] = s[(i + (UINT32)k) * nChannels] / 32768.0f;
-                }
-              }
-
-              {
-                std::lock_guard<std::mutex> lock(waveformMutex_);
-                for(size_t k = 0; k < toCopy; ++k){
-                  waveformBuf_.push_back(hop[hopFill + k]);
-                  if(waveformBuf_.size() > 2048) {
-                    waveformBuf_.erase(waveformBuf_.begin(), waveformBuf_.begin() + (waveformBuf_.size() - 2048));
-                  }
-                }
-              }
-
-              {
-                std::lock_guard<std::mutex> lock(vuMutex_);
-                for(size_t k = 0; k < toCopy; ++k){
-                  for(int ch = 0; ch < nChannels_; ++ch){
-                    float sample = silent ? 0.0f : s[(i + (UINT32)k) * nChannels_ + ch] / 32768.0f;
-                    vuBufs_[ch].push_back(sample);
-                    if(vuBufs_[ch].size() > 4096) {
-                      vuBufs_[ch].erase(vuBufs_[ch].begin());
-                    }
-                  }
-                }
-              }
-
-              hopFill += toCopy;
-              i += (UINT32)toCopy;
-
-              if(hopFill == (size_t)plan_.hopSize){
-                sampleBuf_.write(hop.data(), plan_.hopSize);
-                hopFill = 0;
-                if(sampleBuf_.count() >= (size_t)plan_.fftSize){
-                  std::vector<float> frame(plan_.fftSize);
-                  sampleBuf_.readLatest(frame.data(), frame.size());
-                  computeFftAndPublish(frame.data());
-                }
-              }
-            }
+            client_.audio->Reset();
+            analyzer_.flushHistory();
+            { std::lock_guard<std::mutex> lock(waveformMutex_); waveformBuf_.clear(); }
+            { std::lock_guard<std::mutex> lock(vuMutex_); vu_.clear(); stereo_.reset(); }
+            check(client_.audio->Start(), "Start");
           }
-
-          cap_->ReleaseBuffer(frames);
+        }
+        if(clientPaused){
+          // Nothing to hand over at a boundary; the new client stays stopped until resume
+          if(switching_) handOver();
+          continue;
         }
 
+        drainPackets();
+
         auto now = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> elapsed = now - lastWavePublish;
 
         if(elapsed.count() >= wavePublishInterval){
-          publishWaveform();
-          computeAndPublishVu();
+          // While idle, wave and VU drop to a 1 Hz heartbeat
+          const bool idle = analyzer_.idle();
+          idleTicks = idle ? idleTicks + 1 : 0;
+          if(!idle || idleTicks % 60 == 1){
+            publishWaveform();
+            computeAndPublishVu();
+            publishStereo();
+          }
+          publishSpectrogram();
           lastWavePublish = now;
         }
       }
-      audioClient_->Stop();
+      client_.audio->Stop();
     } catch(...) {
     }
-    if(task) AvRevertMmThreadCharacteristics(task); CloseHandle(evt);
+    if(task) AvRevertMmThreadCharacteristics(task);
   });
 }
 
@@ -336,6 +530,7 @@ void WasapiEngine::stop(){
   std::cout << "[WasapiEngine] stop: setting running_ = false" << std::endl;
   std::cout.flush();
   running_=false;
+  paused_=false;
 
   // Signal stop event to wake up worker thread immediately
   if(stopEvent_) {
@@ -358,16 +553,81 @@ void WasapiEngine::stop(){
 
   std::cout << "[WasapiEngine] stop: cleaning up resources..." << std::endl;
   std::cout.flush();
-  if(kiss_){ kiss_fft_free(kiss_->cfg); delete kiss_; kiss_=nullptr;}
-  if(wfx_){ CoTaskMemFree(wfx_); wfx_=nullptr;}
-  cap_.Reset();
-  audioClient_.Reset();
+  analyzer_.release();
+  delay_.clear();
+  closeClient(client_);
+  { std::lock_guard<std::mutex> lock(formatMutex_); reported_ = CaptureFormat(); }
   std::cout << "[WasapiEngine] ===== stop: completed =====" << std::endl;
   std::cout.flush();
 }
 
+void WasapiEngine::processAudioData(const BYTE* data, UINT32 frames, SampleFormat format, bool silent){
+  if(mono_.size() < frames) mono_.resize(frames);
+  const size_t n = (size_t)frames * nChannels_;
+  if(interleaved_.size() < n) interleaved_.resize(n);
+
+  // Convert the packet to float once
+  if(silent) std::fill(interleaved_.begin(), interleaved_.begin() + n, 0.0f);
+  else convertToFloat(data, format, n, interleaved_.data());
+
+  // Silent input still feeds the analyzer's framing so the first loud
+  // packet lands in a full window; only the wave/VU buffering is skipped
+  const bool idle = silent ? silence_.updateSilent(frames)
+                           : silence_.update(interleaved_.data(), frames, nChannels_);
+  analyzer_.setIdle(idle);
+
+  // Only buffer and analyse what somebody is listening to
+  analyzer_.setActive(demand_.wants(Product::Fft) || demand_.wants(Product::Spectrogram) ||
+                      demand_.wants(Product::Profiles));
+  analyzer_.setPitchTracking(demand_.wants(Product::Pitch));
+  analyzer_.setModules(demand_.wants(Product::Modules));
+  const bool wantWave = !idle && demand_.wants(Product::Wave);
+  const bool wantVu = !idle && demand_.wants(Product::Vu);
+  const bool wantStereo = !idle && demand_.wants(Product::Stereo);
+
+  // Fold the packet into the analyzer input per the channel mode. In the
+  // default left mode the stereo meter fills it in the same pass.
+  const ChannelMode mode = channelMode_;
+  const bool dual = mode == ChannelMode::Dual;
+  if(dual && right_.size() < frames) right_.resize(frames);
+  if(wantStereo){
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    stereo_.process(interleaved_.data(), frames, nChannels_, mode == ChannelMode::Left ? mono_.data() : nullptr);
+  }
+  if(!wantStereo || mode != ChannelMode::Left){
+    mixChannels(interleaved_.data(), frames, nChannels_, mode, mono_.data(), right_.data());
+  }
+
+  if(wantWave){
+    std::lock_guard<std::mutex> lock(waveformMutex_);
+    for(UINT32 i = 0; i < frames; ++i){
+      waveformBuf_.push_back(mono_[i]);
+      if(waveformBuf_.size() > 2048) {
+        waveformBuf_.erase(waveformBuf_.begin(), waveformBuf_.begin() + (waveformBuf_.size() - 2048));
+      }
+    }
+  }
+
+  if(wantVu){
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    vu_.push(interleaved_.data(), frames);
+  }
+
+  // The packet is delivered once its last frame is captured; back-date the first one
+  auto firstSample = DelayLine::Clock::now() - std::chrono::duration_cast<DelayLine::Clock::duration>(
+    std::chrono::duration<double>(double(frames) / sampleRate_));
+  analyzer_.pushSamples(mono_.data(), frames, firstSample, dual ? right_.data() : nullptr);
+}
+
+void WasapiEngine::publishSpectrogram(){
+  if(!spectrogramCb_ || replaying_) return;
+  if(analyzer_.spectrogram().takeNewRows(spectrogramRows_)){
+    delay_.emit(spectrogramCb_, spectrogramRows_, DelayLine::Clock::now());
+  }
+}
+
 void WasapiEngine::publishWaveform(){
-  if(!waveCb_) return;
+  if(replaying_ || !demand_.wants(Product::Wave)) return;
 
   std::vector<float> waveSamples;
   {
@@ -384,85 +644,34 @@ void WasapiEngine::publishWaveform(){
     downsampled[i] = static_cast<int16_t>(val);
   }
 
-  waveCb_(downsampled);
+  auto now = DelayLine::Clock::now();
+  if(log_.logsWave()) log_.append(spectrumlog::kWave, now, downsampled.data(), downsampled.size() * sizeof(int16_t));
+  delay_.emit(waveCb_, std::move(downsampled), now);
 }
 
 void WasapiEngine::computeAndPublishVu(){
-  if(!vuCb_ || nChannels_ == 0) return;
+  if(replaying_ || !demand_.wants(Product::Vu)) return;
 
-  std::vector<float> channelSamples[8];
+  std::vector<uint8_t> vuLevels;
   {
     std::lock_guard<std::mutex> lock(vuMutex_);
-    for(int ch = 0; ch < nChannels_ && ch < 8; ++ch){
-      if(vuBufs_[ch].empty()) return;
-      channelSamples[ch] = vuBufs_[ch];
-    }
-  }
-
-  std::vector<uint8_t> vuLevels(nChannels_);
-
-  for(int ch = 0; ch < nChannels_; ++ch){
-    const auto& samples = channelSamples[ch];
-    if(samples.empty()) {
-      vuLevels[ch] = 0;
-      continue;
-    }
-
-    size_t n = std::min<size_t>(1024, samples.size());
-    size_t start = samples.size() - n;
-
-    double sumSquares = 0.0;
-    for(size_t i = start; i < samples.size(); ++i){
-      double s = samples[i];
-      sumSquares += s * s;
-    }
-
-    double rms = std::sqrt(sumSquares / n);
-    rms *= masterGain_;
-    double db = 20.0 * std::log10(rms + 1e-10);
-
-    double normalized = (db + 60.0) / 60.0;
-    normalized = std::max(0.0, std::min(1.0, normalized));
-
-    vuLevels[ch] = static_cast<uint8_t>(std::round(normalized * 255.0));
+    if(vu_.channels() == 0 || vu_.frames() == 0) return;
+    vuLevels.resize(vu_.channels());
+    vu_.levels(masterGain_, vuLevels.data());
   }
 
-  vuCb_(vuLevels);
+  auto now = DelayLine::Clock::now();
+  if(log_.isOpen()) log_.append(spectrumlog::kVu, now, vuLevels.data(), vuLevels.size());
+  delay_.emit(vuCb_, std::move(vuLevels), now);
 }
 
-void WasapiEngine::computeFftAndPublish(const float* frame){
-  for(int i=0;i<plan_.fftSize;++i){
-    float w = 0.54f - 0.46f * std::cos(2.0*kPI*i/(plan_.fftSize-1));
-    kiss_->in[i]= frame[i]*w;
-  }
-
-  kiss_fftr(kiss_->cfg, kiss_->in.data(), kiss_->out.data());
-
-  auto& out = specBuf_.writeBuf();
-  out.resize(plan_.columns);
-  const float dbFloor = plan_.dbFloor;
+void WasapiEngine::publishStereo(){
+  if(replaying_ || !demand_.wants(Product::Stereo)) return;
 
-  for(int b=0;b<plan_.columns;++b){
-    double sum=0;
-    int cnt=0;
-    for(int j=binmap_.start[b]; j<binmap_.end[b]; ++j,++cnt){
-      double re = kiss_->out[j].r;
-      double im = kiss_->out[j].i;
-      const double ampScale = 2.0 / double(plan_.fftSize);
-      sum += std::sqrt(re*re + im*im) * ampScale;
-    }
-    double lin = cnt>0 ? sum/cnt : 0.0;
-    double db = 20.0*std::log10(lin + 1e-20);
-
-    double clamped = std::max(db, (double)dbFloor);
-    double norm = double(b+10)/double(plan_.columns+10);
-    double gain = std::pow(norm, (double)tiltExp_);
-    float v = float(((clamped - dbFloor)/-dbFloor) * gain * masterGain_);
-    if (clampUnit_) v = std::max(0.0f, std::min(1.0f, v));
-
-    out[b] = static_cast<uint8_t>(std::round(v * 255.0f));
+  StereoFrame frame;
+  {
+    std::lock_guard<std::mutex> lock(vuMutex_);
+    stereo_.read(frame);
   }
-
-  specBuf_.publish();
-  if(cb_) cb_(specBuf_.readBuf());
+  delay_.emit(stereoCb_, std::move(frame), DelayLine::Clock::now());
 }
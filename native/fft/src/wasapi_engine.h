@@ -2,14 +2,20 @@
 #include "audio_engine.h"
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <wrl.h>
 #include <mmdeviceapi.h>
 #include <audioclient.h>
 #include <avrt.h>
 #include <Functiondiscoverykeys_devpkey.h>
 #include <algorithm>
-#include "ringbuffers.h"
 #include "fft_bands.h"
+#include "spectrum_analyzer.h"
+#include "silence_detector.h"
+#include "delay_line.h"
+#include "spectrum_log.h"
+#include "vu_meter.h"
 
 #pragma comment(lib, "avrt.lib")
 
@@ -19,9 +25,11 @@ public:
   ~WasapiEngine() override;
 
   // AudioEngine interface implementation
+  void initialize() override;
   std::vector<DeviceInfo> listDevices() override;
   bool setDevice(const std::string& deviceId) override;
   DeviceInfo currentDevice() override;
+  CaptureFormat captureFormat() override;
 
   void setFftSize(int fft) override;
   void setHopSize(int hop) override;
@@ -31,40 +39,119 @@ public:
   void setTilt(float exp) override;
   void setLoopback(bool on) override;
   void enable(bool on) override;
+  void setPaused(bool paused) override;
+  bool paused() override;
   void setCallback(FftCallback cb) override;
   void setWaveCallback(WaveCallback cb) override;
   void setVuCallback(VuCallback cb) override;
+  void setStereoCallback(StereoCallback cb) override;
+
+  void setSpectrogram(float seconds, bool rgba) override;
+  void setSpectrogramColormap(const std::vector<uint8_t>& lut) override;
+  bool spectrogramSnapshot(SpectrogramRows& out) override;
+  void setSpectrogramCallback(SpectrogramCallback cb) override;
+
+  void setProfile(const std::string& name, const ProfileSpec& spec) override;
+  void removeProfile(const std::string& name) override;
+  void setProfileCallback(ProfileCallback cb) override;
+  void setModuleCallback(ModuleCallback cb) override;
+  void setPitchRange(float minHz, float maxHz) override;
+  void setPitchCallback(PitchCallback cb) override;
+  void setAgc(const AgcSettings& s) override;
+  AgcSettings agc() override;
+  float agcGainDb() override;
+  void setNormalizer(const NormalizerSettings& s) override;
+  NormalizerSettings normalizer() override;
+
+  std::vector<TaskGraph::NodeStats> analyzerStats() override;
+
+  void setSilenceDetection(bool enabled, float thresholdDb, int holdMs) override;
+  bool isIdle() override;
+
+  void setCpuBudget(float fraction) override;
+  QualityInfo quality() override;
+  void setAnalysisRate(int hz) override;
+  void setChannelMode(ChannelMode mode) override;
+  ChannelMode channelMode() override;
+
+  void setOutputDelayMs(int ms) override;
+  int outputDelayMs() override;
+
+  void startLog(const std::string& path, bool logWave) override;
+  void stopLog() override;
+  void replayLog(const std::string& path, double fromMs, double toMs, double speed) override;
+  void stopReplay() override;
 
 private:
+  // One initialised capture client with its own event; built off the capture thread
+  struct Client {
+    Microsoft::WRL::ComPtr<IMMDevice> device;
+    Microsoft::WRL::ComPtr<IAudioClient> audio;
+    Microsoft::WRL::ComPtr<IAudioCaptureClient> capture;
+    WAVEFORMATEX* wfx = nullptr;
+    HANDLE event = nullptr;
+    EDataFlow flow = eRender;
+    SampleFormat format = SampleFormat::F32;
+    int sampleRate = 0;
+    int channels = 0;
+  };
+
   void start();
   void stop();
-  void workerLoop();
-  void computeFftAndPublish(const float* frame);
+  Client openClient(Microsoft::WRL::ComPtr<IMMDevice> dev, EDataFlow flow);
+  static void closeClient(Client& c);
+  bool switchDevice(Microsoft::WRL::ComPtr<IMMDevice> dev, EDataFlow flow);
+  void drainPackets();
+  void handOver();
+  void processAudioData(const BYTE* data, UINT32 frames, SampleFormat format, bool silent);
+  void reportFormat();
   void computeAndPublishVu();
+  void publishStereo();
   void publishWaveform();
+  void publishSpectrogram();
 
   // Helper for string conversion
   std::wstring stringToWstring(const std::string& str);
   std::string wstringToString(const std::wstring& wstr);
 
   // COM
+  std::mutex initMutex_;
   Microsoft::WRL::ComPtr<IMMDeviceEnumerator> enumr_;
   Microsoft::WRL::ComPtr<IMMDevice> device_;
-  Microsoft::WRL::ComPtr<IAudioClient> audioClient_;
-  Microsoft::WRL::ComPtr<IAudioCaptureClient> cap_;
+  Client client_;                    // capture thread while running
+  CaptureFormat reported_;           // client_'s format for captureFormat()
+  std::mutex formatMutex_;
 
-  WAVEFORMATEX* wfx_ = nullptr;
   std::thread th_;
   std::atomic<bool> running_{false};
   HANDLE stopEvent_ = nullptr;
+  std::atomic<bool> paused_{false};  // client stopped, everything else kept
+  HANDLE controlEvent_ = nullptr;     // wakes the capture thread for pause and device switches
+
+  // Make-before-break device switching (see drainPackets)
+  std::mutex switchMutex_;
+  std::condition_variable switchCond_;
+  std::atomic<Client*> switching_{nullptr};  // owned by switchDevice(); written under switchMutex_
+  bool switched_ = false;
+  bool forceHandOver_ = false;               // switch without audio from the new client; under switchMutex_
+  int graceWakeups_ = 0;             // capture thread
 
-  BandPlan plan_{};
-  BinMap binmap_{};
+  BandPlan plan_{};   // JS thread only; other threads read analyzer_.plan()
+  SpectrumAnalyzer analyzer_;
   int sampleRate_ = 0;
-  FloatRingBuffer sampleBuf_{4096*4};
-  TripleBuffer<uint8_t> specBuf_{256};
   FftCallback cb_;
   VuCallback vuCb_;
+  StereoCallback stereoCb_;
+  SpectrogramCallback spectrogramCb_;
+  SpectrogramRows spectrogramRows_;  // reused by the publish side
+  ProfileCallback profileCb_;
+  ModuleCallback moduleCb_;
+  PitchCallback pitchCb_;
+  DelayLine delay_;                  // sits between every product and its callback
+  SpectrumLogWriter log_;
+  std::atomic<bool> replaying_{false};  // live output muted while a log plays back
+  std::atomic<bool> stopReplay_{false};
+  float spectrogramSeconds_ = 0.0f;   // history length; > 0 holds Product::Spectrogram
   WaveCallback waveCb_;
 
   // device props
@@ -74,17 +161,20 @@ private:
   // output shaping
   float masterGain_ = 1.0f;
   float tiltExp_ = 0.35f;
-  bool clampUnit_ = true;
 
-  // kissfft state
-  struct Kiss;
-  Kiss* kiss_ = nullptr;
+  // capture scratch, grown on demand and reused across packets
+  std::vector<float> mono_;
+  std::vector<float> right_;         // dual mode
+  std::atomic<ChannelMode> channelMode_{ChannelMode::Left};
+  std::vector<float> interleaved_;
+  SilenceDetector silence_;
 
   std::vector<float> waveformBuf_;
   std::mutex waveformMutex_;
 
   // VU meter state
   int nChannels_ = 0;
-  std::vector<std::vector<float>> vuBufs_;
+  VuHistory vu_;                   // planar, one ring per channel
+  StereoMeter stereo_;             // guarded by vuMutex_ like vu_
   std::mutex vuMutex_;
 };
@@ -0,0 +1,24 @@
+// Assertions shared by the host-compiled unit tests (fft/test/unit.sh and
+// media/test/artwork.sh). CHECK records a failure and carries on, so one run
+// lists every broken check; report() gives main() its exit code.
+#pragma once
+#include <cstdio>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      std::fprintf(stderr, "%s:%d: CHECK(%s)\n", __FILE__, __LINE__, #cond); \
+      ++failures;                                                     \
+    }                                                                 \
+  } while (0)
+
+static int report(const char* name) {
+  if (failures) {
+    std::fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("%s: ok\n", name);
+  return 0;
+}
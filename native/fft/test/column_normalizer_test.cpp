@@ -0,0 +1,99 @@
+// Checks ColumnNormalizer: settings are clamped to percentiles it can track
+// (0 and 1 used to divide the step by zero and turn every column NaN), and
+// the estimates settle on the requested percentiles.
+//
+//   npm run fft:test
+
+#include "column_normalizer.h"
+#include "check.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// Uniform dB levels in [-60, -20) from a fixed xorshift sequence
+struct Levels {
+  uint32_t x = 0x9e3779b9u;
+  double next() {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return -60.0 + 40.0 * (x / 4294967296.0);
+  }
+};
+
+// Runs seconds of 100 frames/s through one column; false once any output is not finite
+static bool run(ColumnNormalizer& n, double seconds, float* last) {
+  Levels lv;
+  n.resize(1);
+  bool finite = true;
+  for (int i = 0; i < int(seconds * 100); ++i) {
+    n.beginFrame(0.01);
+    const float v = n.apply(0, lv.next(), -90.0);
+    n.endFrame();
+    finite = finite && std::isfinite(v);
+    *last = v;
+  }
+  return finite;
+}
+
+static void testEdgeSettings() {
+  ColumnNormalizer n;
+  NormalizerSettings s;
+  s.enabled = true;
+  s.low = 0.0f;
+  s.high = 1.0f;
+  n.setSettings(s);
+  CHECK(n.settings().low == ColumnNormalizer::kMinTail);
+  CHECK(n.settings().high == 1.0f - ColumnNormalizer::kMinTail);
+  float last = 0.0f;
+  CHECK(run(n, 30.0, &last));
+
+  // Each edge on its own
+  s.low = 0.0f;
+  s.high = 0.9f;
+  n.setSettings(s);
+  CHECK(run(n, 10.0, &last));
+  s.low = 0.1f;
+  s.high = 1.0f;
+  n.setSettings(s);
+  CHECK(run(n, 10.0, &last));
+
+  // Out of range and crossed values stay on their own side of the median
+  s.low = -1.0f;
+  s.high = 2.0f;
+  n.setSettings(s);
+  CHECK(n.settings().low == ColumnNormalizer::kMinTail);
+  CHECK(n.settings().high == 1.0f - ColumnNormalizer::kMinTail);
+  s.low = 0.8f;
+  s.high = 0.2f;
+  n.setSettings(s);
+  CHECK(n.settings().low == 0.49f && n.settings().high == 0.51f);
+}
+
+static void testPercentiles() {
+  ColumnNormalizer n;
+  NormalizerSettings s;
+  s.enabled = true;
+  s.low = 0.1f;
+  s.high = 0.9f;
+  s.windowSeconds = 4.0f;
+  s.minRangeDb = 6.0f;
+  n.setSettings(s);
+  float last = 0.0f;
+  CHECK(run(n, 120.0, &last));
+
+  // With lo ~ -56 dB and hi ~ -24 dB, those levels map to ~0 and ~1
+  n.beginFrame(0.01);
+  const float bottom = n.apply(0, -56.0, -90.0);
+  n.beginFrame(0.01);
+  const float top = n.apply(0, -24.0, -90.0);
+  CHECK(std::fabs(bottom) < 0.1f);
+  CHECK(std::fabs(top - 1.0f) < 0.1f);
+  if (std::fabs(bottom) >= 0.1f || std::fabs(top - 1.0f) >= 0.1f) {
+    std::fprintf(stderr, "  mapped 10th/90th percentile to %.3f / %.3f\n", bottom, top);
+  }
+}
+
+int main() {
+  testEdgeSettings();
+  testPercentiles();
+  return report("column normalizer");
+}
@@ -0,0 +1,107 @@
+// Checks DelayLine: frames come out in time order across products, a long
+// delay at a fast hop keeps every frame, and dropping the delay to 0 never
+// lets a queued frame arrive after a newer one.
+//
+//   npm run fft:test
+
+#include "delay_line.h"
+#include "check.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = DelayLine::Clock;
+
+struct Sink {
+  std::mutex mu;
+  std::vector<int> seen;
+  void add(int v) {
+    std::lock_guard<std::mutex> lock(mu);
+    seen.push_back(v);
+  }
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mu);
+    return seen.size();
+  }
+};
+
+static bool waitFor(Sink& s, size_t n, int ms) {
+  const auto end = Clock::now() + std::chrono::milliseconds(ms);
+  while (s.size() < n && Clock::now() < end) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  return s.size() >= n;
+}
+
+static void testOrderAcrossLanes() {
+  Sink sink;
+  std::function<void(const std::vector<float>&)> spectrum = [&](const std::vector<float>& v) { sink.add((int)v[0]); };
+  std::function<void(const int&)> pitch = [&](const int& v) { sink.add(v); };
+
+  DelayLine d;
+  d.setDelayMs(30);
+  const auto t0 = Clock::now();
+  for (int i = 0; i < 40; ++i) {
+    const auto t = t0 + std::chrono::microseconds(500 * i);
+    if (i % 2) {
+      d.emit(pitch, i, t);
+    } else {
+      d.emit(spectrum, std::vector<float>(64, float(i)), t);
+    }
+  }
+  CHECK(sink.size() == 0);
+  CHECK(waitFor(sink, 40, 2000));
+  std::lock_guard<std::mutex> lock(sink.mu);
+  for (int i = 0; i < (int)sink.seen.size(); ++i) CHECK(sink.seen[i] == i);
+}
+
+static void testLongDelayKeepsFrames() {
+  // 5 s at 96 kHz / 256 for three products, pushed faster than real time
+  Sink a, b, c;
+  std::function<void(const int&)> fa = [&](const int& v) { a.add(v); };
+  std::function<void(const int&)> fb = [&](const int& v) { b.add(v); };
+  std::function<void(const int&)> fc = [&](const int& v) { c.add(v); };
+
+  DelayLine d;
+  d.setDelayMs(DelayLine::kMaxDelayMs);
+  const int frames = 5 * 96000 / 256;
+  const auto t0 = Clock::now() - std::chrono::milliseconds(DelayLine::kMaxDelayMs);
+  for (int i = 0; i < frames; ++i) {
+    const auto t = t0 + std::chrono::microseconds(i * 2667);
+    d.emit(fa, i, t);
+    d.emit(fb, i, t);
+    for (int k = 0; k < 4; ++k) d.emit(fc, i * 4 + k, t);   // several per hop, like profiles
+  }
+  CHECK(waitFor(a, frames, 8000));
+  CHECK(waitFor(b, frames, 2000));
+  CHECK(waitFor(c, frames * 4, 2000));
+  std::lock_guard<std::mutex> lock(c.mu);
+  bool ordered = true;
+  for (int i = 0; i < (int)c.seen.size(); ++i) ordered = ordered && c.seen[i] == i;
+  CHECK(ordered);
+}
+
+static void testBackToZero() {
+  Sink sink;
+  std::function<void(const int&)> cb = [&](const int& v) { sink.add(v); };
+
+  DelayLine d;
+  d.setDelayMs(200);
+  for (int i = 0; i < 10; ++i) d.emit(cb, i, Clock::now());
+  d.setDelayMs(0);
+  d.emit(cb, 100, Clock::now());
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+  // The queued frames are gone rather than delivered after the new one
+  std::lock_guard<std::mutex> lock(sink.mu);
+  CHECK(sink.seen.size() == 1);
+  CHECK(!sink.seen.empty() && sink.seen.back() == 100);
+}
+
+int main() {
+  testOrderAcrossLanes();
+  testLongDelayKeepsFrames();
+  testBackToZero();
+  return report("delay line");
+}
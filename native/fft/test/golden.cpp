@@ -0,0 +1,224 @@
+// Checks the native analysis core against the golden vectors (golden.json),
+// or rewrites them.
+//
+// Every case runs a synthetic signal through the same C entry points the
+// WebAssembly build exports (wasm/fft_dsp.cpp) and records the uint8 frames
+// the addon would send. test/golden.js regenerates the signals bit for bit
+// and checks the WebAssembly build against the same file.
+//
+//   npm run fft:golden           check; fails past one uint8 step per column
+//   npm run fft:golden:update    rewrite after an intentional change to the DSP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+  struct FftDsp;
+  FftDsp* fft_dsp_create();
+  void fft_dsp_destroy(FftDsp* d);
+  int fft_dsp_configure(FftDsp* d, int sampleRate, int fftSize, int hopSize, int columns, float dbFloor);
+  void fft_dsp_set_master_gain(FftDsp* d, float g);
+  void fft_dsp_set_tilt(FftDsp* d, float exp);
+  float* fft_dsp_input(FftDsp* d, int n);
+  int fft_dsp_push(FftDsp* d, int n);
+  const uint8_t* fft_dsp_output(FftDsp* d);
+  int fft_dsp_frame_bytes(FftDsp* d);
+}
+
+struct GoldenCase {
+  const char* name;
+  const char* signal;   // saw, square, noise
+  int freq;             // Hz, whole numbers keep the phase exact
+  double amplitude;
+  double onSeconds;     // silence after this
+  int sampleRate;
+  double seconds;
+  int fftSize, hopSize, columns;
+  float dbFloor, gain, tilt;
+};
+
+static const GoldenCase kCases[] = {
+  { "saw-440",        "saw",    440,  0.5,  1.0, 48000, 0.5, 4096, 1024, 64, -80.0f, 1.0f, 0.0f },
+  { "noise",          "noise",  0,    0.25, 1.0, 48000, 0.5, 2048, 512,  32, -70.0f, 1.0f, 0.0f },
+  { "square-burst",   "square", 1000, 0.3,  0.2, 44100, 0.4, 1024, 256,  48, -80.0f, 2.0f, 0.5f },
+  { "saw-110-wide",   "saw",    110,  0.8,  1.0, 48000, 0.6, 8192, 2048, 256, -90.0f, 1.0f, 0.0f },
+};
+
+// Only integer and correctly rounded double arithmetic, so JavaScript
+// reproduces every sample exactly (see golden.js)
+static std::vector<float> render(const GoldenCase& c) {
+  const int n = int(c.seconds * c.sampleRate);
+  const int on = int(c.onSeconds * c.sampleRate);
+  std::vector<float> out(n, 0.0f);
+  const std::string s = c.signal;
+  uint32_t x = 0x9e3779b9u;
+  for (int i = 0; i < n; ++i) {
+    double v = 0.0;
+    if (s == "noise") {
+      x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+      v = double(x >> 8) / 8388608.0 - 1.0;
+    } else {
+      const int64_t p = (int64_t(i) * c.freq) % c.sampleRate;
+      v = s == "saw" ? 2.0 * double(p) / double(c.sampleRate) - 1.0
+                     : (2 * p < c.sampleRate ? 1.0 : -1.0);
+    }
+    out[i] = i < on ? float(c.amplitude * v) : 0.0f;
+  }
+  return out;
+}
+
+static const int kChunk = 480;
+static const int kTolerance = 1;   // same as golden.js
+
+// Frames of one case as lowercase hex, one string per frame
+static bool analyse(const GoldenCase& c, std::vector<std::string>* frames) {
+  FftDsp* d = fft_dsp_create();
+  if (!fft_dsp_configure(d, c.sampleRate, c.fftSize, c.hopSize, c.columns, c.dbFloor)) {
+    std::fprintf(stderr, "%s: bad plan\n", c.name);
+    fft_dsp_destroy(d);
+    return false;
+  }
+  fft_dsp_set_master_gain(d, c.gain);
+  fft_dsp_set_tilt(d, c.tilt);
+
+  const std::vector<float> pcm = render(c);
+  for (size_t o = 0; o < pcm.size(); o += kChunk) {
+    const int n = int(std::min<size_t>(kChunk, pcm.size() - o));
+    std::copy(pcm.begin() + o, pcm.begin() + o + n, fft_dsp_input(d, n));
+    const int count = fft_dsp_push(d, n);
+    const int bytes = fft_dsp_frame_bytes(d);
+    const uint8_t* out = fft_dsp_output(d);
+    for (int k = 0; k < count; ++k) {
+      std::string hex;
+      for (int j = 0; j < bytes; ++j) {
+        static const char kDigits[] = "0123456789abcdef";
+        const uint8_t b = out[k * bytes + j];
+        hex += kDigits[b >> 4];
+        hex += kDigits[b & 15];
+      }
+      frames->push_back(hex);
+    }
+  }
+  fft_dsp_destroy(d);
+  return true;
+}
+
+static int write(FILE* f) {
+  std::fprintf(f, "{\n  \"version\": 1,\n  \"chunk\": %d,\n  \"cases\": [", kChunk);
+  bool first = true;
+  for (const GoldenCase& c : kCases) {
+    std::vector<std::string> frames;
+    if (!analyse(c, &frames)) return 1;
+
+    std::fprintf(f, "%s\n    {\n", first ? "" : ",");
+    std::fprintf(f, "      \"name\": \"%s\", \"signal\": \"%s\", \"freq\": %d, \"amplitude\": %g, \"onSeconds\": %g,\n",
+                 c.name, c.signal, c.freq, c.amplitude, c.onSeconds);
+    std::fprintf(f, "      \"sampleRate\": %d, \"seconds\": %g, \"fftSize\": %d, \"hopSize\": %d, \"columns\": %d,\n",
+                 c.sampleRate, c.seconds, c.fftSize, c.hopSize, c.columns);
+    std::fprintf(f, "      \"dbFloor\": %g, \"gain\": %g, \"tilt\": %g,\n      \"frames\": [",
+                 c.dbFloor, c.gain, c.tilt);
+    for (size_t k = 0; k < frames.size(); ++k) {
+      std::fprintf(f, "%s\n        \"%s\"", k ? "," : "", frames[k].c_str());
+    }
+    std::fprintf(f, "\n      ]\n    }");
+    first = false;
+  }
+  std::fprintf(f, "\n  ]\n}\n");
+  return 0;
+}
+
+// The frames of the named case as written by write(); the file is only ever
+// produced by this program, so a scan for its fixed layout is enough.
+static bool readFrames(const std::string& json, const char* name, std::vector<std::string>* frames) {
+  const std::string key = std::string("\"name\": \"") + name + "\"";
+  size_t at = json.find(key);
+  if (at == std::string::npos) return false;
+  at = json.find("\"frames\": [", at);
+  if (at == std::string::npos) return false;
+  const size_t end = json.find(']', at);
+  at = json.find('"', at + 10);
+  while (at < end) {
+    const size_t close = json.find('"', at + 1);
+    frames->push_back(json.substr(at + 1, close - at - 1));
+    at = json.find('"', close + 1);
+  }
+  return true;
+}
+
+static int hexValue(char c) {
+  return c <= '9' ? c - '0' : c - 'a' + 10;
+}
+
+static int check(FILE* f) {
+  std::string json;
+  char buf[65536];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) json.append(buf, n);
+
+  int failed = 0, cases = 0;
+  for (const GoldenCase& c : kCases) {
+    ++cases;
+    std::vector<std::string> want, got;
+    std::string problem;
+    if (!readFrames(json, c.name, &want)) {
+      problem = "missing from golden.json";
+    } else if (!analyse(c, &got)) {
+      problem = "bad plan";
+    } else if (got.size() != want.size()) {
+      problem = std::to_string(got.size()) + " frames, expected " + std::to_string(want.size());
+    }
+
+    int worst = 0;
+    for (size_t k = 0; problem.empty() && k < got.size(); ++k) {
+      if (got[k].size() != want[k].size()) {
+        problem = "frame " + std::to_string(k) + ": " + std::to_string(got[k].size() / 2) +
+                  " columns, expected " + std::to_string(want[k].size() / 2);
+        break;
+      }
+      for (size_t j = 0; j + 1 < got[k].size(); j += 2) {
+        const int a = hexValue(got[k][j]) * 16 + hexValue(got[k][j + 1]);
+        const int b = hexValue(want[k][j]) * 16 + hexValue(want[k][j + 1]);
+        worst = std::max(worst, std::abs(a - b));
+      }
+    }
+    if (problem.empty() && worst > kTolerance) problem = "max deviation " + std::to_string(worst);
+
+    if (problem.empty()) {
+      std::printf("ok   %s (max deviation %d)\n", c.name, worst);
+    } else {
+      std::printf("FAIL %s: %s\n", c.name, problem.c_str());
+      ++failed;
+    }
+  }
+
+  if (failed) {
+    std::fflush(stdout);
+    std::fprintf(stderr, "%d of %d golden cases failed\n", failed, cases);
+    return 1;
+  }
+  return 0;
+}
+
+// golden --check <file> compares against the file; golden [<file>] rewrites it
+int main(int argc, char** argv) {
+  const bool checking = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+  const char* path = argc > (checking ? 2 : 1) ? argv[checking ? 2 : 1] : nullptr;
+  if (checking && !path) {
+    std::fprintf(stderr, "usage: golden --check <golden.json>\n");
+    return 2;
+  }
+
+  FILE* f = path ? std::fopen(path, checking ? "rb" : "w") : stdout;
+  if (!f) {
+    std::perror(path);
+    return 1;
+  }
+  const int rc = checking ? check(f) : write(f);
+  if (f != stdout) std::fclose(f);
+  return rc;
+}
@@ -0,0 +1,83 @@
+'use strict';
+
+// Checks the WebAssembly analyzer against the golden vectors the native core
+// wrote (golden.cpp). Build it first with npm run fft:wasm, then:
+//
+//   npm run fft:wasm:test
+//
+// Inputs are regenerated bit for bit; outputs may differ by one uint8 step
+// where libm and the FFT round differently.
+
+const path = require('path');
+const { createAnalyzer } = require('../wasm');
+
+const TOLERANCE = 1;
+
+// Mirrors render() in golden.cpp
+function render(c) {
+  const n = Math.trunc(c.seconds * c.sampleRate);
+  const on = Math.trunc(c.onSeconds * c.sampleRate);
+  const out = new Float32Array(n);
+  let x = 0x9e3779b9;
+  for (let i = 0; i < n; i++) {
+    let v;
+    if (c.signal === 'noise') {
+      x = (x ^ (x << 13)) >>> 0;
+      x = (x ^ (x >>> 17)) >>> 0;
+      x = (x ^ (x << 5)) >>> 0;
+      v = (x >>> 8) / 8388608 - 1;
+    } else {
+      const p = Number((BigInt(i) * BigInt(c.freq)) % BigInt(c.sampleRate));
+      v = c.signal === 'saw' ? 2 * p / c.sampleRate - 1 : (2 * p < c.sampleRate ? 1 : -1);
+    }
+    out[i] = i < on ? c.amplitude * v : 0;
+  }
+  return out;
+}
+
+function decode(hex) {
+  return Uint8Array.from(hex.match(/../g), (b) => parseInt(b, 16));
+}
+
+async function main() {
+  const golden = require(path.join(__dirname, 'golden.json'));
+  let failed = 0;
+
+  for (const c of golden.cases) {
+    const analyzer = await createAnalyzer(c);
+    analyzer.setMasterGain(c.gain);
+    analyzer.setTilt(c.tilt);
+
+    const pcm = render(c);
+    const frames = [];
+    for (let o = 0; o < pcm.length; o += golden.chunk) {
+      frames.push(...analyzer.push(pcm.subarray(o, o + golden.chunk)));
+    }
+    analyzer.dispose();
+
+    let worst = 0;
+    let problem = frames.length !== c.frames.length ? `${frames.length} frames, expected ${c.frames.length}` : '';
+    for (let k = 0; !problem && k < frames.length; k++) {
+      const want = decode(c.frames[k]);
+      if (want.length !== frames[k].length) {
+        problem = `frame ${k}: ${frames[k].length} columns, expected ${want.length}`;
+        break;
+      }
+      for (let j = 0; j < want.length; j++) worst = Math.max(worst, Math.abs(want[j] - frames[k][j]));
+    }
+    if (!problem && worst > TOLERANCE) problem = `max deviation ${worst}`;
+
+    console.log(`${problem ? 'FAIL' : 'ok  '} ${c.name}${problem ? ': ' + problem : ` (max deviation ${worst})`}`);
+    if (problem) failed++;
+  }
+
+  if (failed) {
+    console.error(`${failed} of ${golden.cases.length} golden cases failed`);
+    process.exit(1);
+  }
+}
+
+main().catch((e) => {
+  console.error(e);
+  process.exit(1);
+});
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Checks the native analysis core against golden.json with the host
+# compiler, or rewrites the file with --update. Run from native/fft:
+#
+#   npm run fft:golden
+#   npm run fft:golden:update
+set -e
+cd "$(dirname "$0")/.."
+out=build/golden
+mkdir -p $out
+
+for c in src/kiss_fft_simd.c third_party/kissfft/kiss_fft.c third_party/kissfft/kiss_fftr.c; do
+  ${CC:-cc} -O2 -Ithird_party/kissfft -c $c -o $out/$(basename $c .c).o
+done
+
+${CXX:-c++} -std=c++14 -O2 -Isrc -Ithird_party/kissfft \
+  test/golden.cpp \
+  wasm/fft_dsp.cpp \
+  src/spectrum_analyzer.cpp \
+  src/fft_bands.cpp \
+  src/task_graph.cpp \
+  src/spectrogram.cpp \
+  src/cpu_governor.cpp \
+  src/pitch_tracker.cpp \
+  src/batch_fft.cpp \
+  src/spectral_features.cpp \
+  $out/*.o -lpthread -o $out/golden
+
+if [ "$1" = "--update" ]; then
+  $out/golden test/golden.json
+else
+  $out/golden --check test/golden.json
+fi
@@ -0,0 +1,128 @@
+// Checks the analysis scheduler: WorkerPool runs every item exactly once
+// and joins on items rather than workers, TaskGraph keeps dependency order
+// on the pool and keeps cheap levels on the calling thread.
+//
+//   npm run fft:test
+
+#include "task_graph.h"
+#include "check.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+static void testParallelFor() {
+  WorkerPool pool(3);
+  // Back-to-back jobs of every size: late workers from one job must never
+  // claim items of the next
+  for (int round = 0; round < 2000; ++round) {
+    const int n = 1 + round % 17;
+    std::vector<std::atomic<int>> hits(n);
+    for (auto& h : hits) h = 0;
+    pool.parallelFor(n, [&](int i) { hits[i].fetch_add(1); });
+    for (int i = 0; i < n; ++i) CHECK(hits[i].load() == 1);
+  }
+
+  // No pool threads: everything on the caller
+  WorkerPool none(0);
+  const auto self = std::this_thread::get_id();
+  bool inline_ = true;
+  none.parallelFor(4, [&](int) { inline_ = inline_ && std::this_thread::get_id() == self; });
+  CHECK(inline_);
+}
+
+static void testSmallJobs() {
+  WorkerPool pool(3);
+  // Two items per job, the shape of most analysis levels: the caller often
+  // finishes both before the helper wakes, and must return all the same
+  std::atomic<int> sum{0};
+  for (int round = 0; round < 5000; ++round) {
+    pool.parallelFor(2, [&](int i) { sum.fetch_add(i + 1); });
+  }
+  CHECK(sum.load() == 5000 * 3);
+}
+
+static void testOrder() {
+  WorkerPool pool(3);
+  TaskGraph g;
+  std::atomic<int> clock{0};
+  int at[5];
+  auto stamp = [&](int k) {
+    return [&, k] {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      at[k] = clock.fetch_add(1);
+    };
+  };
+  // a -> (b, c, d) -> e, with e also on a
+  const int a = g.addNode("a", stamp(0));
+  const int b = g.addNode("b", stamp(1), {a});
+  const int c = g.addNode("c", stamp(2), {a});
+  const int d = g.addNode("d", stamp(3), {a});
+  g.addNode("e", stamp(4), {b, c, d, a});
+  g.compile();
+
+  for (int round = 0; round < 50; ++round) {
+    g.run(&pool);
+    CHECK(at[0] < at[1] && at[0] < at[2] && at[0] < at[3]);
+    CHECK(at[4] > at[1] && at[4] > at[2] && at[4] > at[3]);
+  }
+  for (auto& s : g.stats()) CHECK(s.runs == 50);
+
+  // A disabled node switches off everything downstream of it
+  g.setEnabled(b, false);
+  g.run(&pool);
+  auto st = g.stats();
+  CHECK(st[b].runs == 50 && st[4].runs == 50);
+  CHECK(st[c].runs == 51 && st[d].runs == 51);
+
+  TaskGraph bad;
+  bad.addNode("x", [] {});
+  bool threw = false;
+  try {
+    bad.addNode("y", [] {}, {5});
+  } catch (const std::logic_error&) {
+    threw = true;
+  }
+  CHECK(threw);
+}
+
+static void testInlineCheapLevels() {
+  WorkerPool pool(3);
+  const auto self = std::this_thread::get_id();
+
+  // Three trivial siblings never leave the calling thread
+  TaskGraph cheap;
+  std::atomic<int> away{0};
+  const int root = cheap.addNode("root", [] {});
+  for (int i = 0; i < 3; ++i) {
+    cheap.addNode("leaf", [&] { if (std::this_thread::get_id() != self) away.fetch_add(1); }, {root});
+  }
+  for (int round = 0; round < 200; ++round) cheap.run(&pool);
+  CHECK(away.load() == 0);
+
+  // Heavy siblings do go to the pool once their cost is known
+  TaskGraph heavy;
+  std::mutex mu;
+  std::set<std::thread::id> seen;
+  for (int i = 0; i < 2; ++i) {
+    heavy.addNode("slow", [&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      std::lock_guard<std::mutex> lock(mu);
+      seen.insert(std::this_thread::get_id());
+    });
+  }
+  for (int round = 0; round < 10; ++round) heavy.run(&pool);
+  CHECK(seen.size() >= 2);
+}
+
+int main() {
+  testParallelFor();
+  testSmallJobs();
+  testOrder();
+  testInlineCheapLevels();
+  return report("task graph");
+}
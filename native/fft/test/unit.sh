@@ -0,0 +1,21 @@
+#!/bin/sh
+# Builds and runs the analysis core unit tests with the host compiler.
+# Run from native/fft:
+#
+#   npm run fft:test
+set -e
+cd "$(dirname "$0")/.."
+out=build/test
+mkdir -p $out
+
+cxx="${CXX:-c++} -std=c++14 -O2 -Wall -Isrc"
+
+$cxx test/task_graph_test.cpp src/task_graph.cpp -lpthread -o $out/task_graph_test
+$cxx test/delay_line_test.cpp src/delay_line.cpp -lpthread -o $out/delay_line_test
+$cxx test/spectrum_log_test.cpp src/spectrum_log.cpp -lpthread -o $out/spectrum_log_test
+$cxx test/column_normalizer_test.cpp -o $out/column_normalizer_test
+
+$out/task_graph_test
+$out/delay_line_test
+$out/spectrum_log_test
+$out/column_normalizer_test
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Builds the WebAssembly analyzer into build/wasm/fft_dsp.js (wasm inlined).
+# Needs the Emscripten SDK on PATH (emcc). Run from native/fft:
+#
+#   npm run fft:wasm
+#
+# -msse maps kissfft's SSE lanes (kiss_fft4.h) and the quantizer loops onto
+# SIMD128, so the batched FFT path is the same one the native build takes.
+set -e
+cd "$(dirname "$0")/.."
+mkdir -p build/wasm
+
+emcc -O3 -msimd128 -msse \
+  -Isrc -Ithird_party/kissfft \
+  wasm/fft_dsp.cpp \
+  src/spectrum_analyzer.cpp \
+  src/fft_bands.cpp \
+  src/task_graph.cpp \
+  src/spectrogram.cpp \
+  src/cpu_governor.cpp \
+  src/pitch_tracker.cpp \
+  src/batch_fft.cpp \
+  src/spectral_features.cpp \
+  -x c src/kiss_fft_simd.c third_party/kissfft/kiss_fft.c third_party/kissfft/kiss_fftr.c -x none \
+  -sMODULARIZE=1 -sEXPORT_NAME=createFftDsp \
+  -sENVIRONMENT=web,worker,node \
+  -sALLOW_MEMORY_GROWTH=1 -sSINGLE_FILE=1 \
+  -sEXPORTED_RUNTIME_METHODS=HEAPU8,HEAPF32 \
+  -o build/wasm/fft_dsp.js
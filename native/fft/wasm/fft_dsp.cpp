@@ -0,0 +1,114 @@
+#include "spectrum_analyzer.h"
+#include "quantize.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/emscripten.h>
+#define FFT_DSP_EXPORT extern "C" EMSCRIPTEN_KEEPALIVE
+#else
+#define FFT_DSP_EXPORT extern "C"
+#endif
+
+// C entry points over the analysis core for the WebAssembly build
+// (build.sh, wrapped by index.js). The same file links natively into
+// test/golden.cpp, so both builds run exactly this path.
+//
+// The host owns a mono PCM stream and feeds it in chunks; every hop the
+// analyzer completes is encoded in the chosen wire format, the same bytes
+// the addon hands to onFft(). Frames from one push sit back to back in the
+// output buffer until the next push.
+
+struct FftDsp {
+  // Plain wasm has no threads; with no workers the task graph runs inline
+  SpectrumAnalyzer analyzer{0};
+  BandPlan plan;
+  int sampleRate = 0;
+  SpectrumFormat format = SpectrumFormat::U8;
+  std::vector<float> input;
+  std::vector<uint8_t> output;
+  size_t frameBytes = 0;
+  int frames = 0;
+
+  FftDsp() {
+    analyzer.setFrameCallback([this](const AnalysisFrame& f) {
+      const size_t bytes = f.spectrum.size() * spectrumFormatBytes(format);
+      if (bytes == 0) return;
+      frameBytes = bytes;
+      output.resize(size_t(frames + 1) * bytes);
+      encodeSpectrum(f.spectrum.data(), f.spectrum.size(), format, output.data() + size_t(frames) * bytes);
+      ++frames;
+    });
+  }
+};
+
+FFT_DSP_EXPORT FftDsp* fft_dsp_create() {
+  return new FftDsp();
+}
+
+FFT_DSP_EXPORT void fft_dsp_destroy(FftDsp* d) {
+  delete d;
+}
+
+// Returns 0 and leaves the analyzer untouched for an unusable plan: fftSize
+// must be a power of two in 64..32768, hopSize 1..fftSize, columns 1..256.
+FFT_DSP_EXPORT int fft_dsp_configure(FftDsp* d, int sampleRate, int fftSize, int hopSize,
+                                     int columns, float dbFloor) {
+  if (sampleRate < 8000 || sampleRate > 384000) return 0;
+  if (fftSize < 64 || fftSize > 32768 || (fftSize & (fftSize - 1)) != 0) return 0;
+  if (hopSize < 1 || hopSize > fftSize) return 0;
+  if (columns < 1 || columns > 256) return 0;
+
+  d->plan.fftSize = fftSize;
+  d->plan.hopSize = hopSize;
+  d->plan.columns = columns;
+  d->plan.dbFloor = dbFloor;
+  d->sampleRate = sampleRate;
+  d->analyzer.configure(sampleRate, d->plan);
+  d->frames = 0;
+  return 1;
+}
+
+FFT_DSP_EXPORT void fft_dsp_set_master_gain(FftDsp* d, float g) {
+  d->analyzer.setMasterGain(g);
+}
+
+FFT_DSP_EXPORT void fft_dsp_set_tilt(FftDsp* d, float exp) {
+  d->analyzer.setTilt(exp);
+}
+
+// SpectrumFormat as int (0 uint8, 1 uint16, 2 float16, 3 float32); returns 0
+// for anything else.
+FFT_DSP_EXPORT int fft_dsp_set_format(FftDsp* d, int format) {
+  if (format < 0 || format > (int)SpectrumFormat::F32) return 0;
+  d->format = (SpectrumFormat)format;
+  return 1;
+}
+
+// Room for n samples; fill it, then call fft_dsp_push(d, n). The pointer is
+// valid until the next call into the module (memory may grow).
+FFT_DSP_EXPORT float* fft_dsp_input(FftDsp* d, int n) {
+  if (n < 0) n = 0;
+  if (d->input.size() < size_t(n)) d->input.resize(n);
+  return d->input.data();
+}
+
+// Analyses n samples from the input buffer; returns how many frames are now
+// in the output buffer.
+FFT_DSP_EXPORT int fft_dsp_push(FftDsp* d, int n) {
+  d->frames = 0;
+  if (d->sampleRate == 0 || n <= 0) return 0;
+  n = (int)std::min(size_t(n), d->input.size());
+  d->analyzer.pushSamples(d->input.data(), size_t(n));
+  return d->frames;
+}
+
+FFT_DSP_EXPORT const uint8_t* fft_dsp_output(FftDsp* d) {
+  return d->output.data();
+}
+
+// Bytes per frame in the output buffer (columns times the format's width).
+FFT_DSP_EXPORT int fft_dsp_frame_bytes(FftDsp* d) {
+  return (int)d->frameBytes;
+}
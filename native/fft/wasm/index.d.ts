@@ -0,0 +1,22 @@
+import type { SpectrumArray, SpectrumFormat } from '../index'
+
+// fftSize: power of two 64..32768; hopSize: 1..fftSize; columns: 1..256
+export interface WasmAnalyzerPlan {
+  sampleRate?: number
+  fftSize?: number
+  hopSize?: number
+  columns?: number
+  dbFloor?: number
+}
+export interface WasmAnalyzerOptions extends WasmAnalyzerPlan { format?: SpectrumFormat }
+export interface WasmAnalyzer {
+  configure(plan: WasmAnalyzerPlan): void
+  setMasterGain(g: number): void
+  setTilt(exp: number): void
+  setFormat(format: SpectrumFormat): void
+  // Mono PCM in; one spectrum per completed hop, oldest first
+  push(samples: Float32Array | ArrayLike<number>): SpectrumArray[]
+  dispose(): void
+}
+// factory: the Emscripten module factory, defaults to build/wasm/fft_dsp.js
+export function createAnalyzer(opts?: WasmAnalyzerOptions, factory?: () => Promise<unknown>): Promise<WasmAnalyzer>
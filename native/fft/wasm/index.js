@@ -0,0 +1,71 @@
+'use strict';
+
+// Client-side spectrum analyzer: the addon's analysis core (framing, window,
+// FFT, band mapping, shaping) compiled to WebAssembly by build.sh. A remote
+// overlay gets one PCM feed from the host and picks its own column layout
+// and frame rate; frames come out in the same wire formats as onFft().
+
+const FORMATS = ['uint8', 'uint16', 'float16', 'float32'];
+const ARRAYS = [Uint8Array, Uint16Array, Uint16Array, Float32Array];
+
+class WasmAnalyzer {
+  constructor(module) {
+    this.m = module;
+    this.h = module._fft_dsp_create();
+    this.format = 0;
+  }
+
+  configure({ sampleRate = 48000, fftSize = 4096, hopSize = 256, columns = 256, dbFloor = -80 } = {}) {
+    if (!this.m._fft_dsp_configure(this.h, sampleRate, fftSize, hopSize, columns, dbFloor)) {
+      throw new RangeError(`unusable analyzer plan: ${JSON.stringify({ sampleRate, fftSize, hopSize, columns })}`);
+    }
+  }
+
+  setMasterGain(g) { this.m._fft_dsp_set_master_gain(this.h, g); }
+  setTilt(exp) { this.m._fft_dsp_set_tilt(this.h, exp); }
+
+  setFormat(format) {
+    const f = FORMATS.indexOf(format);
+    if (f < 0) throw new TypeError(`unknown spectrum format: ${format}`);
+    this.m._fft_dsp_set_format(this.h, f);
+    this.format = f;
+  }
+
+  // Feeds mono samples; returns one spectrum per completed hop, oldest first.
+  push(samples) {
+    const m = this.m;
+    const ptr = m._fft_dsp_input(this.h, samples.length);
+    // Heap views are fetched after every call: memory may have grown
+    m.HEAPF32.set(samples, ptr >> 2);
+    const frames = m._fft_dsp_push(this.h, samples.length);
+    if (frames === 0) return [];
+
+    const bytes = m._fft_dsp_frame_bytes(this.h);
+    const base = m._fft_dsp_output(this.h);
+    const Type = ARRAYS[this.format];
+    const out = [];
+    for (let k = 0; k < frames; k++) {
+      const src = m.HEAPU8.subarray(base + k * bytes, base + (k + 1) * bytes);
+      out.push(new Type(src.slice().buffer));
+    }
+    return out;
+  }
+
+  dispose() {
+    if (this.h) this.m._fft_dsp_destroy(this.h);
+    this.h = 0;
+  }
+}
+
+// factory defaults to the module build.sh writes; bundlers can pass their own.
+async function createAnalyzer(opts, factory) {
+  const create = factory || require('../build/wasm/fft_dsp.js');
+  const analyzer = new WasmAnalyzer(await create());
+  if (opts) {
+    analyzer.configure(opts);
+    if (opts.format) analyzer.setFormat(opts.format);
+  }
+  return analyzer;
+}
+
+module.exports = { createAnalyzer, WasmAnalyzer };
@@ -50,8 +50,21 @@ function loadAddon(dir) {
     }
 }
 
+// On Linux the media addon carries only the artwork cache; the bridge itself
+// is linux-media.js, which picks the cache up on its own
+function loadMedia(dir) {
+    if (os.platform() === "linux") {
+        const jsImpl = path.join(dir, "linux-media.js");
+        if (fs.existsSync(jsImpl)) {
+            console.log(`[Native Loader] Loading JS media bridge: ${jsImpl}`);
+            return require(jsImpl);
+        }
+    }
+    return loadAddon(dir);
+}
+
 const mediaDir = path.join(__dirname, 'media');
 const fftDir   = path.join(__dirname, 'fft');
 
-exports.media = loadAddon(mediaDir);
+exports.media = loadMedia(mediaDir);
 exports.fft   = loadAddon(fftDir);
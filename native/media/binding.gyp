@@ -5,7 +5,9 @@
             "conditions": [
                 ["OS=='win'", {
                     "sources":  [
-                        "src/gsmtc_bridge.cpp"
+                        "src/gsmtc_bridge.cpp",
+                        "src/artwork_cache.cpp",
+                        "src/artwork_addon.cpp"
                     ],
                     "msvs_settings":  {
                         "VCCLCompilerTool":  {
@@ -24,12 +26,24 @@
                     ]
                 }],
                 ["OS=='linux'", {
-                    "sources": [],
-                    "type": "none"
+                    "sources": [
+                        "src/artwork_cache.cpp",
+                        "src/artwork_addon.cpp"
+                    ],
+                    "defines": [
+                        "ARTWORK_STANDALONE"
+                    ],
+                    "cflags_cc": [
+                        "-std=c++14"
+                    ],
+                    "cflags!": ["-fno-exceptions"],
+                    "cflags_cc!": ["-fno-exceptions"]
                 }],
                 ["OS=='mac'", {
                     "sources": [
-                        "src/macos_media_bridge.mm"
+                        "src/macos_media_bridge.mm",
+                        "src/artwork_cache.cpp",
+                        "src/artwork_addon.cpp"
                     ],
                     "xcode_settings": {
                         "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
@@ -4,6 +4,24 @@ const EventEmitter = require("events");
 
 const { sessionBus } = dbus;
 
+// The native side of this module is only the artwork cache (binding.gyp);
+// without a build, artwork is passed through on every emit as before
+function loadArtworkCache() {
+    const candidates = [
+        () => require("node-gyp-build")(__dirname),
+        () => require("./gsmtc.node"),
+    ];
+    for (const load of candidates) {
+        try {
+            const addon = load();
+            if (addon && addon.ArtworkCache) return addon.ArtworkCache;
+        } catch {}
+    }
+    return null;
+}
+
+const ArtworkCache = loadArtworkCache();
+
 class GSMTCBridge extends EventEmitter {
     constructor() {
         super();
@@ -16,6 +34,12 @@ class GSMTCBridge extends EventEmitter {
 
         this.lastEmitTime = 0;
         this.throttleMs = 1000; // 1-second throttle
+
+        this.artworkCache = ArtworkCache ? new ArtworkCache() : null;
+        this.artUrl = undefined;
+        this.artBytes = null;
+        this.artwork = null;
+        this.emittedArtworkId = null;
     }
 
     async start(callback) {
@@ -51,12 +75,23 @@ class GSMTCBridge extends EventEmitter {
         this.callback = null;
         this.playerName = null;
         this.propsIface = null;
+        this.emittedArtworkId = null;
     }
 
     emitThrottled(state) {
         const now = Date.now();
         if (now - this.lastEmitTime >= this.throttleMs) {
             this.lastEmitTime = now;
+            if (state.artwork) {
+                // Decided at emit time so a throttled-away change is not lost
+                const changed = state.artwork.id !== this.emittedArtworkId;
+                this.emittedArtworkId = state.artwork.id;
+                state = {
+                    ...state,
+                    artwork: { ...state.artwork, changed },
+                    thumbnail: changed ? state.thumbnail : null,
+                };
+            }
             if (this.callback) this.callback(state);
             this.emit("data", state);
         }
@@ -155,14 +190,20 @@ class GSMTCBridge extends EventEmitter {
             const lengthUs = toNumber(meta["mpris:length"]?.value);
 
             const artUrl = meta["mpris:artUrl"]?.value || null;
-            let thumbnail = null;
-
-            if (artUrl && artUrl.startsWith("file://")) {
-                const filePath = decodeURIComponent(artUrl.replace("file://", ""));
-                try {
-                    const fs = require("fs");
-                    thumbnail = fs.readFileSync(filePath);
-                } catch {}
+
+            // PropertiesChanged fires for position and status too; the art
+            // file is only read again when the player points somewhere else
+            if (artUrl !== this.artUrl) {
+                this.artUrl = artUrl;
+                this.artBytes = null;
+                if (artUrl && artUrl.startsWith("file://")) {
+                    const filePath = decodeURIComponent(artUrl.replace("file://", ""));
+                    try {
+                        const fs = require("fs");
+                        this.artBytes = fs.readFileSync(filePath);
+                    } catch {}
+                }
+                this.artwork = this.artworkCache ? this.artworkCache.submit(this.artBytes) : null;
             }
 
             const state = {
@@ -176,7 +217,8 @@ class GSMTCBridge extends EventEmitter {
                 positionMs: Math.floor(positionUs / 1000),
                 playbackStatus: status,
                 imageUrl: artUrl && !artUrl.startsWith("file://") ? artUrl : null,
-                thumbnail,
+                thumbnail: this.artBytes,
+                artwork: this.artwork,
             };
 
             this.lastState = state;
@@ -193,5 +235,6 @@ class GSMTCBridge extends EventEmitter {
 }
 
 module.exports = {
-    GSMTCBridge
+    GSMTCBridge,
+    ArtworkCache
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "artwork_addon.h"
+#include <algorithm>
+
+static Napi::Object ImageFields(Napi::Env env, const ArtworkImage* img) {
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("id", Napi::Number::New(env, img ? img->id : 0));
+  o.Set("mime", Napi::String::New(env, img ? img->mime : std::string()));
+  o.Set("width", Napi::Number::New(env, img ? img->width : 0));
+  o.Set("height", Napi::Number::New(env, img ? img->height : 0));
+  o.Set("size", Napi::Number::New(env, img ? (double)img->bytes.size() : 0.0));
+  return o;
+}
+
+Napi::Object ArtworkInfo(Napi::Env env, const ArtworkCache::Submission& s) {
+  Napi::Object o = ImageFields(env, s.image.get());
+  o.Set("changed", Napi::Boolean::New(env, s.changed));
+  return o;
+}
+
+// JS face of ArtworkCache, for media paths that live in JS (linux-media.js):
+//   submit(buffer | null) -> info, get(id) -> { id, mime, ..., data, dataUrl } | null
+class ArtworkCacheWrap : public Napi::ObjectWrap<ArtworkCacheWrap> {
+public:
+  static Napi::Function Define(Napi::Env env) {
+    return DefineClass(env, "ArtworkCache", {
+      InstanceMethod("submit", &ArtworkCacheWrap::Submit),
+      InstanceMethod("get", &ArtworkCacheWrap::Get),
+      InstanceMethod("clear", &ArtworkCacheWrap::Clear),
+      InstanceMethod("currentId", &ArtworkCacheWrap::CurrentId),
+      InstanceMethod("size", &ArtworkCacheWrap::Size)
+    });
+  }
+
+  ArtworkCacheWrap(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<ArtworkCacheWrap>(info),
+      cache_(info.Length() > 0 && info[0].IsNumber() ? std::max(1u, info[0].As<Napi::Number>().Uint32Value()) : 8) {}
+
+private:
+  Napi::Value Submit(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+      return ArtworkInfo(env, cache_.submit(nullptr, 0));
+    }
+    if (!info[0].IsTypedArray()) {
+      Napi::TypeError::New(env, "Buffer or Uint8Array required").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    Napi::TypedArray arr = info[0].As<Napi::TypedArray>();
+    const uint8_t* data = static_cast<const uint8_t*>(arr.ArrayBuffer().Data()) + arr.ByteOffset();
+    return ArtworkInfo(env, cache_.submit(data, arr.ByteLength()));
+  }
+
+  Napi::Value Get(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+      Napi::TypeError::New(env, "artwork id required").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    auto img = cache_.find(info[0].As<Napi::Number>().Uint32Value());
+    if (!img) return env.Null();
+
+    Napi::Object o = ImageFields(env, img.get());
+    o.Set("data", Napi::Buffer<uint8_t>::Copy(env, img->bytes.data(), img->bytes.size()));
+    o.Set("dataUrl", Napi::String::New(env, ArtworkCache::dataUrl(*img)));
+    return o;
+  }
+
+  Napi::Value Clear(const Napi::CallbackInfo& info) {
+    cache_.clear();
+    return info.Env().Undefined();
+  }
+
+  Napi::Value CurrentId(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), cache_.currentId());
+  }
+
+  Napi::Value Size(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), (double)cache_.size());
+  }
+
+  ArtworkCache cache_;
+};
+
+Napi::Object InitArtworkCache(Napi::Env env, Napi::Object exports) {
+  exports.Set("ArtworkCache", ArtworkCacheWrap::Define(env));
+  return exports;
+}
+
+#ifdef ARTWORK_STANDALONE
+// Linux has no native media bridge (see linux-media.js); the module carries
+// the cache alone
+NODE_API_MODULE(NODE_GYP_MODULE_NAME, InitArtworkCache)
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+#include <napi.h>
+#include "artwork_cache.h"
+
+// { id, changed, mime, width, height, size } for a submission; id 0 and an
+// empty mime when the track has no artwork.
+Napi::Object ArtworkInfo(Napi::Env env, const ArtworkCache::Submission& s);
+
+// Adds the ArtworkCache class to exports (see artwork_addon.cpp).
+Napi::Object InitArtworkCache(Napi::Env env, Napi::Object exports);
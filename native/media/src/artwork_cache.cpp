@@ -0,0 +1,214 @@
+#include "artwork_cache.h"
+#include <cstring>
+
+namespace {
+
+uint32_t be16(const uint8_t* p) { return (uint32_t(p[0]) << 8) | p[1]; }
+uint32_t be32(const uint8_t* p) { return (be16(p) << 16) | be16(p + 2); }
+uint32_t le16(const uint8_t* p) { return p[0] | (uint32_t(p[1]) << 8); }
+uint32_t le24(const uint8_t* p) { return le16(p) | (uint32_t(p[2]) << 16); }
+uint32_t le32(const uint8_t* p) { return le24(p) | (uint32_t(p[3]) << 24); }
+
+bool probeJpeg(const uint8_t* d, size_t n, int* w, int* h) {
+  // Walk the marker segments up to the first start-of-frame
+  size_t i = 2;
+  while (i + 4 <= n) {
+    if (d[i] != 0xFF) return false;
+    const uint8_t m = d[i + 1];
+    if (m == 0xFF) { ++i; continue; }                          // fill byte
+    if (m == 0x01 || (m >= 0xD0 && m <= 0xD7)) { i += 2; continue; }  // no length
+    const size_t len = be16(d + i + 2);
+    if (len < 2) return false;
+    const bool sof = m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC;
+    if (sof) {
+      if (i + 9 > n) return false;
+      *h = (int)be16(d + i + 5);
+      *w = (int)be16(d + i + 7);
+      return true;
+    }
+    if (m == 0xDA || m == 0xD9) return false;  // scan data without a frame header
+    i += 2 + len;
+  }
+  return false;
+}
+
+bool probeWebp(const uint8_t* d, size_t n, int* w, int* h) {
+  if (n < 30) return false;
+  const uint8_t* c = d + 12;
+  if (std::memcmp(c, "VP8 ", 4) == 0) {
+    // Lossy: key frame start code, then 14-bit dimensions
+    if (d[23] != 0x9D || d[24] != 0x01 || d[25] != 0x2A) return false;
+    *w = (int)(le16(d + 26) & 0x3FFF);
+    *h = (int)(le16(d + 28) & 0x3FFF);
+    return true;
+  }
+  if (std::memcmp(c, "VP8L", 4) == 0) {
+    // Lossless: signature byte, then 14-bit width - 1 and height - 1
+    if (d[20] != 0x2F) return false;
+    const uint32_t bits = le32(d + 21);
+    *w = (int)(bits & 0x3FFF) + 1;
+    *h = (int)((bits >> 14) & 0x3FFF) + 1;
+    return true;
+  }
+  if (std::memcmp(c, "VP8X", 4) == 0) {
+    // Extended: 24-bit canvas width - 1 and height - 1
+    *w = (int)le24(d + 24) + 1;
+    *h = (int)le24(d + 27) + 1;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+ArtworkCache::ArtworkCache(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+uint64_t ArtworkCache::hashBytes(const uint8_t* data, size_t size) {
+  const uint64_t kPrime = 0x100000001b3ull;
+  uint64_t h = 0xcbf29ce484222325ull ^ size;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    h = (h ^ word) * kPrime;
+    h ^= h >> 29;
+  }
+  for (; i < size; ++i) h = (h ^ data[i]) * kPrime;
+  return h ^ (h >> 32);
+}
+
+bool ArtworkCache::probe(const uint8_t* d, size_t n, std::string* mime, int* width, int* height) {
+  int w = 0, h = 0;
+  const char* type = nullptr;
+  if (n >= 24 && std::memcmp(d, "\x89PNG\r\n\x1a\n", 8) == 0 && std::memcmp(d + 12, "IHDR", 4) == 0) {
+    type = "image/png";
+    w = (int)be32(d + 16);
+    h = (int)be32(d + 20);
+  } else if (n >= 4 && d[0] == 0xFF && d[1] == 0xD8 && d[2] == 0xFF) {
+    type = "image/jpeg";
+    probeJpeg(d, n, &w, &h);
+  } else if (n >= 10 && (std::memcmp(d, "GIF87a", 6) == 0 || std::memcmp(d, "GIF89a", 6) == 0)) {
+    type = "image/gif";
+    w = (int)le16(d + 6);
+    h = (int)le16(d + 8);
+  } else if (n >= 16 && std::memcmp(d, "RIFF", 4) == 0 && std::memcmp(d + 8, "WEBP", 4) == 0) {
+    type = "image/webp";
+    probeWebp(d, n, &w, &h);
+  } else if (n >= 26 && d[0] == 'B' && d[1] == 'M') {
+    type = "image/bmp";
+    w = (int)le32(d + 18);
+    h = (int)le32(d + 22);
+    if (h < 0) h = -h;  // top-down rows
+  }
+
+  *mime = type ? type : "application/octet-stream";
+  *width = w;
+  *height = h;
+  return type != nullptr;
+}
+
+std::string ArtworkCache::base64(const uint8_t* data, size_t size) {
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((size + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    const uint32_t v = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+    out += kAlphabet[v >> 18];
+    out += kAlphabet[(v >> 12) & 63];
+    out += kAlphabet[(v >> 6) & 63];
+    out += kAlphabet[v & 63];
+  }
+  if (i < size) {
+    const bool two = i + 1 < size;
+    const uint32_t v = (uint32_t(data[i]) << 16) | (two ? uint32_t(data[i + 1]) << 8 : 0);
+    out += kAlphabet[v >> 18];
+    out += kAlphabet[(v >> 12) & 63];
+    out += two ? kAlphabet[(v >> 6) & 63] : '=';
+    out += '=';
+  }
+  return out;
+}
+
+std::string ArtworkCache::dataUrl(const ArtworkImage& img) {
+  return "data:" + img.mime + ";base64," + base64(img.bytes.data(), img.bytes.size());
+}
+
+ArtworkCache::Submission ArtworkCache::submit(const uint8_t* data, size_t size) {
+  Submission s;
+  if (!data || size == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.changed = currentId_ != 0;
+    currentId_ = 0;
+    return s;
+  }
+
+  // Hash and build outside the lock; the media thread is the only writer
+  // in practice, but JS may look entries up concurrently
+  const uint64_t hash = hashBytes(data, size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byHash_.find(hash);
+    if (it != byHash_.end()) {
+      const Entry& e = *it->second;
+      if (e->bytes.size() == size && std::memcmp(e->bytes.data(), data, size) == 0) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        s.image = e;
+        s.changed = e->id != currentId_;
+        currentId_ = e->id;
+        return s;
+      }
+    }
+  }
+
+  auto img = std::make_shared<ArtworkImage>();
+  img->hash = hash;
+  img->bytes.assign(data, data + size);
+  probe(data, size, &img->mime, &img->width, &img->height);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = byHash_.find(hash);
+  if (it != byHash_.end()) {
+    // Hash collision (or a racing submit of the same image): the newest wins
+    lru_.erase(it->second);
+    byHash_.erase(it);
+  }
+  img->id = nextId_++;
+  if (nextId_ == 0) nextId_ = 1;
+  lru_.push_front(img);
+  byHash_[hash] = lru_.begin();
+  while (lru_.size() > capacity_) {
+    byHash_.erase(lru_.back()->hash);
+    lru_.pop_back();
+  }
+
+  s.image = img;
+  s.changed = img->id != currentId_;
+  currentId_ = img->id;
+  return s;
+}
+
+std::shared_ptr<const ArtworkImage> ArtworkCache::find(uint32_t id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const Entry& e : lru_) {
+    if (e->id == id) return e;
+  }
+  return nullptr;
+}
+
+uint32_t ArtworkCache::currentId() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return currentId_;
+}
+
+size_t ArtworkCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return lru_.size();
+}
+
+void ArtworkCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lru_.clear();
+  byHash_.clear();
+  currentId_ = 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One distinct album-art image. Entries are immutable once cached, so the
+// media thread and JS can hold them without copying.
+struct ArtworkImage {
+  uint32_t id = 0;              // stable while cached; 0 is never used
+  uint64_t hash = 0;            // of the encoded bytes
+  std::string mime;             // image/png, image/jpeg, ...; application/octet-stream if unknown
+  int width = 0;                // from the header, 0 when it could not be read
+  int height = 0;
+  std::vector<uint8_t> bytes;   // the image as the player supplied it
+};
+
+// Platform-independent album-art cache shared by the media bridges.
+//
+// Players hand over the same thumbnail on every metadata, playback and
+// timeline event. submit() hashes the bytes and keeps the last few distinct
+// images in an LRU, so a repeat costs one hash instead of a fresh probe and
+// broadcast. Callers forward the image only when submit() reports a change
+// and refer to it by id otherwise.
+class ArtworkCache {
+public:
+  struct Submission {
+    std::shared_ptr<const ArtworkImage> image;  // null for no artwork
+    bool changed = false;                       // differs from the previous submit()
+  };
+
+  explicit ArtworkCache(size_t capacity = 8);
+
+  // Thread-safe. An empty image means the track has no artwork.
+  Submission submit(const uint8_t* data, size_t size);
+  // Thread-safe; null once the entry has been evicted.
+  std::shared_ptr<const ArtworkImage> find(uint32_t id) const;
+  // Id of the last submitted image, 0 for none.
+  uint32_t currentId() const;
+
+  size_t size() const;
+  size_t capacity() const { return capacity_; }
+  // Forgets every entry; the next submit() reports a change.
+  void clear();
+
+  // FNV-1a style 64-bit hash taken a machine word at a time; only ever
+  // compared within one process.
+  static uint64_t hashBytes(const uint8_t* data, size_t size);
+  // Reads format and pixel size from the header (PNG, JPEG, GIF, WebP, BMP)
+  // without decoding. Returns false for anything else.
+  static bool probe(const uint8_t* data, size_t size, std::string* mime, int* width, int* height);
+  static std::string base64(const uint8_t* data, size_t size);
+  // data:<mime>;base64,... for one image; built on request, never cached
+  static std::string dataUrl(const ArtworkImage& img);
+
+private:
+  using Entry = std::shared_ptr<const ArtworkImage>;
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::list<Entry> lru_;   // most recently submitted first
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> byHash_;
+  uint32_t nextId_ = 1;
+  uint32_t currentId_ = 0;
+};
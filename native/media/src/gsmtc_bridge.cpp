@@ -11,6 +11,8 @@
 #include <winrt/Windows.Media.Control.h>
 #include <winrt/Windows.Storage.Streams.h>
 
+#include "artwork_addon.h"
+
 using namespace winrt;
 using namespace Windows::Foundation;
 using namespace Windows::Media::Control;
@@ -24,7 +26,16 @@ struct EventData {
   int64_t durationMs{};
   int64_t positionMs{};
   int32_t playbackStatus{};
-  std::vector<uint8_t> thumbnail;
+  ArtworkCache::Submission artwork;  // image bytes go out only when changed
+};
+
+// Media properties as last read from the session; playback and timeline
+// events reuse them instead of re-reading the thumbnail stream
+struct MediaProps {
+  std::string title;
+  std::string artist;
+  std::string album;
+  std::shared_ptr<const ArtworkImage> artwork;
 };
 
 struct ErrorData {
@@ -105,6 +116,8 @@ private:
       errorTsfn_ = Napi::ThreadSafeFunction::New(env, info[1].As<Napi::Function>(), "GSMTCErrorCallback", 0, 1);
     }
 
+    // A new listener has not seen any artwork yet
+    artwork_.clear();
     running_ = true;
     worker_ = std::thread([this] { this->Pump(); });
 
@@ -245,7 +258,7 @@ private:
           try {
             auto s = m.GetCurrentSession();
             SubscribeToSession(s);
-            if (s) EmitSnapshot(s);
+            if (s) EmitSnapshot(s, true);
           } catch (const winrt::hresult_error& e) {
             LogError("CurrentSessionChanged", winrt::to_string(e.message()), e.code());
           } catch (const std::exception& e) {
@@ -259,7 +272,7 @@ private:
       {
         auto s = mgr_.GetCurrentSession();
         SubscribeToSession(s);
-        if (s) EmitSnapshot(s);
+        if (s) EmitSnapshot(s, true);
       }
 
       std::cerr << "[GSMTC] Pump: entering main loop" << std::endl;
@@ -302,12 +315,17 @@ private:
     }
 
     session_ = s;
+    {
+      // A new session starts with a fresh read of its media properties
+      std::lock_guard<std::mutex> mediaLock(mediaMutex_);
+      mediaRead_ = false;
+    }
     if (!session_) return;
 
     try {
       mediaPropsToken_ = session_.MediaPropertiesChanged([this](auto const& sess, auto const&) {
         if (!running_) return;
-        try { EmitSnapshot(sess); }
+        try { EmitSnapshot(sess, true); }
         catch (const winrt::hresult_error& e) { LogError("MediaPropertiesChanged", winrt::to_string(e.message()), e.code()); }
         catch (const std::exception& e) { LogError("MediaPropertiesChanged", e.what()); }
         catch (...) { LogError("MediaPropertiesChanged", "Unknown error"); }
@@ -315,7 +333,7 @@ private:
 
       playbackToken_ = session_.PlaybackInfoChanged([this](auto const& sess, auto const&) {
         if (!running_) return;
-        try { EmitSnapshot(sess); }
+        try { EmitSnapshot(sess, false); }
         catch (const winrt::hresult_error& e) { LogError("PlaybackInfoChanged", winrt::to_string(e.message()), e.code()); }
         catch (const std::exception& e) { LogError("PlaybackInfoChanged", e.what()); }
         catch (...) { LogError("PlaybackInfoChanged", "Unknown error"); }
@@ -323,7 +341,7 @@ private:
 
       timelineToken_ = session_.TimelinePropertiesChanged([this](auto const& sess, auto const&) {
         if (!running_) return;
-        try { EmitSnapshot(sess); }
+        try { EmitSnapshot(sess, false); }
         catch (const winrt::hresult_error& e) { LogError("TimelinePropertiesChanged", winrt::to_string(e.message()), e.code()); }
         catch (const std::exception& e) { LogError("TimelinePropertiesChanged", e.what()); }
         catch (...) { LogError("TimelinePropertiesChanged", "Unknown error"); }
@@ -343,42 +361,70 @@ private:
     }
   }
 
-  void EmitSnapshot(GlobalSystemMediaTransportControlsSession const& s) {
+  // refreshMedia: the media properties (and with them the artwork) may have
+  // changed; otherwise the last ones read are reused
+  void EmitSnapshot(GlobalSystemMediaTransportControlsSession const& s, bool refreshMedia) {
     if (!running_ || !s) return;
 
     EventData ev;
 
+    {
+      std::lock_guard<std::mutex> lock(mediaMutex_);
+      if (!mediaRead_) refreshMedia = true;
+    }
+
     // media properties
-    try {
-      auto op = s.TryGetMediaPropertiesAsync();
-      if (op && wait_for(op)) {
-        auto props = op.get();
-        if (props) {
-          ev.title  = winrt::to_string(props.Title());
-          ev.artist = winrt::to_string(props.Artist());
-          ev.album  = winrt::to_string(props.AlbumTitle());
-
-          if (auto thumb = props.Thumbnail()) {
-            try {
-              auto rop = thumb.OpenReadAsync();
-              if (rop && wait_for(rop)) {
-                auto rs = rop.get();
-                ev.thumbnail = ReadAll(rs); // внутри тоже с таймаутом
+    bool refreshed = false;
+    if (refreshMedia) {
+      try {
+        MediaProps media;
+        std::vector<uint8_t> thumbnail;
+        auto op = s.TryGetMediaPropertiesAsync();
+        if (op && wait_for(op)) {
+          auto props = op.get();
+          if (props) {
+            media.title  = winrt::to_string(props.Title());
+            media.artist = winrt::to_string(props.Artist());
+            media.album  = winrt::to_string(props.AlbumTitle());
+
+            if (auto thumb = props.Thumbnail()) {
+              try {
+                auto rop = thumb.OpenReadAsync();
+                if (rop && wait_for(rop)) {
+                  auto rs = rop.get();
+                  thumbnail = ReadAll(rs); // внутри тоже с таймаутом
+                }
+              } catch (const winrt::hresult_error& e) {
+                LogError("EmitSnapshot/Thumbnail", winrt::to_string(e.message()), e.code());
+              } catch (...) {
+                LogError("EmitSnapshot/Thumbnail", "Failed to read thumbnail");
               }
-            } catch (const winrt::hresult_error& e) {
-              LogError("EmitSnapshot/Thumbnail", winrt::to_string(e.message()), e.code());
-            } catch (...) {
-              LogError("EmitSnapshot/Thumbnail", "Failed to read thumbnail");
             }
           }
         }
+
+        // An unchanged image costs one hash and is not copied to JS again
+        ev.artwork = artwork_.submit(thumbnail.data(), thumbnail.size());
+        media.artwork = ev.artwork.image;
+        std::lock_guard<std::mutex> lock(mediaMutex_);
+        media_ = std::move(media);
+        mediaRead_ = true;
+        refreshed = true;
+      } catch (const winrt::hresult_error& e) {
+        LogError("EmitSnapshot/MediaProps", winrt::to_string(e.message()), e.code());
+      } catch (const std::exception& e) {
+        LogError("EmitSnapshot/MediaProps", e.what());
+      } catch (...) {
+        LogError("EmitSnapshot/MediaProps", "Unknown error");
       }
-    } catch (const winrt::hresult_error& e) {
-      LogError("EmitSnapshot/MediaProps", winrt::to_string(e.message()), e.code());
-    } catch (const std::exception& e) {
-      LogError("EmitSnapshot/MediaProps", e.what());
-    } catch (...) {
-      LogError("EmitSnapshot/MediaProps", "Unknown error");
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mediaMutex_);
+      ev.title  = media_.title;
+      ev.artist = media_.artist;
+      ev.album  = media_.album;
+      if (!refreshed) ev.artwork.image = media_.artwork;
     }
 
     // playback info
@@ -432,8 +478,10 @@ private:
           o.Set("positionMs", Napi::Number::New(env, static_cast<double>(data->positionMs)));
           o.Set("playbackStatus", data->playbackStatus);
 
-          if (!data->thumbnail.empty()) {
-            auto buf = Napi::Buffer<uint8_t>::Copy(env, data->thumbnail.data(), data->thumbnail.size());
+          o.Set("artwork", ArtworkInfo(env, data->artwork));
+          const ArtworkImage* img = data->artwork.image.get();
+          if (img && data->artwork.changed) {
+            auto buf = Napi::Buffer<uint8_t>::Copy(env, img->bytes.data(), img->bytes.size());
             o.Set("thumbnail", buf);
           }
           cb.Call({ o });
@@ -456,6 +504,11 @@ private:
   Napi::ThreadSafeFunction tsfn_{};
   Napi::ThreadSafeFunction errorTsfn_{};
 
+  ArtworkCache artwork_;
+  std::mutex mediaMutex_;
+  MediaProps media_;         // guarded by mediaMutex_
+  bool mediaRead_ = false;
+
   GlobalSystemMediaTransportControlsSessionManager mgr_{ nullptr };
   event_token currentChangedToken_{};
 
@@ -466,6 +519,7 @@ private:
 };
 
 Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
+  InitArtworkCache(env, exports);
   return GSMTCBridge::Init(env, exports);
 }
 
@@ -8,6 +8,7 @@
 #include <mutex>
 #include <dlfcn.h>
 #include "MediaRemote.h"
+#include "artwork_addon.h"
 
 struct MediaState {
     std::string title;
@@ -65,6 +66,8 @@ private:
             errorCallback_ = Napi::Persistent(info[1].As<Napi::Function>());
         }
 
+        // A new listener has not seen any artwork yet
+        artwork_.clear();
         running_ = true;
 
         // Create thread-safe function for callbacks
@@ -113,8 +116,14 @@ private:
             @autoreleasepool {
                 MediaState state = FetchMediaState();
 
+                // The same artwork comes back on every poll; only a new image
+                // crosses into JS, otherwise just its cache id
+                ArtworkCache::Submission artwork =
+                    artwork_.submit(state.thumbnail.data(), state.thumbnail.size());
+                state.thumbnail.clear();
+
                 // Call JavaScript callback
-                auto callback = [state](Napi::Env env, Napi::Function jsCallback) {
+                auto callback = [state, artwork](Napi::Env env, Napi::Function jsCallback) {
                     Napi::Object obj = Napi::Object::New(env);
                     obj.Set("title", Napi::String::New(env, state.title));
                     obj.Set("artist", Napi::String::New(env, state.artist));
@@ -124,11 +133,12 @@ private:
                     obj.Set("positionMs", Napi::Number::New(env, state.positionMs));
                     obj.Set("playbackStatus", Napi::String::New(env, state.playbackStatus));
 
-                    if (!state.thumbnail.empty()) {
+                    obj.Set("artwork", ArtworkInfo(env, artwork));
+                    if (artwork.changed && artwork.image) {
                         Napi::Buffer<uint8_t> buf = Napi::Buffer<uint8_t>::Copy(
                             env,
-                            state.thumbnail.data(),
-                            state.thumbnail.size()
+                            artwork.image->bytes.data(),
+                            artwork.image->bytes.size()
                         );
                         obj.Set("thumbnail", buf);
                     }
@@ -508,9 +518,12 @@ private:
     Napi::FunctionReference dataCallback_;
     Napi::FunctionReference errorCallback_;
     Napi::ThreadSafeFunction tsfn_;
+
+    ArtworkCache artwork_;
 };
 
 Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
+    InitArtworkCache(env, exports);
     return MacOSMediaBridge::Init(env, exports);
 }
 
@@ -4,7 +4,7 @@ const bridge = new GSMTCBridge();
 bridge.start((s) => {
   const sec = (x)=>Math.round((x||0)/1000);
   console.log(`[${s.appId}] ${s.title} — ${s.artist}  ${sec(s.positionMs)}/${sec(s.durationMs)}s  status=${s.playbackStatus}`);
-  console.log(`${s.thumbnail.length}`);
+  console.log(`artwork #${s.artwork ? s.artwork.id : 0}${s.thumbnail ? ` (new, ${s.thumbnail.length} bytes)` : ''}`);
 });
 
 console.log('GSMTC started, waiting for events...');
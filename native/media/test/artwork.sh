@@ -0,0 +1,16 @@
+#!/bin/sh
+# Builds and runs the artwork cache test with the host compiler.
+# Run from native/media:
+#
+#   npm run media:test
+set -e
+cd "$(dirname "$0")/.."
+out=build/test
+mkdir -p $out
+
+${CXX:-c++} -std=c++14 -O2 -Wall -Isrc -I../fft/test \
+  test/artwork_test.cpp \
+  src/artwork_cache.cpp \
+  -lpthread -o $out/artwork_test
+
+$out/artwork_test
@@ -0,0 +1,201 @@
+// Checks ArtworkCache without a media session: header probing on minimal
+// images of each supported format, base64, change reporting and eviction.
+//
+//   npm run media:test
+
+#include "artwork_cache.h"
+#include "check.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using Bytes = std::vector<uint8_t>;
+
+static void put16be(Bytes& b, uint32_t v) { b.push_back(uint8_t(v >> 8)); b.push_back(uint8_t(v)); }
+static void put32be(Bytes& b, uint32_t v) { put16be(b, v >> 16); put16be(b, v & 0xFFFF); }
+static void put16le(Bytes& b, uint32_t v) { b.push_back(uint8_t(v)); b.push_back(uint8_t(v >> 8)); }
+static void put32le(Bytes& b, uint32_t v) { put16le(b, v & 0xFFFF); put16le(b, v >> 16); }
+static void putStr(Bytes& b, const char* s) { b.insert(b.end(), s, s + std::strlen(s)); }
+
+// Only the headers matter to probe(); pixel data is padding
+static Bytes png(uint32_t w, uint32_t h) {
+  Bytes b;
+  putStr(b, "\x89PNG\r\n\x1a\n");
+  put32be(b, 13);
+  putStr(b, "IHDR");
+  put32be(b, w);
+  put32be(b, h);
+  b.insert(b.end(), {8, 6, 0, 0, 0});
+  b.resize(b.size() + 16, 0);
+  return b;
+}
+
+static Bytes jpeg(uint32_t w, uint32_t h) {
+  Bytes b = {0xFF, 0xD8};
+  b.insert(b.end(), {0xFF, 0xE0});   // APP0 ahead of the frame header
+  put16be(b, 16);
+  putStr(b, "JFIF");
+  b.resize(b.size() + 10, 0);
+  b.insert(b.end(), {0xFF, 0xC2});   // progressive SOF
+  put16be(b, 11);
+  b.push_back(8);
+  put16be(b, h);
+  put16be(b, w);
+  b.insert(b.end(), {1, 1, 0x11, 0});
+  b.insert(b.end(), {0xFF, 0xD9});
+  return b;
+}
+
+static Bytes gif(uint32_t w, uint32_t h) {
+  Bytes b;
+  putStr(b, "GIF89a");
+  put16le(b, w);
+  put16le(b, h);
+  b.resize(b.size() + 8, 0);
+  return b;
+}
+
+static Bytes webp(const char* chunk, uint32_t w, uint32_t h) {
+  Bytes b;
+  putStr(b, "RIFF");
+  put32le(b, 22);
+  putStr(b, "WEBP");
+  putStr(b, chunk);
+  put32le(b, 10);
+  if (std::strcmp(chunk, "VP8 ") == 0) {
+    b.insert(b.end(), {0, 0, 0, 0x9D, 0x01, 0x2A});
+    put16le(b, w);
+    put16le(b, h);
+  } else if (std::strcmp(chunk, "VP8L") == 0) {
+    b.push_back(0x2F);
+    put32le(b, (w - 1) | ((h - 1) << 14));
+  } else {
+    put32le(b, 0);
+    put16le(b, (w - 1) & 0xFFFF); b.push_back(uint8_t((w - 1) >> 16));
+    put16le(b, (h - 1) & 0xFFFF); b.push_back(uint8_t((h - 1) >> 16));
+  }
+  b.resize(b.size() + 8, 0);
+  return b;
+}
+
+static Bytes bmp(int32_t w, int32_t h) {
+  Bytes b;
+  putStr(b, "BM");
+  b.resize(18, 0);
+  put32le(b, uint32_t(w));
+  put32le(b, uint32_t(h));
+  b.resize(b.size() + 8, 0);
+  return b;
+}
+
+static void expectProbe(const Bytes& b, const char* mime, int w, int h) {
+  std::string m;
+  int pw = -1, ph = -1;
+  const bool known = ArtworkCache::probe(b.data(), b.size(), &m, &pw, &ph);
+  CHECK(known);
+  CHECK(m == mime);
+  CHECK(pw == w);
+  CHECK(ph == h);
+  if (m != mime || pw != w || ph != h) {
+    std::fprintf(stderr, "  probe: %s %dx%d, expected %s %dx%d\n", m.c_str(), pw, ph, mime, w, h);
+  }
+}
+
+static void testProbe() {
+  expectProbe(png(640, 480), "image/png", 640, 480);
+  expectProbe(jpeg(1200, 1200), "image/jpeg", 1200, 1200);
+  expectProbe(gif(64, 32), "image/gif", 64, 32);
+  expectProbe(webp("VP8 ", 300, 200), "image/webp", 300, 200);
+  expectProbe(webp("VP8L", 512, 256), "image/webp", 512, 256);
+  expectProbe(webp("VP8X", 70000, 3), "image/webp", 70000, 3);
+  expectProbe(bmp(96, -96), "image/bmp", 96, 96);
+
+  std::string m;
+  int w = -1, h = -1;
+  const Bytes junk = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  CHECK(!ArtworkCache::probe(junk.data(), junk.size(), &m, &w, &h));
+  CHECK(m == "application/octet-stream");
+  CHECK(w == 0 && h == 0);
+
+  // A JPEG cut off before its frame header keeps the type, not the size
+  Bytes cut = jpeg(10, 10);
+  cut.resize(20);
+  CHECK(ArtworkCache::probe(cut.data(), cut.size(), &m, &w, &h));
+  CHECK(m == "image/jpeg" && w == 0 && h == 0);
+}
+
+static void testBase64() {
+  const uint8_t* s = reinterpret_cast<const uint8_t*>("foobar");
+  CHECK(ArtworkCache::base64(s, 0) == "");
+  CHECK(ArtworkCache::base64(s, 1) == "Zg==");
+  CHECK(ArtworkCache::base64(s, 2) == "Zm8=");
+  CHECK(ArtworkCache::base64(s, 3) == "Zm9v");
+  CHECK(ArtworkCache::base64(s, 6) == "Zm9vYmFy");
+}
+
+static void testSubmit() {
+  ArtworkCache cache(2);
+  const Bytes a = png(10, 10), b = gif(20, 20), c = jpeg(30, 30);
+
+  auto s1 = cache.submit(a.data(), a.size());
+  CHECK(s1.changed && s1.image);
+  CHECK(s1.image->id != 0);
+  CHECK(s1.image->mime == "image/png" && s1.image->width == 10);
+  CHECK(ArtworkCache::dataUrl(*s1.image) == "data:image/png;base64," + ArtworkCache::base64(a.data(), a.size()));
+
+  // The same bytes from a fresh buffer: same entry, no change
+  const Bytes a2 = a;
+  auto s2 = cache.submit(a2.data(), a2.size());
+  CHECK(!s2.changed);
+  CHECK(s2.image == s1.image);
+  CHECK(cache.size() == 1);
+
+  auto s3 = cache.submit(b.data(), b.size());
+  CHECK(s3.changed && s3.image->id != s1.image->id);
+  CHECK(cache.currentId() == s3.image->id);
+
+  // Back to a known image: a change, but the id is kept
+  auto s4 = cache.submit(a.data(), a.size());
+  CHECK(s4.changed && s4.image->id == s1.image->id);
+
+  // No artwork is a change once, then not
+  auto none = cache.submit(nullptr, 0);
+  CHECK(none.changed && !none.image && cache.currentId() == 0);
+  CHECK(!cache.submit(nullptr, 0).changed);
+
+  // Capacity 2: c evicts b, the least recently submitted
+  auto s5 = cache.submit(c.data(), c.size());
+  CHECK(cache.size() == 2);
+  CHECK(cache.find(s3.image->id) == nullptr);
+  CHECK(cache.find(s1.image->id) == s1.image);
+  CHECK(cache.find(s5.image->id) == s5.image);
+
+  // Evicted entries keep living while someone holds them
+  CHECK(s3.image->mime == "image/gif");
+
+  cache.clear();
+  CHECK(cache.size() == 0 && cache.currentId() == 0);
+  CHECK(cache.submit(c.data(), c.size()).changed);
+}
+
+static void testHash() {
+  Bytes x(1000);
+  for (size_t i = 0; i < x.size(); ++i) x[i] = uint8_t(i * 7);
+  const uint64_t h = ArtworkCache::hashBytes(x.data(), x.size());
+  CHECK(h == ArtworkCache::hashBytes(x.data(), x.size()));
+  x[999] ^= 1;   // tail byte
+  CHECK(h != ArtworkCache::hashBytes(x.data(), x.size()));
+  x[999] ^= 1;
+  x[8] ^= 1;     // inside a word
+  CHECK(h != ArtworkCache::hashBytes(x.data(), x.size()));
+  CHECK(ArtworkCache::hashBytes(x.data(), 0) != ArtworkCache::hashBytes(x.data(), 1));
+}
+
+int main() {
+  testProbe();
+  testBase64();
+  testSubmit();
+  testHash();
+  return report("artwork cache");
+}
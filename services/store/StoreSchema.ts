@@ -90,6 +90,7 @@ export interface AudioConfig {
         dbFloor: number;
         masterGain: number;
         tilt: number;
+        outputDelayMs?: number;
     };
     gsm: {
         enabled: boolean;
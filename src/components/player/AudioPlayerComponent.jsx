@@ -2,7 +2,7 @@ import React, { useEffect, useLayoutEffect, useRef, useState, useMemo } from "re
 import styled, { createGlobalStyle, ThemeProvider } from "styled-components";
 import diskImg from "../../assets/disk.png";
 import { defaultTheme } from '../../theme';
-import {hexToRgba, lightenColor} from "../../utils.js";
+import {hexToRgba, lightenColor, withAlbumArt} from "../../utils.js";
 import Marquee from "react-fast-marquee";
 import useReconnectingWebSocket from '../../hooks/useReconnectingWebSocket';
 import FFTDonut from "./FFTDonut";
@@ -328,7 +328,7 @@ export default function AudioPlayerComponent() {
             if (typeof event.data !== 'string') return;
             const { type, data } = JSON.parse(event.data);
             if (type !== 'metadata') return;
-            setMetadata(data);
+            setMetadata(prev => withAlbumArt(data, prev));
             setProgress(data.position);
             setDuration(data.duration || 1);
         },
@@ -1,6 +1,6 @@
 import React, {useEffect, useRef, useState, useMemo} from "react";
 import styled, {ThemeProvider} from "styled-components";
-import {hexToRgba, lightenColor} from "../../utils.js"
+import {hexToRgba, lightenColor, withAlbumArt} from "../../utils.js"
 import FFTBars from "./FFTBars";
 import useReconnectingWebSocket from "../../hooks/useReconnectingWebSocket";
 import WaveForm from "./WaveForm";
@@ -313,7 +313,7 @@ function ModernAudioPlayer() {
             try {
                 const {type, data} = JSON.parse(event.data);
                 if (type !== 'metadata') return;
-                setMetadata(data);
+                setMetadata(prev => withAlbumArt(data, prev));
                 setProgress(data.position);
                 setDuration(data.duration);
             } catch (error) {
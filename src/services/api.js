@@ -201,6 +201,10 @@ export async function setFFTTilt(tilt) {
     return ipcRenderer?.invoke('audio:setFFTTilt', tilt);
 }
 
+export async function setFFTOutputDelay(ms) {
+    return ipcRenderer?.invoke('audio:setFFTOutputDelay', ms);
+}
+
 export async function getFFTconfig() {
     return ipcRenderer?.invoke('audio:getFFTConfig');
 }
@@ -194,4 +194,12 @@ export function generateGradientCSS(themeObject) {
             background: radial-gradient(circle at ${center.x}% ${center.y}%, ${stopStrings});
         `;
     }
-}
\ No newline at end of file
+}
+// Metadata broadcasts carry albumArtBase64 only when the artwork id changes;
+// for the same id keep the image from the previous message
+export function withAlbumArt(metadata, previous) {
+    if (metadata.albumArtBase64 || !metadata.albumArtId || previous?.albumArtId !== metadata.albumArtId) {
+        return metadata;
+    }
+    return {...metadata, albumArtBase64: previous.albumArtBase64};
+}